@@ -0,0 +1,398 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "benchmark.h"
+#include "system.h"
+#include "cpu.h"
+#include "utils.h"
+
+#define BENCHMARK_TICK_MS 100
+
+#define INSTANCES_TICK_MS 1         //Short enough that the instances take turns thousands of times a second.
+#define MAX_BENCHMARK_INSTANCES 256
+
+#define MICROBENCHMARK_ROM_FILE "microbenchmark.gb"
+#define MICROBENCHMARK_CODE_ADDR 0x150
+#define MICROBENCHMARK_LOOP_SIZE 64     //Bytes of instructions per go round the loop.
+
+struct BenchmarkResult
+{
+    double Seconds;
+    uint64_t Instructions;
+    uint64_t IdleCyclesSkipped;
+};
+
+static bool RunEmulation(struct GBInstance* pGB, const char* pRomFile, int numSeconds, struct BenchmarkResult* pResult)
+{
+    if (!SystemInit(pGB, pRomFile))
+    {
+        return false;
+    }
+
+    clock_t startTime = clock();
+
+    for (int ms = 0; ms < numSeconds * 1000; ms += BENCHMARK_TICK_MS)
+    {
+        SystemTick(pGB, BENCHMARK_TICK_MS);
+    }
+
+    pResult->Seconds = (double)(clock() - startTime) / CLOCKS_PER_SEC;
+    pResult->Instructions = CPUGetInstructionCount(pGB);
+    pResult->IdleCyclesSkipped = CPUGetIdleCyclesSkipped(pGB);
+
+    SystemShutdown(pGB);
+
+    return true;
+}
+
+static double InstructionsPerSecond(const struct BenchmarkResult* pResult)
+{
+    return pResult->Seconds > 0 ? pResult->Instructions / pResult->Seconds : 0;
+}
+
+static bool BenchmarkDispatch(struct GBInstance* pGB, const char* pRomFile, int numSeconds)
+{
+    static const struct
+    {
+        enum CPUDispatchMode Mode;
+        const char* pName;
+    } DispatchModes[] = {
+        { CPUDispatch_Switch, "switch" },
+        { CPUDispatch_Table, "table" },
+#if THREADED_DISPATCH_SUPPORTED
+        { CPUDispatch_Threaded, "threaded" },
+#endif
+    };
+
+    static const int NumDispatchModes = sizeof(DispatchModes) / sizeof(DispatchModes[0]);
+
+    printf("Opcode dispatch (%d emulated seconds):\n", numSeconds);
+
+    double switchIPS = 0;
+
+    //Make sure every instruction actually goes through the dispatcher.
+    CPUSetBlockCacheEnabled(pGB, false);
+
+    for (int i = 0; i < NumDispatchModes; ++i)
+    {
+        struct BenchmarkResult result;
+
+        CPUSetDispatchMode(pGB, DispatchModes[i].Mode);
+
+        if (!RunEmulation(pGB, pRomFile, numSeconds, &result))
+        {
+            return false;
+        }
+
+        double ips = InstructionsPerSecond(&result);
+
+        if (DispatchModes[i].Mode == CPUDispatch_Switch)
+        {
+            switchIPS = ips;
+        }
+
+        printf("\t%-10s %12.0f instructions/sec (%.2fx switch)\n", DispatchModes[i].pName, ips, switchIPS > 0 ? ips / switchIPS : 0);
+    }
+
+    return true;
+}
+
+static bool BenchmarkBlockCache(struct GBInstance* pGB, const char* pRomFile, int numSeconds)
+{
+    struct BenchmarkResult uncachedResult;
+    struct BenchmarkResult cachedResult;
+
+    printf("Block cache (%d emulated seconds):\n", numSeconds);
+
+    CPUSetBlockCacheEnabled(pGB, false);
+
+    if (!RunEmulation(pGB, pRomFile, numSeconds, &uncachedResult))
+    {
+        return false;
+    }
+
+    CPUSetBlockCacheEnabled(pGB, true);
+
+    if (!RunEmulation(pGB, pRomFile, numSeconds, &cachedResult))
+    {
+        return false;
+    }
+
+    double uncachedIPS = InstructionsPerSecond(&uncachedResult);
+    double cachedIPS = InstructionsPerSecond(&cachedResult);
+
+    printf("\t%-10s %12.0f instructions/sec\n", "off", uncachedIPS);
+    printf("\t%-10s %12.0f instructions/sec (%.2fx)\n", "on", cachedIPS, uncachedIPS > 0 ? cachedIPS / uncachedIPS : 0);
+    printf("\t%-10s %12.1f%% of emulated cycles\n", "idle skip", cachedResult.IdleCyclesSkipped * 100.0 / ((double)numSeconds * CLOCK_CYCLES));
+
+    if (CPUSetJitMode(pGB, CPUJit_On))
+    {
+        struct BenchmarkResult jitResult;
+        bool success = RunEmulation(pGB, pRomFile, numSeconds, &jitResult);
+        CPUSetJitMode(pGB, CPUJit_Off);
+
+        if (!success)
+        {
+            return false;
+        }
+
+        double jitIPS = InstructionsPerSecond(&jitResult);
+        printf("\t%-10s %12.0f instructions/sec (%.2fx)\n", "jit", jitIPS, uncachedIPS > 0 ? jitIPS / uncachedIPS : 0);
+    }
+
+    return true;
+}
+
+//Writes out a ROM that runs the given instructions over and over again. The logo is taken from the
+//boot ROM so that it's happy to start it.
+static bool WriteMicrobenchmarkROM(const byte* pOps, int numOpBytes)
+{
+    static byte ROM[ROM_SIZE];
+    byte bootROM[0x100];
+
+    if (!FileRead("dmg_boot.bin", bootROM, sizeof(bootROM)))
+    {
+        return false;
+    }
+
+    memset(ROM, 0, sizeof(ROM));
+
+    //Entry point: NOP, JP MICROBENCHMARK_CODE_ADDR.
+    ROM[0x100] = 0x00;
+    ROM[0x101] = 0xC3;
+    ROM[0x102] = MICROBENCHMARK_CODE_ADDR & 0xFF;
+    ROM[0x103] = MICROBENCHMARK_CODE_ADDR >> 8;
+
+    memcpy(&ROM[0x104], &bootROM[0xA8], 0x30);
+    memcpy(&ROM[0x134], "MICROBENCHMARK", 14);
+
+    byte checksum = 0;
+    for (int i = 0x134; i < 0x14D; ++i)
+    {
+        checksum = checksum - ROM[i] - 1;
+    }
+
+    ROM[0x14D] = checksum;
+
+    //The loop, then JP back to the start of it.
+    int addr = MICROBENCHMARK_CODE_ADDR;
+
+    while (addr + numOpBytes <= MICROBENCHMARK_CODE_ADDR + MICROBENCHMARK_LOOP_SIZE)
+    {
+        memcpy(&ROM[addr], pOps, numOpBytes);
+        addr += numOpBytes;
+    }
+
+    ROM[addr++] = 0xC3;
+    ROM[addr++] = MICROBENCHMARK_CODE_ADDR & 0xFF;
+    ROM[addr++] = MICROBENCHMARK_CODE_ADDR >> 8;
+
+    return FileWrite(MICROBENCHMARK_ROM_FILE, ROM, sizeof(ROM));
+}
+
+//Like RunEmulation but only times what happens once the boot ROM has finished.
+static bool RunMicrobenchmark(struct GBInstance* pGB, int numSeconds, struct BenchmarkResult* pResult)
+{
+    if (!SystemInit(pGB, MICROBENCHMARK_ROM_FILE))
+    {
+        return false;
+    }
+
+    while (ReadMem(pGB, 0xFF50) == 0)
+    {
+        SystemTick(pGB, BENCHMARK_TICK_MS);
+    }
+
+    uint64_t startInstructions = CPUGetInstructionCount(pGB);
+    clock_t startTime = clock();
+
+    for (int ms = 0; ms < numSeconds * 1000; ms += BENCHMARK_TICK_MS)
+    {
+        SystemTick(pGB, BENCHMARK_TICK_MS);
+    }
+
+    pResult->Seconds = (double)(clock() - startTime) / CLOCKS_PER_SEC;
+    pResult->Instructions = CPUGetInstructionCount(pGB) - startInstructions;
+    pResult->IdleCyclesSkipped = 0;
+
+    //Let go of the ROM so the next one can be written over it.
+    SystemShutdown(pGB);
+
+    return true;
+}
+
+//Times specific groups of instructions rather than a whole game.
+static bool BenchmarkInstructions(struct GBInstance* pGB, int numSeconds)
+{
+    static const byte LoadOps[] = {
+        0x41, 0x4A, 0x53, 0x5C, 0x65, 0x6F, 0x78, 0x47     //LD B,C  LD C,D  LD D,E  LD E,H  LD H,L  LD L,A  LD A,B  LD B,A
+    };
+
+    static const byte ALUOps[] = {
+        0x80, 0x89, 0x92, 0x9B, 0xA4, 0xAD, 0xB0, 0xB9     //ADD A,B  ADC A,C  SUB D  SBC A,E  AND H  XOR L  OR B  CP C
+    };
+
+    static const struct
+    {
+        const byte* pOps;
+        int NumOpBytes;
+        const char* pName;
+    } InstructionGroups[] = {
+        { LoadOps, sizeof(LoadOps), "LD r,r" },
+        { ALUOps, sizeof(ALUOps), "ALU r" },
+    };
+
+    static const int NumInstructionGroups = sizeof(InstructionGroups) / sizeof(InstructionGroups[0]);
+
+    printf("Instructions (%d emulated seconds):\n", numSeconds);
+
+    for (int i = 0; i < NumInstructionGroups; ++i)
+    {
+        if (!WriteMicrobenchmarkROM(InstructionGroups[i].pOps, InstructionGroups[i].NumOpBytes))
+        {
+            return false;
+        }
+
+        struct BenchmarkResult uncachedResult;
+        struct BenchmarkResult cachedResult;
+
+        CPUSetBlockCacheEnabled(pGB, false);
+        bool success = RunMicrobenchmark(pGB, numSeconds, &uncachedResult);
+
+        CPUSetBlockCacheEnabled(pGB, true);
+        success = success && RunMicrobenchmark(pGB, numSeconds, &cachedResult);
+
+        if (!success)
+        {
+            return false;
+        }
+
+        printf("\t%-10s %12.0f instructions/sec (%.0f cached)\n", InstructionGroups[i].pName, InstructionsPerSecond(&uncachedResult), InstructionsPerSecond(&cachedResult));
+    }
+
+    remove(MICROBENCHMARK_ROM_FILE);
+
+    return true;
+}
+
+//Runs lots of instances of the same ROM side by side on the one thread, taking turns a tick at a time,
+//to see how well they share the cache. The instances split the emulated time between them so that each
+//run does the same amount of work overall.
+static bool BenchmarkInstances(const char* pRomFile, int numSeconds)
+{
+    static const int InstanceCounts[] = { 1, 16, MAX_BENCHMARK_INSTANCES };
+    static const int NumInstanceCounts = sizeof(InstanceCounts) / sizeof(InstanceCounts[0]);
+
+    struct GBInstance** pInstances = calloc(MAX_BENCHMARK_INSTANCES, sizeof(struct GBInstance*));
+
+    if (pInstances == NULL)
+    {
+        return false;
+    }
+
+    bool success = true;
+    double singleIPS = 0;
+
+    printf("Instances (%d emulated seconds between them):\n", numSeconds);
+
+    for (int i = 0; i < NumInstanceCounts && success; ++i)
+    {
+        int numInstances = InstanceCounts[i];
+        int numCreated = 0;
+
+        //Get them all past the boot ROM first, it's not what we're timing.
+        while (numCreated < numInstances)
+        {
+            struct GBInstance* pGB = SystemCreate();
+
+            if (pGB == NULL || !SystemInit(pGB, pRomFile))
+            {
+                if (pGB != NULL)
+                {
+                    SystemDestroy(pGB);
+                }
+
+                success = false;
+                break;
+            }
+
+            pInstances[numCreated++] = pGB;
+
+            while (ReadMem(pGB, 0xFF50) == 0)
+            {
+                SystemTick(pGB, BENCHMARK_TICK_MS);
+            }
+        }
+
+        if (success)
+        {
+            int numTicks = MAX(1, numSeconds * 1000 / (numInstances * INSTANCES_TICK_MS));
+            uint64_t startInstructions = 0;
+
+            for (int j = 0; j < numInstances; ++j)
+            {
+                startInstructions += CPUGetInstructionCount(pInstances[j]);
+            }
+
+            clock_t startTime = clock();
+
+            for (int tick = 0; tick < numTicks; ++tick)
+            {
+                for (int j = 0; j < numInstances; ++j)
+                {
+                    SystemTick(pInstances[j], INSTANCES_TICK_MS);
+                }
+            }
+
+            struct BenchmarkResult result;
+            result.Seconds = (double)(clock() - startTime) / CLOCKS_PER_SEC;
+            result.Instructions = 0;
+            result.IdleCyclesSkipped = 0;
+
+            for (int j = 0; j < numInstances; ++j)
+            {
+                result.Instructions += CPUGetInstructionCount(pInstances[j]);
+            }
+
+            result.Instructions -= startInstructions;
+
+            double ips = InstructionsPerSecond(&result);
+
+            if (numInstances == 1)
+            {
+                singleIPS = ips;
+            }
+
+            printf("\t%-10d %12.0f instructions/sec (%.2fx single)\n", numInstances, ips, singleIPS > 0 ? ips / singleIPS : 0);
+        }
+
+        for (int j = 0; j < numCreated; ++j)
+        {
+            SystemDestroy(pInstances[j]);
+        }
+    }
+
+    free(pInstances);
+
+    return success;
+}
+
+bool RunBenchmarks(const char* pRomFile, int numSeconds)
+{
+    struct GBInstance* pGB = SystemCreate();
+
+    if (pGB == NULL)
+    {
+        return false;
+    }
+
+    bool success = BenchmarkDispatch(pGB, pRomFile, numSeconds)
+        && BenchmarkBlockCache(pGB, pRomFile, numSeconds)
+        && BenchmarkInstructions(pGB, numSeconds);
+
+    SystemDestroy(pGB);
+
+    return success && BenchmarkInstances(pRomFile, numSeconds);
+}
@@ -0,0 +1,11 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "types.h"
+
+#define DEFAULT_BENCHMARK_SECONDS 60
+
+//Runs the emulator headless for the given amount of emulated time and prints the results.
+bool RunBenchmarks(const char* pRomFile, int numSeconds);
+
+#endif
@@ -0,0 +1,699 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "cartridge.h"
+#include "instance.h"
+#include "utils.h"
+
+#include PLATFORM_INCLUDE(PLATFORM_NAME/platform_debug.h)
+#include PLATFORM_INCLUDE(PLATFORM_NAME/platform_memory.h)
+#include PLATFORM_INCLUDE(PLATFORM_NAME/platform_thread.h)
+
+//Memory bank controllers. Switching banks only re-points the memory map at a different part of the
+//ROM/RAM image so it's cheap no matter how often games do it. ROM images are mapped straight from the
+//file and shared by everything using the same ROM, only the cartridge RAM is per cartridge.
+//
+//Battery backed RAM is a .sav file next to the ROM that's mapped straight in. Clean pages of it are
+//mapped read-only so that the first write to each one comes through CartridgeWrite and gets noticed,
+//then every so often the dirty pages are handed to a thread that flushes them to disk and they're
+//write protected again.
+
+struct CartridgeHeader
+{
+    byte Title[16];         //0x0134-0x0143
+    byte LicenseeCode[2];   //0x0144-0x0145
+    byte SuperGBSupport;    //0x0146
+    byte CartridgeType;     //0x0147
+    byte ROMSize;           //0x0148
+    byte RAMSize;           //0x0149
+    byte Region;            //0x014A
+    byte OldLicenseeCode;   //0x014B
+    byte GameVersion;       //0x014C
+    byte HeaderChecksum;    //0x014D
+    byte GlobalChecksum[2]; //0x014E-0x014F
+};
+
+#define CARTRIDGE_HEADER_ADDR 0x0134
+#define MAX_ROM_IMAGES 16
+#define MAX_ROM_FILE_NAME 256
+#define DEFAULT_SAVE_FLUSH_INTERVAL_MS 1000
+
+struct ROMImage
+{
+    char FileName[MAX_ROM_FILE_NAME];
+    const byte* pData;
+    size_t Size;
+    bool IsMapped;      //Otherwise it's a padded copy.
+    int NumUsers;
+};
+
+//Shared by every instance, so only touched with pROMImagesMutex held.
+static struct ROMImage ROMImages[MAX_ROM_IMAGES];
+static struct PlatformMutex* pROMImagesMutex = NULL;
+
+//What reads from banks past the end of the ROM (or with no cartridge in) get.
+static byte EmptyROMBank[ROM_BANK_SIZE];
+
+//What reads from cartridge RAM get when there isn't any (or it's disabled).
+static byte UnmappedPage[MEM_PAGE_SIZE];
+
+static bool SharedStateInitialised = false;
+
+static byte* GetROMBank(struct GBInstance* pGB, int bank)
+{
+    size_t offset = (size_t)bank * ROM_BANK_SIZE;
+
+    //The ROM is never written to (writes go to the bank controller) so it's fine to map it.
+    if (pGB->Cartridge.pROMImage == NULL || offset + ROM_BANK_SIZE > pGB->Cartridge.pROMImage->Size)
+    {
+        return EmptyROMBank;
+    }
+
+    return (byte*)&pGB->Cartridge.pROMImage->pData[offset];
+}
+
+static void MapROM(struct GBInstance* pGB)
+{
+    int bank0 = 0;
+    int bank = pGB->Cartridge.ROMBank;
+
+    if (pGB->Cartridge.MBC == MBC_1)
+    {
+        bank |= pGB->Cartridge.RAMBank << 5;
+
+        if (pGB->Cartridge.MBC1RAMBankingMode)
+        {
+            bank0 = pGB->Cartridge.RAMBank << 5;
+        }
+    }
+
+    bank0 &= pGB->Cartridge.NumROMBanks - 1;
+    bank &= pGB->Cartridge.NumROMBanks - 1;
+
+    SystemMapMemory(pGB, ROM_ADDR, ROM_BANK_SIZE, GetROMBank(pGB, bank0), NULL);
+    SystemMapMemory(pGB, ROM_ADDR + ROM_BANK_SIZE, ROM_BANK_SIZE, GetROMBank(pGB, bank), NULL);
+}
+
+//Where in RAM an address in the cartridge RAM area is, for the currently selected bank.
+static int GetRAMOffset(struct GBInstance* pGB, uint16_t addr)
+{
+    int bank = pGB->Cartridge.MBC == MBC_1 && !pGB->Cartridge.MBC1RAMBankingMode ? 0 : pGB->Cartridge.RAMBank;
+
+    //Anything smaller than a bank is mirrored.
+    return ((bank * RAM_BANK_SIZE) + (addr - CART_RAM_ADDR)) % pGB->Cartridge.RAMSize;
+}
+
+static void MapRAM(struct GBInstance* pGB)
+{
+    if (pGB->Cartridge.MBC == MBC_None)
+    {
+        pGB->Cartridge.RAMEnabled = pGB->Cartridge.RAMSize > 0;
+    }
+
+    for (uint16_t offset = 0; offset < RAM_BANK_SIZE; offset += MEM_PAGE_SIZE)
+    {
+        byte* pRead = UnmappedPage;
+        byte* pWrite = NULL;
+
+        if (pGB->Cartridge.RAMEnabled && pGB->Cartridge.SelectedRTCRegister >= 0)
+        {
+            //Writes have to go through CartridgeWrite to update the page.
+            pRead = pGB->Cartridge.RTCPage;
+        }
+        else if (pGB->Cartridge.RAMEnabled && pGB->Cartridge.RAMSize > 0)
+        {
+            int ramOffset = GetRAMOffset(pGB, CART_RAM_ADDR + offset);
+            pRead = &pGB->Cartridge.pRAM[ramOffset];
+
+            if (pGB->Cartridge.pSaveFile == NULL || pGB->Cartridge.DirtyRAMPages[ramOffset / MEM_PAGE_SIZE])
+            {
+                pWrite = pRead;
+            }
+        }
+
+        SystemMapMemory(pGB, CART_RAM_ADDR + offset, MEM_PAGE_SIZE, pRead, pWrite);
+    }
+}
+
+static void SelectRTCRegister(struct GBInstance* pGB, int reg)
+{
+    pGB->Cartridge.SelectedRTCRegister = reg;
+
+    if (reg >= 0)
+    {
+        memset(pGB->Cartridge.RTCPage, pGB->Cartridge.RTCRegisters[reg], sizeof(pGB->Cartridge.RTCPage));
+    }
+}
+
+static void WriteMBC1(struct GBInstance* pGB, uint16_t addr, byte val)
+{
+    if (addr < 0x2000)
+    {
+        pGB->Cartridge.RAMEnabled = (val & 0xF) == 0xA;
+        MapRAM(pGB);
+    }
+    else if (addr < 0x4000)
+    {
+        pGB->Cartridge.ROMBank = MAX(1, val & 0x1F);
+        MapROM(pGB);
+    }
+    else if (addr < 0x6000)
+    {
+        pGB->Cartridge.RAMBank = val & 0x3;
+        MapROM(pGB);
+        MapRAM(pGB);
+    }
+    else
+    {
+        pGB->Cartridge.MBC1RAMBankingMode = val & 0x1;
+        MapROM(pGB);
+        MapRAM(pGB);
+    }
+}
+
+static void WriteMBC3(struct GBInstance* pGB, uint16_t addr, byte val)
+{
+    if (addr < 0x2000)
+    {
+        pGB->Cartridge.RAMEnabled = (val & 0xF) == 0xA;
+        MapRAM(pGB);
+    }
+    else if (addr < 0x4000)
+    {
+        pGB->Cartridge.ROMBank = MAX(1, val & 0x7F);
+        MapROM(pGB);
+    }
+    else if (addr < 0x6000)
+    {
+        if (val >= 0x08 && val <= 0x0C)
+        {
+            SelectRTCRegister(pGB, val - 0x08);
+        }
+        else
+        {
+            SelectRTCRegister(pGB, -1);
+            pGB->Cartridge.RAMBank = val & 0x3;
+        }
+
+        MapRAM(pGB);
+    }
+
+    //Latching the clock (0x6000-0x7FFF) does nothing as it never moves.
+}
+
+static void WriteMBC5(struct GBInstance* pGB, uint16_t addr, byte val)
+{
+    if (addr < 0x2000)
+    {
+        pGB->Cartridge.RAMEnabled = (val & 0xF) == 0xA;
+        MapRAM(pGB);
+    }
+    else if (addr < 0x3000)
+    {
+        pGB->Cartridge.ROMBank = (pGB->Cartridge.ROMBank & 0x100) | val;
+        MapROM(pGB);
+    }
+    else if (addr < 0x4000)
+    {
+        pGB->Cartridge.ROMBank = (pGB->Cartridge.ROMBank & 0xFF) | ((val & 0x1) << 8);
+        MapROM(pGB);
+    }
+    else if (addr < 0x6000)
+    {
+        pGB->Cartridge.RAMBank = val & 0xF;
+        MapRAM(pGB);
+    }
+}
+
+void CartridgeWrite(struct GBInstance* pGB, uint16_t addr, byte val)
+{
+    if (addr >= CART_RAM_ADDR)
+    {
+        //The clock registers and clean pages of battery backed RAM aren't mapped for writing.
+        if (pGB->Cartridge.RAMEnabled && pGB->Cartridge.SelectedRTCRegister >= 0)
+        {
+            pGB->Cartridge.RTCRegisters[pGB->Cartridge.SelectedRTCRegister] = val;
+            SelectRTCRegister(pGB, pGB->Cartridge.SelectedRTCRegister);
+        }
+        else if (pGB->Cartridge.RAMEnabled && pGB->Cartridge.RAMSize > 0)
+        {
+            int ramOffset = GetRAMOffset(pGB, addr);
+            pGB->Cartridge.pRAM[ramOffset] = val;
+
+            pGB->Cartridge.DirtyRAMPages[ramOffset / MEM_PAGE_SIZE] = true;
+            pGB->Cartridge.AnyRAMPagesDirty = true;
+            MapRAM(pGB);
+        }
+
+        return;
+    }
+
+    switch (pGB->Cartridge.MBC)
+    {
+        case MBC_1: WriteMBC1(pGB, addr, val); break;
+        case MBC_3: WriteMBC3(pGB, addr, val); break;
+        case MBC_5: WriteMBC5(pGB, addr, val); break;
+        default: break;     //Not allowed to write to ROM!
+    }
+}
+
+static bool GetMBC(byte cartridgeType, enum MBC* pMBC)
+{
+    switch (cartridgeType)
+    {
+        case 0x00: case 0x08: case 0x09:
+            *pMBC = MBC_None;
+            return true;
+
+        case 0x01: case 0x02: case 0x03:
+            *pMBC = MBC_1;
+            return true;
+
+        case 0x0F: case 0x10: case 0x11: case 0x12: case 0x13:
+            *pMBC = MBC_3;
+            return true;
+
+        case 0x19: case 0x1A: case 0x1B: case 0x1C: case 0x1D: case 0x1E:
+            *pMBC = MBC_5;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static int GetRAMSize(byte ramSize)
+{
+    switch (ramSize)
+    {
+        case 0x01: return 2 * 1024;
+        case 0x02: return 8 * 1024;
+        case 0x03: return 32 * 1024;
+        case 0x04: return 128 * 1024;
+        case 0x05: return 64 * 1024;
+        default: return 0;
+    }
+}
+
+static bool HasBattery(byte cartridgeType)
+{
+    switch (cartridgeType)
+    {
+        case 0x03: case 0x09: case 0x0F: case 0x10: case 0x13: case 0x1B: case 0x1E:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static void FlushSavePages(struct GBInstance* pGB, const bool* pPages)
+{
+    //Runs of dirty pages are flushed together.
+    for (int page = 0; page < pGB->Cartridge.RAMSize / MEM_PAGE_SIZE; ++page)
+    {
+        if (pPages[page])
+        {
+            int endPage = page + 1;
+
+            while (endPage < pGB->Cartridge.RAMSize / MEM_PAGE_SIZE && pPages[endPage])
+            {
+                endPage++;
+            }
+
+            PlatformFlushFile(pGB->Cartridge.pSaveFile, page * MEM_PAGE_SIZE, (endPage - page) * MEM_PAGE_SIZE);
+            page = endPage;
+        }
+    }
+}
+
+static void SaveFlusherMain(void* pArg)
+{
+    struct GBInstance* pGB = (struct GBInstance*)pArg;
+    bool pages[NUM_RAM_PAGES];
+    bool stop = false;
+
+    while (!stop)
+    {
+        PlatformWaitEvent(pGB->Cartridge.pSaveEvent);
+
+        PlatformLockMutex(pGB->Cartridge.pSaveMutex);
+        memcpy(pages, pGB->Cartridge.PendingFlushPages, sizeof(pages));
+        memset(pGB->Cartridge.PendingFlushPages, 0, sizeof(pGB->Cartridge.PendingFlushPages));
+        stop = pGB->Cartridge.StopSaveFlusher;
+        PlatformUnlockMutex(pGB->Cartridge.pSaveMutex);
+
+        FlushSavePages(pGB, pages);
+    }
+}
+
+//Hands the dirty pages over to the flusher and write protects them again.
+static void QueueSaveFlush(struct GBInstance* pGB)
+{
+    PlatformLockMutex(pGB->Cartridge.pSaveMutex);
+
+    for (int page = 0; page < NUM_RAM_PAGES; ++page)
+    {
+        pGB->Cartridge.PendingFlushPages[page] |= pGB->Cartridge.DirtyRAMPages[page];
+    }
+
+    PlatformUnlockMutex(pGB->Cartridge.pSaveMutex);
+    PlatformSignalEvent(pGB->Cartridge.pSaveEvent);
+
+    memset(pGB->Cartridge.DirtyRAMPages, 0, sizeof(pGB->Cartridge.DirtyRAMPages));
+    pGB->Cartridge.AnyRAMPagesDirty = false;
+    MapRAM(pGB);
+}
+
+static void StopSaveFlusherThread(struct GBInstance* pGB)
+{
+    PlatformLockMutex(pGB->Cartridge.pSaveMutex);
+    pGB->Cartridge.StopSaveFlusher = true;
+    PlatformUnlockMutex(pGB->Cartridge.pSaveMutex);
+    PlatformSignalEvent(pGB->Cartridge.pSaveEvent);
+
+    PlatformJoinThread(pGB->Cartridge.pSaveFlusher);
+    pGB->Cartridge.pSaveFlusher = NULL;
+}
+
+static void DestroySaveFlusher(struct GBInstance* pGB)
+{
+    if (pGB->Cartridge.pSaveFlusher != NULL)
+    {
+        StopSaveFlusherThread(pGB);
+    }
+
+    if (pGB->Cartridge.pSaveEvent != NULL)
+    {
+        PlatformDestroyEvent(pGB->Cartridge.pSaveEvent);
+        pGB->Cartridge.pSaveEvent = NULL;
+    }
+
+    if (pGB->Cartridge.pSaveMutex != NULL)
+    {
+        PlatformDestroyMutex(pGB->Cartridge.pSaveMutex);
+        pGB->Cartridge.pSaveMutex = NULL;
+    }
+}
+
+static void OpenSaveFile(struct GBInstance* pGB, const char* pRomFile)
+{
+    //Next to the ROM with the extension swapped for .sav.
+    char saveFile[MAX_ROM_FILE_NAME + 4];
+    strcpy(saveFile, pRomFile);
+
+    char* pExtension = strrchr(saveFile, '.');
+
+    if (pExtension == NULL || strpbrk(pExtension, "/\\") != NULL)
+    {
+        pExtension = &saveFile[strlen(saveFile)];
+    }
+
+    strcpy(pExtension, ".sav");
+
+    pGB->Cartridge.pSaveFile = PlatformMapFileWritable(saveFile, pGB->Cartridge.RAMSize);
+
+    if (pGB->Cartridge.pSaveFile == NULL)
+    {
+        DebugPrint("Failed to open save file %s, the game won't be saved!\n", saveFile);
+        return;
+    }
+
+    pGB->Cartridge.pRAM = pGB->Cartridge.pSaveFile;
+    memset(pGB->Cartridge.DirtyRAMPages, 0, sizeof(pGB->Cartridge.DirtyRAMPages));
+    memset(pGB->Cartridge.PendingFlushPages, 0, sizeof(pGB->Cartridge.PendingFlushPages));
+    pGB->Cartridge.AnyRAMPagesDirty = false;
+    pGB->Cartridge.StopSaveFlusher = false;
+    pGB->Cartridge.SaveFlushTimer = 0;
+
+    //Without the thread the save is only flushed on shutdown (although the OS will get round to
+    //writing it back itself before then).
+    pGB->Cartridge.pSaveMutex = PlatformCreateMutex();
+    pGB->Cartridge.pSaveEvent = PlatformCreateEvent();
+
+    if (pGB->Cartridge.pSaveMutex != NULL && pGB->Cartridge.pSaveEvent != NULL)
+    {
+        pGB->Cartridge.pSaveFlusher = PlatformCreateThread(&SaveFlusherMain, pGB);
+    }
+
+    if (pGB->Cartridge.pSaveFlusher == NULL)
+    {
+        DebugPrint("Failed to start the save flusher!\n");
+    }
+}
+
+static void CloseSaveFile(struct GBInstance* pGB)
+{
+    DestroySaveFlusher(pGB);
+
+    //Whatever's left. All of it, as the pages that were pending when the flusher stopped aren't known.
+    PlatformFlushFile(pGB->Cartridge.pSaveFile, 0, pGB->Cartridge.RAMSize);
+    PlatformUnmapFile(pGB->Cartridge.pSaveFile, pGB->Cartridge.RAMSize);
+
+    pGB->Cartridge.pSaveFile = NULL;
+    pGB->Cartridge.pRAM = pGB->Cartridge.RAMBuffer;
+    MapRAM(pGB);
+}
+
+static struct ROMImage* AcquireROMImage(const char* pRomFile)
+{
+    struct ROMImage* pFree = NULL;
+
+    for (int i = 0; i < MAX_ROM_IMAGES; ++i)
+    {
+        struct ROMImage* pImage = &ROMImages[i];
+
+        if (pImage->NumUsers > 0 && strcmp(pImage->FileName, pRomFile) == 0)
+        {
+            pImage->NumUsers++;
+            return pImage;
+        }
+
+        if (pImage->NumUsers == 0 && pFree == NULL)
+        {
+            pFree = pImage;
+        }
+    }
+
+    if (pFree == NULL || strlen(pRomFile) >= MAX_ROM_FILE_NAME)
+    {
+        DebugPrint("Failed to load %s, too many ROMs!\n", pRomFile);
+        return NULL;
+    }
+
+    size_t size = 0;
+    const byte* pData = PlatformMapFile(pRomFile, &size);
+
+    if (pData == NULL)
+    {
+        DebugPrint("Failed to read file %s!\n", pRomFile);
+        return NULL;
+    }
+
+    pFree->IsMapped = true;
+
+    //Banks are mapped straight into memory so a partial last bank needs padding out.
+    if (size < 2 * ROM_BANK_SIZE || (size % ROM_BANK_SIZE) != 0)
+    {
+        size_t paddedSize = MAX(2, (size + ROM_BANK_SIZE - 1) / ROM_BANK_SIZE) * ROM_BANK_SIZE;
+        byte* pCopy = malloc(paddedSize);
+
+        if (pCopy == NULL)
+        {
+            DebugPrint("Failed to allocate ROM!\n");
+            PlatformUnmapFile(pData, size);
+            return NULL;
+        }
+
+        memset(pCopy, 0xFF, paddedSize);
+        memcpy(pCopy, pData, size);
+        PlatformUnmapFile(pData, size);
+
+        pData = pCopy;
+        size = paddedSize;
+        pFree->IsMapped = false;
+    }
+
+    strcpy(pFree->FileName, pRomFile);
+    pFree->pData = pData;
+    pFree->Size = size;
+    pFree->NumUsers = 1;
+
+    return pFree;
+}
+
+static void ReleaseROMImage(struct ROMImage* pImage)
+{
+    assert(pImage->NumUsers > 0);
+
+    if (--pImage->NumUsers > 0)
+    {
+        return;
+    }
+
+    if (pImage->IsMapped)
+    {
+        PlatformUnmapFile(pImage->pData, pImage->Size);
+    }
+    else
+    {
+        free((void*)pImage->pData);
+    }
+
+    pImage->pData = NULL;
+}
+
+static bool LoadROM(struct GBInstance* pGB, const char* pRomFile)
+{
+    CartridgeShutdown(pGB);
+
+    if (pRomFile != NULL)
+    {
+        PlatformLockMutex(pROMImagesMutex);
+        pGB->Cartridge.pROMImage = AcquireROMImage(pRomFile);
+        PlatformUnlockMutex(pROMImagesMutex);
+
+        if (pGB->Cartridge.pROMImage == NULL)
+        {
+            return false;
+        }
+    }
+
+    //Always a power of 2 number of banks so that bank numbers can just be masked.
+    size_t romSize = pGB->Cartridge.pROMImage != NULL ? pGB->Cartridge.pROMImage->Size : 0;
+    pGB->Cartridge.NumROMBanks = 2;
+
+    while ((size_t)pGB->Cartridge.NumROMBanks * ROM_BANK_SIZE < romSize)
+    {
+        pGB->Cartridge.NumROMBanks *= 2;
+    }
+
+    return true;
+}
+
+static bool InitSharedState()
+{
+    if (SharedStateInitialised)
+    {
+        return true;
+    }
+
+    //Reading from the cartridge when there isn't one in results in 0xFF.
+    memset(EmptyROMBank, 0xFF, sizeof(EmptyROMBank));
+    memset(UnmappedPage, 0xFF, sizeof(UnmappedPage));
+
+    pROMImagesMutex = PlatformCreateMutex();
+
+    if (pROMImagesMutex == NULL)
+    {
+        DebugPrint("Failed to create ROM image mutex!\n");
+        return false;
+    }
+
+    SharedStateInitialised = true;
+    return true;
+}
+
+void CartridgeCreate(struct GBInstance* pGB)
+{
+    pGB->Cartridge.pRAM = pGB->Cartridge.RAMBuffer;
+    pGB->Cartridge.SaveFlushInterval = DEFAULT_SAVE_FLUSH_INTERVAL_MS;
+    pGB->Cartridge.SelectedRTCRegister = -1;
+}
+
+bool CartridgeInit(struct GBInstance* pGB, const char* pRomFile)
+{
+    if (!InitSharedState() || !LoadROM(pGB, pRomFile))
+    {
+        assert(0);
+        return false;
+    }
+
+    pGB->Cartridge.MBC = MBC_None;
+    pGB->Cartridge.RAMSize = 0;
+
+    if (pRomFile != NULL)
+    {
+        const struct CartridgeHeader* pHeader = (const struct CartridgeHeader*)&pGB->Cartridge.pROMImage->pData[CARTRIDGE_HEADER_ADDR];
+        DebugPrint("Cartridge Loaded: \n");
+        DebugPrint("\tTitle: %.16s\n", pHeader->Title);
+        DebugPrint("\tLicenseeCode: %.2s\n", pHeader->LicenseeCode);
+        DebugPrint("\tSuperGBSupport: %u\n", pHeader->SuperGBSupport);
+        DebugPrint("\tCartridgeType: %u\n", pHeader->CartridgeType);
+        DebugPrint("\tROMSize: %u\n", pHeader->ROMSize);
+        DebugPrint("\tRAMSize: %u\n", pHeader->RAMSize);
+        DebugPrint("\tRegion: %u\n", pHeader->Region);
+        DebugPrint("\tOldLicenseeCode: %u\n", pHeader->OldLicenseeCode);
+        DebugPrint("\tGameVersion: %u\n", pHeader->GameVersion);
+
+        if (!GetMBC(pHeader->CartridgeType, &pGB->Cartridge.MBC))
+        {
+            DebugPrint("Unsupported cartridge type 0x%02X!\n", pHeader->CartridgeType);
+            assert(0);
+            return false;
+        }
+
+        pGB->Cartridge.RAMSize = GetRAMSize(pHeader->RAMSize);
+
+        if (pGB->Cartridge.RAMSize > 0 && HasBattery(pHeader->CartridgeType))
+        {
+            OpenSaveFile(pGB, pRomFile);
+        }
+    }
+
+    memset(pGB->Cartridge.RAMBuffer, 0, sizeof(pGB->Cartridge.RAMBuffer));
+    memset(pGB->Cartridge.RTCRegisters, 0, sizeof(pGB->Cartridge.RTCRegisters));
+
+    pGB->Cartridge.RAMEnabled = false;
+    pGB->Cartridge.ROMBank = 1;
+    pGB->Cartridge.RAMBank = 0;
+    pGB->Cartridge.MBC1RAMBankingMode = false;
+    pGB->Cartridge.SelectedRTCRegister = -1;
+
+    MapROM(pGB);
+    MapRAM(pGB);
+
+    return true;
+}
+
+void CartridgeShutdown(struct GBInstance* pGB)
+{
+    if (pGB->Cartridge.pSaveFile != NULL)
+    {
+        CloseSaveFile(pGB);
+    }
+
+    if (pGB->Cartridge.pROMImage != NULL)
+    {
+        PlatformLockMutex(pROMImagesMutex);
+        ReleaseROMImage(pGB->Cartridge.pROMImage);
+        PlatformUnlockMutex(pROMImagesMutex);
+        pGB->Cartridge.pROMImage = NULL;
+    }
+}
+
+void CartridgeTick(struct GBInstance* pGB, uint32_t dt)
+{
+    if (pGB->Cartridge.pSaveFlusher == NULL)
+    {
+        return;
+    }
+
+    pGB->Cartridge.SaveFlushTimer += dt;
+
+    if (pGB->Cartridge.SaveFlushTimer >= pGB->Cartridge.SaveFlushInterval)
+    {
+        pGB->Cartridge.SaveFlushTimer = 0;
+
+        if (pGB->Cartridge.AnyRAMPagesDirty)
+        {
+            QueueSaveFlush(pGB);
+        }
+    }
+}
+
+void CartridgeSetSaveFlushInterval(struct GBInstance* pGB, uint32_t ms)
+{
+    pGB->Cartridge.SaveFlushInterval = ms;
+}
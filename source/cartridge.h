@@ -0,0 +1,92 @@
+#ifndef CARTRIDGE_H
+#define CARTRIDGE_H
+
+#include "types.h"
+#include "system.h"
+
+#define ROM_BANK_SIZE 0x4000
+#define RAM_BANK_SIZE 0x2000
+
+#define MAX_RAM_SIZE (128 * 1024)
+#define NUM_RAM_PAGES (MAX_RAM_SIZE / MEM_PAGE_SIZE)
+
+struct GBInstance;
+struct ROMImage;
+struct PlatformThread;
+struct PlatformMutex;
+struct PlatformEvent;
+
+enum MBC
+{
+    MBC_None,
+    MBC_1,
+    MBC_3,
+    MBC_5
+};
+
+enum RTCRegister
+{
+    RTC_Seconds,
+    RTC_Minutes,
+    RTC_Hours,
+    RTC_DayLow,
+    RTC_DayHigh,
+    NUM_RTC_REGISTERS
+};
+
+struct CartridgeState
+{
+    enum MBC MBC;
+
+    struct ROMImage* pROMImage;
+    int NumROMBanks;
+
+    byte RAMBuffer[MAX_RAM_SIZE];
+    byte* pRAM;         //Either RAMBuffer or the save file.
+    int RAMSize;
+
+    //Battery backed RAM.
+    byte* pSaveFile;
+    bool DirtyRAMPages[NUM_RAM_PAGES];  //Written since they were last handed to the flusher.
+    bool AnyRAMPagesDirty;
+    uint32_t SaveFlushInterval;
+    uint32_t SaveFlushTimer;
+
+    //Shared with the flusher thread, the pending pages and the stop flag are only touched with
+    //pSaveMutex held.
+    struct PlatformThread* pSaveFlusher;
+    struct PlatformMutex* pSaveMutex;
+    struct PlatformEvent* pSaveEvent;
+    bool PendingFlushPages[NUM_RAM_PAGES];
+    bool StopSaveFlusher;
+
+    //Bank controller registers.
+    bool RAMEnabled;
+    int ROMBank;
+    int RAMBank;        //Also the upper ROM bank bits on MBC1.
+    bool MBC1RAMBankingMode;
+
+    //MBC3 clock. It doesn't tick, but games can at least read back what they've written.
+    byte RTCRegisters[NUM_RTC_REGISTERS];
+    int SelectedRTCRegister;
+    byte RTCPage[MEM_PAGE_SIZE];
+};
+
+//Sets up the defaults for a new instance, before anything's been loaded.
+void CartridgeCreate(struct GBInstance* pGB);
+
+//Loads the ROM (NULL for no cartridge) and maps it into memory.
+bool CartridgeInit(struct GBInstance* pGB, const char* pRomFile);
+
+//Saves any battery backed RAM and lets go of the ROM. The ROM's memory stays around for as long as
+//anything else (including other instances) is using the same file.
+void CartridgeShutdown(struct GBInstance* pGB);
+
+//Hands any battery backed RAM that's been written to over to be saved, every so often.
+void CartridgeTick(struct GBInstance* pGB, uint32_t dt);
+void CartridgeSetSaveFlushInterval(struct GBInstance* pGB, uint32_t ms);
+
+//Writes to ROM or cartridge RAM that aren't mapped directly, ie. to the bank controller's registers.
+void CartridgeWrite(struct GBInstance* pGB, uint16_t addr, byte val);
+
+#endif
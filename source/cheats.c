@@ -0,0 +1,299 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "cheats.h"
+#include "instance.h"
+#include "utils.h"
+
+#include PLATFORM_INCLUDE(PLATFORM_NAME/platform_debug.h)
+
+//More than there can be patched pages mapped at once, so there's always one free to reuse.
+#define MAX_CHEAT_OVERLAYS (MAX_CHEATS * 2)
+
+//A copy of a ROM page with the patches for wherever it's mapped applied. Reads never have to check for
+//cheats as the memory map just points at these instead. They're kept for as long as possible rather than
+//being patched again every time a bank is switched back in.
+struct CheatOverlay
+{
+    const byte* pSource;
+    int Page;
+    byte Data[MEM_PAGE_SIZE];
+};
+
+static int HexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+
+    return -1;
+}
+
+//Where the page mapped at a ROM page lives, which for page 0 might be under the boot ROM.
+static byte** GetROMPageSlot(struct GBInstance* pGB, int page)
+{
+    return page == 0 && pGB->ReadPages[0] == pGB->BootROM ? &pGB->pPageUnderBootROM : &pGB->ReadPages[page];
+}
+
+static struct CheatOverlay* FindOverlay(struct GBInstance* pGB, const byte* pPage)
+{
+    for (int i = 0; i < pGB->Cheats.NumOverlays; ++i)
+    {
+        if (pGB->Cheats.pOverlays[i].Data == pPage)
+        {
+            return &pGB->Cheats.pOverlays[i];
+        }
+    }
+
+    return NULL;
+}
+
+static struct CheatOverlay* AllocOverlay(struct GBInstance* pGB)
+{
+    if (pGB->Cheats.NumOverlays < MAX_CHEAT_OVERLAYS)
+    {
+        return &pGB->Cheats.pOverlays[pGB->Cheats.NumOverlays++];
+    }
+
+    //Reuse one that isn't mapped. The CPU caches code by host address, so anything it has from it has to go.
+    for (int i = 0; i < MAX_CHEAT_OVERLAYS; ++i)
+    {
+        struct CheatOverlay* pOverlay = &pGB->Cheats.pOverlays[i];
+
+        if (*GetROMPageSlot(pGB, pOverlay->Page) != pOverlay->Data)
+        {
+            for (int offset = 0; offset < MEM_PAGE_SIZE; offset += CPU_CODE_LINE_SIZE)
+            {
+                CPUInvalidateCode(pGB, (uint16_t)((pOverlay->Page << MEM_PAGE_SHIFT) + offset));
+            }
+
+            return pOverlay;
+        }
+    }
+
+    assert(0);
+    return NULL;
+}
+
+static bool PatchApplies(const struct ROMPatch* pPatch, const byte* pSource)
+{
+    return pPatch->Compare < 0 || pSource[pPatch->Addr & (MEM_PAGE_SIZE - 1)] == pPatch->Compare;
+}
+
+//Returns what should be mapped at the page instead of pSource.
+static byte* PatchPage(struct GBInstance* pGB, int page, byte* pSource)
+{
+    for (int i = 0; i < pGB->Cheats.NumOverlays; ++i)
+    {
+        struct CheatOverlay* pOverlay = &pGB->Cheats.pOverlays[i];
+
+        if (pOverlay->pSource == pSource && pOverlay->Page == page)
+        {
+            return pOverlay->Data;
+        }
+    }
+
+    struct CheatOverlay* pOverlay = NULL;
+
+    for (int i = 0; i < pGB->Cheats.NumROMPatches; ++i)
+    {
+        const struct ROMPatch* pPatch = &pGB->Cheats.ROMPatches[i];
+
+        if ((pPatch->Addr >> MEM_PAGE_SHIFT) == page && PatchApplies(pPatch, pSource))
+        {
+            if (pOverlay == NULL)
+            {
+                pOverlay = AllocOverlay(pGB);
+                pOverlay->pSource = pSource;
+                pOverlay->Page = page;
+                memcpy(pOverlay->Data, pSource, MEM_PAGE_SIZE);
+            }
+
+            pOverlay->Data[pPatch->Addr & (MEM_PAGE_SIZE - 1)] = pPatch->Value;
+        }
+    }
+
+    return pOverlay != NULL ? pOverlay->Data : pSource;
+}
+
+void CheatPatchROM(struct GBInstance* pGB, uint16_t addr, int size)
+{
+    for (int i = 0; i < pGB->Cheats.NumROMPatches; ++i)
+    {
+        uint16_t patchAddr = pGB->Cheats.ROMPatches[i].Addr;
+
+        if (patchAddr >= addr && patchAddr < addr + size)
+        {
+            int page = patchAddr >> MEM_PAGE_SHIFT;
+            byte** ppPage = GetROMPageSlot(pGB, page);
+
+            //Other patches in the same page could have already done it.
+            if (*ppPage != NULL && FindOverlay(pGB, *ppPage) == NULL)
+            {
+                *ppPage = PatchPage(pGB, page, *ppPage);
+            }
+        }
+    }
+}
+
+//Puts the real ROM back and patches it again from scratch, for when the patches change.
+static void RepatchROM(struct GBInstance* pGB)
+{
+    for (int page = 0; page < (ROM_SIZE >> MEM_PAGE_SHIFT); ++page)
+    {
+        byte** ppPage = GetROMPageSlot(pGB, page);
+        struct CheatOverlay* pOverlay = FindOverlay(pGB, *ppPage);
+
+        if (pOverlay != NULL)
+        {
+            *ppPage = (byte*)pOverlay->pSource;
+        }
+    }
+
+    pGB->Cheats.NumOverlays = 0;
+
+    //The overlays are about to be reused for different code.
+    CPUFlushBlockCache(pGB);
+
+    CheatPatchROM(pGB, ROM_ADDR, ROM_SIZE);
+    CPUInvalidateFetchWindow(pGB);
+}
+
+static bool AddGameGenieCode(struct GBInstance* pGB, const byte* pDigits, bool hasCompare)
+{
+    struct ROMPatch patch;
+    patch.Value = (pDigits[0] << 4) | pDigits[1];
+
+    //The top digit of the address is inverted, and the compare value scrambled.
+    patch.Addr = ((pDigits[5] ^ 0xF) << 12) | (pDigits[2] << 8) | (pDigits[3] << 4) | pDigits[4];
+    patch.Compare = -1;
+
+    if (hasCompare)
+    {
+        byte compare = ((pDigits[6] << 4) | pDigits[8]) ^ 0xFF;
+        patch.Compare = (byte)((compare >> 2) | (compare << 6)) ^ 0x45;
+    }
+
+    if (patch.Addr >= ROM_ADDR + ROM_SIZE || pGB->Cheats.NumROMPatches == MAX_CHEATS)
+    {
+        return false;
+    }
+
+    if (pGB->Cheats.pOverlays == NULL)
+    {
+        pGB->Cheats.pOverlays = malloc(MAX_CHEAT_OVERLAYS * sizeof(struct CheatOverlay));
+
+        if (pGB->Cheats.pOverlays == NULL)
+        {
+            return false;
+        }
+    }
+
+    pGB->Cheats.ROMPatches[pGB->Cheats.NumROMPatches++] = patch;
+    RepatchROM(pGB);
+
+    return true;
+}
+
+static bool AddGameSharkCode(struct GBInstance* pGB, const byte* pDigits)
+{
+    byte type = (pDigits[0] << 4) | pDigits[1];
+
+    struct RAMPatch patch;
+    patch.Value = (pDigits[2] << 4) | pDigits[3];
+    patch.Addr = (pDigits[6] << 12) | (pDigits[7] << 8) | (pDigits[4] << 4) | pDigits[5];
+
+    //Only plain RAM, as anything else could have side effects when it's written to at VBlank. The
+    //codes for specific cartridge RAM banks (type 8x) aren't supported either.
+    bool inRAM = (patch.Addr >= CART_RAM_ADDR && patch.Addr < RAM_ADDR + RAM_SIZE) || (patch.Addr >= 0xFF80 && patch.Addr < REGISTER_IE_ADDR);
+
+    if ((type != 0x00 && type != 0x01) || !inRAM || pGB->Cheats.NumRAMPatches == MAX_CHEATS)
+    {
+        return false;
+    }
+
+    pGB->Cheats.RAMPatches[pGB->Cheats.NumRAMPatches++] = patch;
+
+    return true;
+}
+
+bool CheatAdd(struct GBInstance* pGB, const char* pCode)
+{
+    byte digits[9];
+    int numDigits = 0;
+    bool success = false;
+
+    for (const char* pChar = pCode; *pChar != '\0'; ++pChar)
+    {
+        if (*pChar == '-')
+        {
+            continue;
+        }
+
+        int digit = HexDigit(*pChar);
+
+        if (digit < 0 || numDigits == sizeof(digits))
+        {
+            numDigits = 0;
+            break;
+        }
+
+        digits[numDigits++] = (byte)digit;
+    }
+
+    if (numDigits == 6 || numDigits == 9)
+    {
+        success = AddGameGenieCode(pGB, digits, numDigits == 9);
+    }
+    else if (numDigits == 8)
+    {
+        success = AddGameSharkCode(pGB, digits);
+    }
+
+    if (!success)
+    {
+        DebugPrint("Couldn't add cheat %s!\n", pCode);
+    }
+
+    return success;
+}
+
+void CheatRemoveAll(struct GBInstance* pGB)
+{
+    pGB->Cheats.NumROMPatches = 0;
+    pGB->Cheats.NumRAMPatches = 0;
+
+    RepatchROM(pGB);
+}
+
+void CheatInit(struct GBInstance* pGB)
+{
+    //The ROM (and so anything copied from it) could be different this time.
+    pGB->Cheats.NumOverlays = 0;
+}
+
+void CheatDestroy(struct GBInstance* pGB)
+{
+    free(pGB->Cheats.pOverlays);
+    pGB->Cheats.pOverlays = NULL;
+}
+
+void CheatVBlank(struct GBInstance* pGB)
+{
+    for (int i = 0; i < pGB->Cheats.NumRAMPatches; ++i)
+    {
+        WriteMem(pGB, pGB->Cheats.RAMPatches[i].Addr, pGB->Cheats.RAMPatches[i].Value);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef CHEATS_H
+#define CHEATS_H
+
+#include "types.h"
+
+#define MAX_CHEATS 32
+
+struct GBInstance;
+struct CheatOverlay;
+
+//A Game Genie code, which changes what's read from the ROM.
+struct ROMPatch
+{
+    uint16_t Addr;
+    byte Value;
+    int Compare;    //Only patched if the ROM has this there, -1 to always patch.
+};
+
+//A GameShark code, which pokes RAM once a frame.
+struct RAMPatch
+{
+    uint16_t Addr;
+    byte Value;
+};
+
+struct CheatState
+{
+    struct ROMPatch ROMPatches[MAX_CHEATS];
+    int NumROMPatches;
+
+    struct RAMPatch RAMPatches[MAX_CHEATS];
+    int NumRAMPatches;
+
+    //Patched copies of ROM pages, only allocated once there are ROM patches.
+    struct CheatOverlay* pOverlays;
+    int NumOverlays;
+};
+
+//Takes Game Genie (ABC-DEF or ABC-DEF-GHI) and GameShark (ABCDEFGH) codes. They can be added any time
+//after SystemCreate, and stay added across SystemInit.
+bool CheatAdd(struct GBInstance* pGB, const char* pCode);
+void CheatRemoveAll(struct GBInstance* pGB);
+
+void CheatInit(struct GBInstance* pGB);
+void CheatDestroy(struct GBInstance* pGB);
+
+//Called by the memory map for every bit of the ROM it maps, to swap in patched copies of pages.
+void CheatPatchROM(struct GBInstance* pGB, uint16_t addr, int size);
+
+//Applies the RAM patches, called at the start of every VBlank.
+void CheatVBlank(struct GBInstance* pGB);
+
+#endif
@@ -1,20 +1,16 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "cpu.h"
 #include "types.h"
-#include "system.h"
+#include "instance.h"
+#include "jit.h"
+#include "utils.h"
 
 #include PLATFORM_INCLUDE(PLATFORM_NAME/platform_debug.h)
 
-static struct CPURegisters Register;
-
-static bool CPURunning;
-
-static bool IME; //Interrupt master flag.
-static byte InterruptOp[8];
-static int NumInterrupts = 0;
-
 //Operator helpers
 enum Flag
 {
@@ -31,46 +27,138 @@ enum FlagSet
     FlagSet_On = 1
 };
 
-static void SetFlag(enum Flag flag, enum FlagSet flagSet)
+//Lazy flags. Most flags get overwritten before anything looks at them so rather than working them all
+//out after every ALU op, the op and its operands are recorded and the flags are only calculated when
+//something actually reads them. While LazyOp isn't LazyFlags_None the top half of F is out of date.
+static FORCE_INLINE void SetLazyFlags(struct GBInstance* pGB, enum LazyFlagsOp op, byte result, byte lhs, byte rhs)
+{
+    pGB->CPU.LazyOp = op;
+    pGB->CPU.LazyResult = result;
+    pGB->CPU.LazyLHS = lhs;
+    pGB->CPU.LazyRHS = rhs;
+}
+
+static bool IsLazyCarrySet(struct GBInstance* pGB)
+{
+    switch (pGB->CPU.LazyOp)
+    {
+        case LazyFlags_Add: return pGB->CPU.LazyLHS + pGB->CPU.LazyRHS > 0xFF;
+        case LazyFlags_Sub: return pGB->CPU.LazyRHS > pGB->CPU.LazyLHS;
+        case LazyFlags_And:
+        case LazyFlags_Zero: return false;
+        default: return pGB->CPU.LazyCarry;
+    }
+}
+
+static void MaterialiseFlags(struct GBInstance* pGB)
 {
-    Register.F = flagSet != FlagSet_Leave ? flagSet == FlagSet_On ? Register.F | flag : Register.F & ~flag : Register.F;
+    if (pGB->CPU.LazyOp == LazyFlags_None)
+    {
+        return;
+    }
+
+    byte flags = pGB->CPU.LazyResult == 0 ? Flag_Zero : 0;
+
+    switch (pGB->CPU.LazyOp)
+    {
+        case LazyFlags_Add:
+            flags |= (pGB->CPU.LazyLHS & 0xF) + (pGB->CPU.LazyRHS & 0xF) > 0xF ? Flag_HalfCarry : 0;
+            break;
+
+        case LazyFlags_Sub:
+            flags |= Flag_Subtract;
+            flags |= (pGB->CPU.LazyLHS & 0xF) < (pGB->CPU.LazyRHS & 0xF) ? Flag_HalfCarry : 0;
+            break;
+
+        case LazyFlags_And:
+        case LazyFlags_Bit:
+            flags |= Flag_HalfCarry;
+            break;
+
+        case LazyFlags_Inc:
+            flags |= (pGB->CPU.LazyLHS & 0xF) == 0xF ? Flag_HalfCarry : 0;
+            break;
+
+        case LazyFlags_Dec:
+            flags |= Flag_Subtract;
+            flags |= (pGB->CPU.LazyLHS & 0xF) == 0 ? Flag_HalfCarry : 0;
+            break;
+
+        default:
+            break;
+    }
+
+    flags |= IsLazyCarrySet(pGB) ? Flag_Carry : 0;
+
+    //Only the top four bits are flags, the rest are left alone.
+    pGB->CPU.Register.F = (pGB->CPU.Register.F & 0x0F) | flags;
+    pGB->CPU.LazyOp = LazyFlags_None;
 }
 
-static void SetFlags(enum FlagSet zeroFlag, enum FlagSet subtractFlag, enum FlagSet halfCarryFlag, enum FlagSet carryFlag)
+static FORCE_INLINE void SetFlag(struct GBInstance* pGB, enum Flag flag, enum FlagSet flagSet)
 {
-    SetFlag(Flag_Zero, zeroFlag);
-    SetFlag(Flag_Subtract, subtractFlag);
-    SetFlag(Flag_HalfCarry, halfCarryFlag);
-    SetFlag(Flag_Carry, carryFlag);
+    pGB->CPU.Register.F = flagSet != FlagSet_Leave ? flagSet == FlagSet_On ? pGB->CPU.Register.F | flag : pGB->CPU.Register.F & ~flag : pGB->CPU.Register.F;
 }
 
-//Set the zero flag and reset all other flags
-static void SetZeroFlag(bool bOn)
+static FORCE_INLINE void SetFlags(struct GBInstance* pGB, enum FlagSet zeroFlag, enum FlagSet subtractFlag, enum FlagSet halfCarryFlag, enum FlagSet carryFlag)
 {
-    SetFlags(bOn ? FlagSet_On : FlagSet_Off, FlagSet_Off, FlagSet_Off, FlagSet_Off);
+    //Any flags that are being left need to be up to date first.
+    MaterialiseFlags(pGB);
+
+    SetFlag(pGB, Flag_Zero, zeroFlag);
+    SetFlag(pGB, Flag_Subtract, subtractFlag);
+    SetFlag(pGB, Flag_HalfCarry, halfCarryFlag);
+    SetFlag(pGB, Flag_Carry, carryFlag);
 }
 
-static bool IsFlagSet(enum Flag flag)
+static FORCE_INLINE bool IsFlagSet(struct GBInstance* pGB, enum Flag flag)
 {
-    return (Register.F & flag) == flag;
+    if (pGB->CPU.LazyOp != LazyFlags_None)
+    {
+        //Zero and carry are by far the most tested so they're worked out without materialising.
+        if (flag == Flag_Zero)
+        {
+            return pGB->CPU.LazyResult == 0;
+        }
+        else if (flag == Flag_Carry)
+        {
+            return IsLazyCarrySet(pGB);
+        }
+
+        MaterialiseFlags(pGB);
+    }
+
+    return (pGB->CPU.Register.F & flag) == flag;
 }
 
-static bool IsRegisterBitSet(const byte* pR, int bit)
+static FORCE_INLINE bool IsRegisterBitSet(const byte* pR, int bit)
 {
     return (*pR & (1 << bit)) != 0;
 }
 
-static void SetRegisterBit(byte* pR, int bit)
+static FORCE_INLINE void SetRegisterBit(byte* pR, int bit)
 {
     *pR |= (1 << bit);
 }
 
-static void UnsetRegisterBit(byte* pR, int bit)
+static FORCE_INLINE void UnsetRegisterBit(byte* pR, int bit)
 {
     *pR &= ~(1 << bit);
 }
 
-static int8_t FromTwosComplement(byte b)
+//Has to be called whenever IME, IE or IF change so that CheckInterrupts has nothing to work out.
+static void UpdatePendingInterrupts(struct GBInstance* pGB)
+{
+    pGB->CPU.PendingInterrupts = pGB->CPU.IME ? (*Register_IE(pGB) & *Register_IF(pGB) & ((1 << pGB->CPUCold.NumInterrupts) - 1)) : 0;
+}
+
+static void SetIME(struct GBInstance* pGB, bool enabled)
+{
+    pGB->CPU.IME = enabled;
+    UpdatePendingInterrupts(pGB);
+}
+
+static FORCE_INLINE int8_t FromTwosComplement(byte b)
 {
     /*if ((b & (1 << 7)) == 0)
     {
@@ -83,854 +171,851 @@ static int8_t FromTwosComplement(byte b)
     return (int8_t)b;
 }
 
-static void StackPush(uint16_t value)
+static void StackPush(struct GBInstance* pGB, uint16_t value)
 {
-    Register.SP -= 2;
-    WriteMem(Register.SP, value >> 8);
-    WriteMem(Register.SP + 1, value & 0xFF);
+    pGB->CPU.Register.SP -= 2;
+    WriteMem(pGB, pGB->CPU.Register.SP, value >> 8);
+    WriteMem(pGB, pGB->CPU.Register.SP + 1, value & 0xFF);
 }
 
-static uint16_t StackPop()
+static uint16_t StackPop(struct GBInstance* pGB)
 {
-    uint16_t val = (ReadMem(Register.SP) << 8) | ReadMem(Register.SP + 1);
-    Register.SP += 2;
+    uint16_t val = (ReadMem(pGB, pGB->CPU.Register.SP) << 8) | ReadMem(pGB, pGB->CPU.Register.SP + 1);
+    pGB->CPU.Register.SP += 2;
     return val;
 }
 
 //Operators
-static cycles Op_NOP()
+static FORCE_INLINE cycles Op_NOP(struct GBInstance* pGB)
 {
     //1 byte, 4 cycles, No flags
-    Register.PC += 1;
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static cycles Op_Halt()
+static FORCE_INLINE cycles Op_Halt(struct GBInstance* pGB)
 {
     //1 byte, 4 cycles, No flags
-    CPURunning = false;
+    pGB->CPU.Running = false;
     return 4;
 }
 
-static cycles Op_LoadImmediate8(byte* pR)
+static FORCE_INLINE cycles Op_LoadImmediate8(struct GBInstance* pGB, byte* pR, byte val)
 {
     //2 bytes, 8 cycles, No flags
-    *pR = ReadMem(Register.PC + 1);
-    Register.PC += 2;
+    *pR = val;
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static cycles Op_LoadImmediate16(uint16_t* pR)
+static FORCE_INLINE cycles Op_LoadImmediate16(struct GBInstance* pGB, uint16_t* pR, uint16_t val)
 {
     //3 bytes, 12 cycles, No flags
-    *pR = ReadMem16(Register.PC + 1);
-    Register.PC += 3;
+    *pR = val;
+    pGB->CPU.Register.PC += 3;
     return 12;
 }
 
-static cycles Op_LoadRegister8(byte* pToR, const byte* pFromR)
+static FORCE_INLINE cycles Op_LoadRegister8(struct GBInstance* pGB, byte* pToR, const byte* pFromR)
 {
     //1 byte, 4 cycles, No flags
     *pToR = *pFromR;
-    Register.PC += 1;
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static cycles Op_LoadAddrRegister(uint16_t addr, const byte* pR)
+static FORCE_INLINE cycles Op_LoadAddrRegister(struct GBInstance* pGB, uint16_t addr, const byte* pR)
 {
     //1 byte, 8 cycles, No flags
-    WriteMem(addr, *pR);
-    Register.PC += 1;
+    WriteMem(pGB, addr, *pR);
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static cycles Op_LoadRegisterAddr(byte* pR, uint16_t addr)
+static FORCE_INLINE cycles Op_LoadRegisterAddr(struct GBInstance* pGB, byte* pR, uint16_t addr)
 {
     //1 byte, 8 cycles, No flags
-    *pR = ReadMem(addr);
-    Register.PC += 1;
+    *pR = ReadMem(pGB, addr);
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static cycles Op_LoadAddrImmediate(uint16_t* pRAddr)
+static FORCE_INLINE cycles Op_LoadAddrImmediate(struct GBInstance* pGB, uint16_t* pRAddr, byte val)
 {
     //2 bytes, 12 cycles, No flags
-    byte val = ReadMem(Register.PC + 1);
-    WriteMem(*pRAddr, val);
-    Register.PC += 2;
+    WriteMem(pGB, *pRAddr, val);
+    pGB->CPU.Register.PC += 2;
     return 12;
 }
 
-static cycles Op_LoadAddrRegisterAndInc(uint16_t* pRAddr, const byte* pR)
+static FORCE_INLINE cycles Op_LoadAddrRegisterAndInc(struct GBInstance* pGB, uint16_t* pRAddr, const byte* pR)
 {
     //1 byte, 8 cycles, No flags
-    WriteMem(*pRAddr, *pR);
+    WriteMem(pGB, *pRAddr, *pR);
     (*pRAddr)++;
-    Register.PC += 1;
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static cycles Op_LoadAddrRegisterAndDec(uint16_t* pRAddr, const byte* pR)
+static FORCE_INLINE cycles Op_LoadAddrRegisterAndDec(struct GBInstance* pGB, uint16_t* pRAddr, const byte* pR)
 {
     //1 byte, 8 cycles, No flags
-    WriteMem(*pRAddr, *pR);
+    WriteMem(pGB, *pRAddr, *pR);
     (*pRAddr)--;
-    Register.PC += 1;
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static cycles Op_LoadRegisterAddrAndInc(byte* pR, uint16_t* pRAddr)
+static FORCE_INLINE cycles Op_LoadRegisterAddrAndInc(struct GBInstance* pGB, byte* pR, uint16_t* pRAddr)
 {
     //1 byte, 8 cycles, No flags
-    *pR = ReadMem(*pRAddr);
+    *pR = ReadMem(pGB, *pRAddr);
     (*pRAddr)++;
-    Register.PC += 1;
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static cycles Op_LoadRegisterAddrAndDec(byte* pR, uint16_t* pRAddr)
+static FORCE_INLINE cycles Op_LoadRegisterAddrAndDec(struct GBInstance* pGB, byte* pR, uint16_t* pRAddr)
 {
     //1 byte, 8 cycles, No flags
-    *pR = ReadMem(*pRAddr);
+    *pR = ReadMem(pGB, *pRAddr);
     (*pRAddr)--;
-    Register.PC += 1;
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static cycles Op_LoadImmediateAddr8FromA()
+static FORCE_INLINE cycles Op_LoadImmediateAddr8FromA(struct GBInstance* pGB, byte addrLow)
 {
     //2 bytes, 12 cycles, No flags
-    uint16_t addr = 0xFF00 + ReadMem(Register.PC + 1);
-    WriteMem(addr, Register.A);
-    Register.PC += 2;
+    uint16_t addr = 0xFF00 + addrLow;
+    WriteMem(pGB, addr, pGB->CPU.Register.A);
+    pGB->CPU.Register.PC += 2;
     return 12;
 }
 
-static cycles Op_LoadAFromImmediateAddr8()
+static FORCE_INLINE cycles Op_LoadAFromImmediateAddr8(struct GBInstance* pGB, byte addrLow)
 {
     //2 bytes, 12 cycles, No flags
-    uint16_t addr = 0xFF00 + ReadMem(Register.PC + 1);
-    Register.A = ReadMem(addr);
-    Register.PC += 2;
+    uint16_t addr = 0xFF00 + addrLow;
+    pGB->CPU.Register.A = ReadMem(pGB, addr);
+    pGB->CPU.Register.PC += 2;
     return 12;
 }
 
-static cycles Op_LoadImmediateAddr16FromA()
+static FORCE_INLINE cycles Op_LoadImmediateAddr16FromA(struct GBInstance* pGB, uint16_t addr)
 {
     //3 bytes, 16 cycles, No flags
-    uint16_t addr = ReadMem16(Register.PC + 1);
-    WriteMem(addr, Register.A);
-    Register.PC += 3;
+    WriteMem(pGB, addr, pGB->CPU.Register.A);
+    pGB->CPU.Register.PC += 3;
     return 16;
 }
 
-static cycles Op_LoadAFromImmediateAddr16()
+static FORCE_INLINE cycles Op_LoadAFromImmediateAddr16(struct GBInstance* pGB, uint16_t addr)
 {
     //3 bytes, 16 cycles, No flags
-    uint16_t addr = ReadMem16(Register.PC + 1);
-    Register.A = ReadMem(addr);
-    Register.PC += 3;
+    pGB->CPU.Register.A = ReadMem(pGB, addr);
+    pGB->CPU.Register.PC += 3;
     return 16;
 }
 
-static cycles Op_Push(const uint16_t* pR)
+static FORCE_INLINE cycles Op_Push(struct GBInstance* pGB, const uint16_t* pR)
 {
     //1 byte, 16 cycles, No flags
-    StackPush(*pR);
-    Register.PC += 1;
+    if (pR == &pGB->CPU.Register.AF)
+    {
+        MaterialiseFlags(pGB);
+    }
+
+    StackPush(pGB, *pR);
+    pGB->CPU.Register.PC += 1;
     return 16;
 }
 
-static cycles Op_Pop(uint16_t* pR)
+static FORCE_INLINE cycles Op_Pop(struct GBInstance* pGB, uint16_t* pR)
 {
     //1 byte, 12 cycles, No flags
-    *pR = StackPop();
-    Register.PC += 1;
-    return 16;
-}
+    *pR = StackPop(pGB);
 
-static void DoCompare(byte val)
-{
-    if (Register.A == val)
+    if (pR == &pGB->CPU.Register.AF)
     {
-        SetFlags(FlagSet_On, FlagSet_On, FlagSet_Off, FlagSet_Off);
+        //F has just been replaced wholesale.
+        pGB->CPU.LazyOp = LazyFlags_None;
     }
-    else
-    {
-        bool carry = Register.A < val;
-        bool halfCarry = (int)(Register.A & 0xF) - (int)(val & 0xF) < 0;
 
-        SetFlags(FlagSet_Off, FlagSet_On, halfCarry ? FlagSet_On : FlagSet_Off, carry ? FlagSet_On : FlagSet_Off);
-    }
+    pGB->CPU.Register.PC += 1;
+    return 16;
+}
+
+static FORCE_INLINE void DoCompare(struct GBInstance* pGB, byte val)
+{
+    //Same flags as a subtract, the result just isn't kept.
+    SetLazyFlags(pGB, LazyFlags_Sub, pGB->CPU.Register.A - val, pGB->CPU.Register.A, val);
 }
 
-static cycles Op_CompareRegister(const byte* pR)
+static FORCE_INLINE cycles Op_CompareRegister(struct GBInstance* pGB, const byte* pR)
 {
     //1 byte, 4 cycles, Flags Z1HC
-    DoCompare(*pR);
-    Register.PC += 1;
+    DoCompare(pGB, *pR);
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static cycles Op_CompareAddr()
+static FORCE_INLINE cycles Op_CompareAddr(struct GBInstance* pGB)
 {
     //1 byte, 8 cycles, Flags Z1HC
-    byte val = ReadMem(Register.HL);
-    DoCompare(val);
-    Register.PC += 1;
+    byte val = ReadMem(pGB, pGB->CPU.Register.HL);
+    DoCompare(pGB, val);
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static cycles Op_CompareImmediate()
+static FORCE_INLINE cycles Op_CompareImmediate(struct GBInstance* pGB, byte val)
 {
     //2 bytes, 8 cycles, Flags Z1HC
-    byte val = ReadMem(Register.PC + 1);
-    DoCompare(val);
-    Register.PC += 2;
+    DoCompare(pGB, val);
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static void DoAnd(byte val)
+static FORCE_INLINE void DoAnd(struct GBInstance* pGB, byte val)
 {
-    Register.A &= val;
-    SetFlags(Register.A == 0 ? FlagSet_On : FlagSet_Off, FlagSet_Off, FlagSet_On, FlagSet_Off);
+    pGB->CPU.Register.A &= val;
+    SetLazyFlags(pGB, LazyFlags_And, pGB->CPU.Register.A, 0, 0);
 }
 
-static cycles Op_AndRegister(byte* pR)
+static FORCE_INLINE cycles Op_AndRegister(struct GBInstance* pGB, byte* pR)
 {
     //1 byte, 4 cycles, Flags Z010
-    DoAnd(*pR);
-    Register.PC += 1;
+    DoAnd(pGB, *pR);
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static cycles Op_AndAddr()
+static FORCE_INLINE cycles Op_AndAddr(struct GBInstance* pGB)
 {
     //1 byte, 8 cycles, Flags Z010
-    byte val = ReadMem(Register.HL);
-    DoAnd(val);
-    Register.PC += 1;
+    byte val = ReadMem(pGB, pGB->CPU.Register.HL);
+    DoAnd(pGB, val);
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static cycles Op_AndImmediate()
+static FORCE_INLINE cycles Op_AndImmediate(struct GBInstance* pGB, byte val)
 {
     //2 bytes, 8 cycles, Flags Z010
-    byte val = ReadMem(Register.PC + 1);
-    DoAnd(val);
-    Register.PC += 2;
+    DoAnd(pGB, val);
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static void DoOr(byte val)
+static FORCE_INLINE void DoOr(struct GBInstance* pGB, byte val)
 {
-    Register.A |= val;
-    SetZeroFlag(Register.A == 0);
+    pGB->CPU.Register.A |= val;
+    SetLazyFlags(pGB, LazyFlags_Zero, pGB->CPU.Register.A, 0, 0);
 }
 
-static cycles Op_OrRegister(byte* pR)
+static FORCE_INLINE cycles Op_OrRegister(struct GBInstance* pGB, byte* pR)
 {
     //1 byte, 4 cycles, Flags Z000
-    DoOr(*pR);
-    Register.PC += 1;
+    DoOr(pGB, *pR);
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static cycles Op_OrAddr()
+static FORCE_INLINE cycles Op_OrAddr(struct GBInstance* pGB)
 {
     //1 byte, 8 cycles, Flags Z000
-    byte val = ReadMem(Register.HL);
-    DoOr(val);
-    Register.PC += 1;
+    byte val = ReadMem(pGB, pGB->CPU.Register.HL);
+    DoOr(pGB, val);
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static cycles Op_OrImmediate()
+static FORCE_INLINE cycles Op_OrImmediate(struct GBInstance* pGB, byte val)
 {
     //2 bytes, 8 cycles, Flags Z000
-    byte val = ReadMem(Register.PC + 1);
-    DoOr(val);
-    Register.PC += 2;
+    DoOr(pGB, val);
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static void DoXor(byte val)
+static FORCE_INLINE void DoXor(struct GBInstance* pGB, byte val)
 {
-    Register.A ^= val;
-    SetZeroFlag(Register.A == 0);
+    pGB->CPU.Register.A ^= val;
+    SetLazyFlags(pGB, LazyFlags_Zero, pGB->CPU.Register.A, 0, 0);
 }
 
-static cycles Op_XorRegister(byte* pR)
+static FORCE_INLINE cycles Op_XorRegister(struct GBInstance* pGB, byte* pR)
 {
     //1 byte, 4 cycles, Flags Z000
-    DoXor(*pR);
-    Register.PC += 1;
+    DoXor(pGB, *pR);
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static cycles Op_XorAddr()
+static FORCE_INLINE cycles Op_XorAddr(struct GBInstance* pGB)
 {
     //1 byte, 8 cycles, Flags Z000
-    byte val = ReadMem(Register.HL);
-    DoXor(val);
-    Register.PC += 1;
+    byte val = ReadMem(pGB, pGB->CPU.Register.HL);
+    DoXor(pGB, val);
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static cycles Op_XorImmediate()
+static FORCE_INLINE cycles Op_XorImmediate(struct GBInstance* pGB, byte val)
 {
     //2 bytes, 8 cycles, Flags Z000
-    byte val = ReadMem(Register.PC + 1);
-    DoXor(val);
-    Register.PC += 2;
+    DoXor(pGB, val);
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static cycles Op_Complement()
+static FORCE_INLINE cycles Op_Complement(struct GBInstance* pGB)
 {
     //1 byte, 4 cycles, Flags -11-
-    Register.A = ~Register.A;
-    SetFlags(FlagSet_Leave, FlagSet_On, FlagSet_On, FlagSet_Leave);
-    Register.PC += 1;
+    pGB->CPU.Register.A = ~pGB->CPU.Register.A;
+    SetFlags(pGB, FlagSet_Leave, FlagSet_On, FlagSet_On, FlagSet_Leave);
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static cycles Op_DecimalAdjust()
+static FORCE_INLINE cycles Op_DecimalAdjust(struct GBInstance* pGB)
 {
     //1 byte, 4 cycles, Flags Z-0C
     bool carryFlag = false;
 
-    if (!IsFlagSet(Flag_Subtract))
+    if (!IsFlagSet(pGB, Flag_Subtract))
     {
-        if (IsFlagSet(Flag_Carry) || Register.A > 0x99)
+        if (IsFlagSet(pGB, Flag_Carry) || pGB->CPU.Register.A > 0x99)
         {
-            Register.A += 0x60;
+            pGB->CPU.Register.A += 0x60;
             carryFlag = true;
         }
 
-        if (IsFlagSet(Flag_HalfCarry) || (Register.A & 0x0F) > 0x09)
+        if (IsFlagSet(pGB, Flag_HalfCarry) || (pGB->CPU.Register.A & 0x0F) > 0x09)
         {
-            Register.A += 0x6;
+            pGB->CPU.Register.A += 0x6;
         }
     }
     else
     {
-        if (IsFlagSet(Flag_Carry))
+        if (IsFlagSet(pGB, Flag_Carry))
         {
-            Register.A -= 0x60;
+            pGB->CPU.Register.A -= 0x60;
         }
 
-        if (IsFlagSet(Flag_HalfCarry))
+        if (IsFlagSet(pGB, Flag_HalfCarry))
         {
-            Register.A -= 0x6;
+            pGB->CPU.Register.A -= 0x6;
         }
     }
 
-    SetFlags(Register.A == 0 ? FlagSet_On : FlagSet_Off, FlagSet_Leave, FlagSet_Off, carryFlag ? FlagSet_On : FlagSet_Off);
-    Register.PC += 1;
+    SetFlags(pGB, pGB->CPU.Register.A == 0 ? FlagSet_On : FlagSet_Off, FlagSet_Leave, FlagSet_Off, carryFlag ? FlagSet_On : FlagSet_Off);
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static void DoIncrement8(byte* pR)
+static FORCE_INLINE void DoIncrement8(struct GBInstance* pGB, byte* pR)
 {
-    //In this case we can just check if the bottom four bits are set because increasing by one will carry.
-    bool halfCarry = ((*pR & 0xF) == 0xF);
+    //The half carry is worked out from the original value when it's needed.
+    pGB->CPU.LazyCarry = IsFlagSet(pGB, Flag_Carry);
+    byte original = *pR;
     (*pR)++;
-    SetFlags(*pR == 0 ? FlagSet_On : FlagSet_Off, FlagSet_Off, halfCarry ? FlagSet_On : FlagSet_Off, FlagSet_Leave);
+    SetLazyFlags(pGB, LazyFlags_Inc, *pR, original, 0);
 }
 
-static cycles Op_Increment8(byte* pR)
+static FORCE_INLINE cycles Op_Increment8(struct GBInstance* pGB, byte* pR)
 {
     //1 byte, 4 cycles, Flags Z0H-
-    DoIncrement8(pR);
-    Register.PC += 1;
+    DoIncrement8(pGB, pR);
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static cycles Op_IncrementAddr(uint16_t addr)
+static FORCE_INLINE cycles Op_IncrementAddr(struct GBInstance* pGB, uint16_t addr)
 {
     //1 byte, 12 cycles, Flags Z0H-
-    byte val = ReadMem(addr);
-    DoIncrement8(&val);
-    WriteMem(addr, val);
-    Register.PC += 1;
+    byte val = ReadMem(pGB, addr);
+    DoIncrement8(pGB, &val);
+    WriteMem(pGB, addr, val);
+    pGB->CPU.Register.PC += 1;
     return 12;
 }
 
-static cycles Op_Increment16(uint16_t* pR)
+static FORCE_INLINE cycles Op_Increment16(struct GBInstance* pGB, uint16_t* pR)
 {
     //1 byte, 8 cycles, No flags
     (*pR)++;
-    Register.PC += 1;
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static void DoDecrement8(byte* pR)
+static FORCE_INLINE void DoDecrement8(struct GBInstance* pGB, byte* pR)
 {
-    //In this case we can just check if the bottom four bits are unset because decreasing by one will carry.
-    bool halfCarry = ((*pR & 0xF) == 0x0);
+    //The half carry is worked out from the original value when it's needed.
+    pGB->CPU.LazyCarry = IsFlagSet(pGB, Flag_Carry);
+    byte original = *pR;
     (*pR)--;
-    SetFlags(*pR == 0 ? FlagSet_On : FlagSet_Off, FlagSet_On, halfCarry ? FlagSet_On : FlagSet_Off, FlagSet_Leave);
+    SetLazyFlags(pGB, LazyFlags_Dec, *pR, original, 0);
 }
 
-static cycles Op_Decrement8(byte* pR)
+static FORCE_INLINE cycles Op_Decrement8(struct GBInstance* pGB, byte* pR)
 {
     //1 byte, 4 cycles, Flags Z1H-
-    DoDecrement8(pR);
-    Register.PC += 1;
+    DoDecrement8(pGB, pR);
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static cycles Op_DecrementAddr(uint16_t addr)
+static FORCE_INLINE cycles Op_DecrementAddr(struct GBInstance* pGB, uint16_t addr)
 {
     //1 byte, 12 cycles, Flags Z1H-
-    byte val = ReadMem(addr);
-    DoDecrement8(&val);
-    WriteMem(addr, val);
-    Register.PC += 1;
+    byte val = ReadMem(pGB, addr);
+    DoDecrement8(pGB, &val);
+    WriteMem(pGB, addr, val);
+    pGB->CPU.Register.PC += 1;
     return 12;
 }
 
-static cycles Op_Decrement16(uint16_t* pR)
+static FORCE_INLINE cycles Op_Decrement16(struct GBInstance* pGB, uint16_t* pR)
 {
     //1 byte, 8 cycles, No flags
     (*pR)--;
-    Register.PC += 1;
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static void DoAdd(byte val, bool plusCarry)
+static FORCE_INLINE void DoAdd(struct GBInstance* pGB, byte val, bool plusCarry)
 {
-    if (plusCarry && IsFlagSet(Flag_Carry))
+    if (plusCarry && IsFlagSet(pGB, Flag_Carry))
     {
         val++;
     }
 
-    bool halfCarry = (Register.A & 0xF) + (val & 0xF) > 0xF;
-    bool carry = (Register.A + val) > 0xFF;
-    Register.A = FromTwosComplement(Register.A) + FromTwosComplement(val);
-    SetFlags(Register.A == 0 ? FlagSet_On : FlagSet_Off, FlagSet_Off, halfCarry ? FlagSet_On : FlagSet_Off, carry ? FlagSet_On : FlagSet_Off);
+    byte original = pGB->CPU.Register.A;
+    pGB->CPU.Register.A = FromTwosComplement(pGB->CPU.Register.A) + FromTwosComplement(val);
+    SetLazyFlags(pGB, LazyFlags_Add, pGB->CPU.Register.A, original, val);
 }
 
-static cycles Op_AddRegister(const byte* pR, bool plusCarry)
+static FORCE_INLINE cycles Op_AddRegister(struct GBInstance* pGB, const byte* pR, bool plusCarry)
 {
     //1 byte, 4 cycles, Flags Z0HC
-    DoAdd(*pR, plusCarry);
-    Register.PC += 1;
+    DoAdd(pGB, *pR, plusCarry);
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static cycles Op_AddAddr(bool plusCarry)
+static FORCE_INLINE cycles Op_AddAddr(struct GBInstance* pGB, bool plusCarry)
 {
     //1 byte, 8 cycles, Flags Z0HC
-    byte val = ReadMem(Register.HL);
-    DoAdd(val, plusCarry);
-    Register.PC += 1;
+    byte val = ReadMem(pGB, pGB->CPU.Register.HL);
+    DoAdd(pGB, val, plusCarry);
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static cycles Op_AddImmediate(bool plusCarry)
+static FORCE_INLINE cycles Op_AddImmediate(struct GBInstance* pGB, byte val, bool plusCarry)
 {
     //2 bytes, 8 cycles, Flags Z0HC
-    byte val = ReadMem(Register.PC + 1);
-    DoAdd(val, plusCarry);
-    Register.PC += 2;
+    DoAdd(pGB, val, plusCarry);
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static cycles Op_AddHLRegister16(const uint16_t* pR)
+static FORCE_INLINE cycles Op_AddHLRegister16(struct GBInstance* pGB, const uint16_t* pR)
 {
     //1 byte, 8 cycles, Flags -0CH
-    bool halfCarry = (Register.HL & 0xFF) + (*pR & 0xFF) > 0xFF;
-    bool carry = (Register.HL + *pR) > 0xFFFF;
-    Register.HL += *pR;
-    SetFlags(FlagSet_Leave, FlagSet_Off, halfCarry ? FlagSet_On : FlagSet_Off, carry ? FlagSet_On : FlagSet_Off);
-    Register.PC += 1;
+    bool halfCarry = (pGB->CPU.Register.HL & 0xFF) + (*pR & 0xFF) > 0xFF;
+    bool carry = (pGB->CPU.Register.HL + *pR) > 0xFFFF;
+    pGB->CPU.Register.HL += *pR;
+    SetFlags(pGB, FlagSet_Leave, FlagSet_Off, halfCarry ? FlagSet_On : FlagSet_Off, carry ? FlagSet_On : FlagSet_Off);
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static void DoSubtract(byte val, bool plusCarry)
+static FORCE_INLINE void DoSubtract(struct GBInstance* pGB, byte val, bool plusCarry)
 {
-    if (plusCarry && IsFlagSet(Flag_Carry))
+    if (plusCarry && IsFlagSet(pGB, Flag_Carry))
     {
         val++;
     }
 
-    bool halfCarry = (int)(Register.A & 0xf) - (int)(val & 0xf) < 0;
-    bool carry = val > Register.A;
+    byte original = pGB->CPU.Register.A;
     //Register.A = FromTwosComplement(Register.A) - FromTwosComplement(val);    Don't need to do this.
-    Register.A -= val;
-    SetFlags(Register.A == 0 ? FlagSet_On : FlagSet_Off, FlagSet_On, halfCarry ? FlagSet_On : FlagSet_Off, carry ? FlagSet_On : FlagSet_Off);
+    pGB->CPU.Register.A -= val;
+    SetLazyFlags(pGB, LazyFlags_Sub, pGB->CPU.Register.A, original, val);
 }
 
-static cycles Op_SubtractRegister(const byte* pR, bool plusCarry)
+static FORCE_INLINE cycles Op_SubtractRegister(struct GBInstance* pGB, const byte* pR, bool plusCarry)
 {
     //1 byte, 4 cycles, Flags Z1HC
-    DoSubtract(*pR, plusCarry);
-    Register.PC += 1;
+    DoSubtract(pGB, *pR, plusCarry);
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static cycles Op_SubtractAddr(bool plusCarry)
+static FORCE_INLINE cycles Op_SubtractAddr(struct GBInstance* pGB, bool plusCarry)
 {
     //1 byte, 8 cycles, Flags Z1HC
-    byte val = ReadMem(Register.HL);
-    DoSubtract(val, plusCarry);
-    Register.PC += 1;
+    byte val = ReadMem(pGB, pGB->CPU.Register.HL);
+    DoSubtract(pGB, val, plusCarry);
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static cycles Op_SubtractImmediate(bool plusCarry)
+static FORCE_INLINE cycles Op_SubtractImmediate(struct GBInstance* pGB, byte val, bool plusCarry)
 {
     //2 bytes, 8 cycles, Flags Z1HC
-    byte val = ReadMem(Register.PC + 1);
-    DoSubtract(val, plusCarry);
-    Register.PC += 2;
+    DoSubtract(pGB, val, plusCarry);
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static cycles Op_Jump()
+static FORCE_INLINE cycles Op_Jump(struct GBInstance* pGB, byte val)
 {
     //2 bytes, 12 cycles, No flags
-    byte val = ReadMem(Register.PC + 1);
     int8_t jumpAmount = FromTwosComplement(val);
-    Register.PC += (2 + jumpAmount);
+    pGB->CPU.Register.PC += (2 + jumpAmount);
     return 12;
 }
 
-static cycles Op_JumpAddr()
+static FORCE_INLINE cycles Op_JumpAddr(struct GBInstance* pGB, uint16_t addr)
 {
     //3 bytes, 16 cycles, No flags
-    Register.PC = ReadMem16(Register.PC + 1);
+    pGB->CPU.Register.PC = addr;
     return 16;
 }
 
-static cycles Op_JumpRegister(const uint16_t* pR)
+static FORCE_INLINE cycles Op_JumpRegister(struct GBInstance* pGB, const uint16_t* pR)
 {
     //1 byte, 4 cycles, No flags
-    Register.PC = *pR;
+    pGB->CPU.Register.PC = *pR;
     return 4;
 }
 
-static cycles Op_JumpIf(enum Flag flag, bool ifTrue)
+static FORCE_INLINE cycles Op_JumpIf(struct GBInstance* pGB, enum Flag flag, bool ifTrue, byte val)
 {
     //2 bytes, 12/8 cycles, No flags
-    byte val = ReadMem(Register.PC + 1);
     int8_t jumpAmount = FromTwosComplement(val);
-    Register.PC += 2;
+    pGB->CPU.Register.PC += 2;
 
-    if (ifTrue == IsFlagSet(flag))
+    if (ifTrue == IsFlagSet(pGB, flag))
     {
-        Register.PC += jumpAmount;
+        pGB->CPU.Register.PC += jumpAmount;
         return 12;
     }
     
     return 8;
 }
 
-static cycles Op_JumpAddrIf(enum Flag flag, bool ifTrue)
+static FORCE_INLINE cycles Op_JumpAddrIf(struct GBInstance* pGB, enum Flag flag, bool ifTrue, uint16_t addr)
 {
     //3 bytes, 16/12 cycles, No flags
-    if (ifTrue == IsFlagSet(flag))
+    if (ifTrue == IsFlagSet(pGB, flag))
     {
-        Register.PC = ReadMem16(Register.PC + 1);
+        pGB->CPU.Register.PC = addr;
         return 16;
     }
 
-    Register.PC += 3;
+    pGB->CPU.Register.PC += 3;
     return 12;
 }
 
-static cycles Op_Call()
+static FORCE_INLINE cycles Op_Call(struct GBInstance* pGB, uint16_t addr)
 {
     //3 bytes, 24 cycles, No flags
-    StackPush(Register.PC + 3);
-    Register.PC = ReadMem16(Register.PC + 1);
+    StackPush(pGB, pGB->CPU.Register.PC + 3);
+    pGB->CPU.Register.PC = addr;
     return 24;
 }
 
-static cycles Op_CallIf(enum Flag flag, bool ifTrue)
+static FORCE_INLINE cycles Op_CallIf(struct GBInstance* pGB, enum Flag flag, bool ifTrue, uint16_t addr)
 {
     //3 bytes, 24/12 cycles, No flags
-    if (ifTrue == IsFlagSet(flag))
+    if (ifTrue == IsFlagSet(pGB, flag))
     {
-        StackPush(Register.PC + 3);
-        Register.PC = ReadMem16(Register.PC + 1);
+        StackPush(pGB, pGB->CPU.Register.PC + 3);
+        pGB->CPU.Register.PC = addr;
         return 24;
     }
 
-    Register.PC += 3;
+    pGB->CPU.Register.PC += 3;
     return 12;
 }
 
-static cycles Op_DisableInterrupts()
+static FORCE_INLINE cycles Op_DisableInterrupts(struct GBInstance* pGB)
 {
     //1 byte, 4 cycles, No flags
-    Register.PC += 1;
-    IME = false;
+    pGB->CPU.Register.PC += 1;
+    SetIME(pGB, false);
     return 4;
 }
 
-static cycles Op_EnableInterrupts()
+static FORCE_INLINE cycles Op_EnableInterrupts(struct GBInstance* pGB)
 {
     //1 byte, 4 cycles, No flags
-    Register.PC += 1;
-    IME = true;
+    pGB->CPU.Register.PC += 1;
+    SetIME(pGB, true);
     return 4;
 }
 
-static cycles Op_Return()
+static FORCE_INLINE cycles Op_Return(struct GBInstance* pGB)
 {
     //1 byte, 16 cycles, No flags
-    Register.PC = StackPop();
+    pGB->CPU.Register.PC = StackPop(pGB);
     return 16;
 }
 
-static cycles Op_ReturnIf(enum Flag flag, bool ifTrue)
+static FORCE_INLINE cycles Op_ReturnIf(struct GBInstance* pGB, enum Flag flag, bool ifTrue)
 {
     //2 bytes, 12/8 cycles, No flags
-    if (ifTrue == IsFlagSet(flag))
+    if (ifTrue == IsFlagSet(pGB, flag))
     {
-        Register.PC = StackPop();
+        pGB->CPU.Register.PC = StackPop(pGB);
         return 20;
     }
 
-    Register.PC += 1;
+    pGB->CPU.Register.PC += 1;
     return 8;
 }
 
-static cycles Op_EnableInterruptsAndReturn()
+static FORCE_INLINE cycles Op_EnableInterruptsAndReturn(struct GBInstance* pGB)
 {
     //1 byte, 16 cycles, No flags
-    IME = true;
-    Register.PC = StackPop();
+    SetIME(pGB, true);
+    pGB->CPU.Register.PC = StackPop(pGB);
     return 16;
 }
 
-static cycles Op_Swap(byte* pR)
+static FORCE_INLINE cycles Op_Swap(struct GBInstance* pGB, byte* pR)
 {
     //2 bytes, 8 cycles, Flags Z000
     *pR = ((*pR & 0xF) << 4) | ((*pR & 0xF0) >> 4);
-    SetZeroFlag(*pR == 0);
-    Register.PC += 2;
+    SetLazyFlags(pGB, LazyFlags_Zero, *pR, 0, 0);
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static cycles Op_SetRegisterBit(byte* pR, byte bit)
+static FORCE_INLINE cycles Op_SetRegisterBit(struct GBInstance* pGB, byte* pR, byte bit)
 {
     //2 bytes, 8 cycles, No flags
     *pR |= (1 << bit);
-    Register.PC += 2;
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static cycles Op_SetAddrBit(uint16_t addr, byte bit)
+static FORCE_INLINE cycles Op_SetAddrBit(struct GBInstance* pGB, uint16_t addr, byte bit)
 {
     //2 bytes, 16 cycles, No flags
-    byte val = ReadMem(addr);
+    byte val = ReadMem(pGB, addr);
     val |= (1 << bit);
-    WriteMem(addr, val);
-    Register.PC += 2;
+    WriteMem(pGB, addr, val);
+    pGB->CPU.Register.PC += 2;
     return 16;
 }
 
-static cycles Op_TestRegisterBit(const byte* pR, byte bit)
+static FORCE_INLINE cycles Op_TestRegisterBit(struct GBInstance* pGB, const byte* pR, byte bit)
 {
     //2 bytes, 8 cycles, Flags Z01-
-    bool bitZero = (*pR & (1 << bit)) == 0;
-    SetFlags(bitZero ? FlagSet_On : FlagSet_Off, FlagSet_Off, FlagSet_On, FlagSet_Leave);
-    Register.PC += 2;
+    pGB->CPU.LazyCarry = IsFlagSet(pGB, Flag_Carry);
+    SetLazyFlags(pGB, LazyFlags_Bit, *pR & (1 << bit), 0, 0);
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static cycles Op_TestAddrBit(uint16_t addr, byte bit)
+static FORCE_INLINE cycles Op_TestAddrBit(struct GBInstance* pGB, uint16_t addr, byte bit)
 {
     //2 bytes, 12 cycles, Flags Z01-
-    byte val = ReadMem(addr);
-    bool bitZero = (val & (1 << bit)) == 0;
-    SetFlags(bitZero ? FlagSet_On : FlagSet_Off, FlagSet_Off, FlagSet_On, FlagSet_Leave);
-    Register.PC += 2;
+    byte val = ReadMem(pGB, addr);
+    pGB->CPU.LazyCarry = IsFlagSet(pGB, Flag_Carry);
+    SetLazyFlags(pGB, LazyFlags_Bit, val & (1 << bit), 0, 0);
+    pGB->CPU.Register.PC += 2;
     return 12;
 }
 
-static cycles Op_ResetRegisterBit(byte* pR, byte bit)
+static FORCE_INLINE cycles Op_ResetRegisterBit(struct GBInstance* pGB, byte* pR, byte bit)
 {
     //2 bytes, 8 cycles, No flags
     UnsetRegisterBit(pR, bit);
-    Register.PC += 2;
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static cycles Op_ResetAddrBit(uint16_t addr, byte bit)
+static FORCE_INLINE cycles Op_ResetAddrBit(struct GBInstance* pGB, uint16_t addr, byte bit)
 {
     //2 bytes, 16 cycles, No flags
-    byte val = ReadMem(addr);
+    byte val = ReadMem(pGB, addr);
     UnsetRegisterBit(&val, bit);
-    WriteMem(addr, val);
-    Register.PC += 2;
+    WriteMem(pGB, addr, val);
+    pGB->CPU.Register.PC += 2;
     return 16;
 }
 
-void DoRotateLeftWithCarry(byte* pR)
+static FORCE_INLINE void DoRotateLeftWithCarry(struct GBInstance* pGB, byte* pR)
 {
     bool bit7 = *pR >> 7;
     *pR = ((*pR << 1) | bit7);
-    SetFlags(*pR == 0 ? FlagSet_On : FlagSet_Off, FlagSet_Off, FlagSet_Off, bit7 ? FlagSet_On : FlagSet_Off);
+    pGB->CPU.LazyCarry = bit7;
+    SetLazyFlags(pGB, LazyFlags_Shift, *pR, 0, 0);
 }
 
-static cycles Op_RotateRegisterLeftWithCarry(byte* pR)
+static FORCE_INLINE cycles Op_RotateRegisterLeftWithCarry(struct GBInstance* pGB, byte* pR)
 {
     //2 bytes, 8 cycles, Flags Z00C
-    DoRotateLeftWithCarry(pR);
-    Register.PC += 2;
+    DoRotateLeftWithCarry(pGB, pR);
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static cycles Op_RotateAddrLeftWithCarry(uint16_t addr)
+static FORCE_INLINE cycles Op_RotateAddrLeftWithCarry(struct GBInstance* pGB, uint16_t addr)
 {
     //2 bytes, 16 cycles, Flags Z00C
-    byte val = ReadMem(addr);
-    DoRotateLeftWithCarry(&val);
-    WriteMem(addr, val);
-    Register.PC += 2;
+    byte val = ReadMem(pGB, addr);
+    DoRotateLeftWithCarry(pGB, &val);
+    WriteMem(pGB, addr, val);
+    pGB->CPU.Register.PC += 2;
     return 16;
 }
 
-void DoRotateLeftThroughCarry(byte* pR)
+static FORCE_INLINE void DoRotateLeftThroughCarry(struct GBInstance* pGB, byte* pR)
 {
     bool bit7 = *pR >> 7;
-    *pR = ((*pR << 1) | IsFlagSet(Flag_Carry));
-    SetFlags(*pR == 0 ? FlagSet_On : FlagSet_Off, FlagSet_Off, FlagSet_Off, bit7 ? FlagSet_On : FlagSet_Off);
+    *pR = ((*pR << 1) | IsFlagSet(pGB, Flag_Carry));
+    pGB->CPU.LazyCarry = bit7;
+    SetLazyFlags(pGB, LazyFlags_Shift, *pR, 0, 0);
 }
 
-static cycles Op_RotateRegisterLeftThroughCarry(byte* pR)
+static FORCE_INLINE cycles Op_RotateRegisterLeftThroughCarry(struct GBInstance* pGB, byte* pR)
 {
     //2 bytes, 8 cycles, Flags Z00C
-    DoRotateLeftThroughCarry(pR);
-    Register.PC += 2;
+    DoRotateLeftThroughCarry(pGB, pR);
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static cycles Op_RotateAddrLeftThroughCarry(uint16_t addr)
+static FORCE_INLINE cycles Op_RotateAddrLeftThroughCarry(struct GBInstance* pGB, uint16_t addr)
 {
     //2 bytes, 16 cycles, Flags Z00C
-    byte val = ReadMem(addr);
-    DoRotateLeftThroughCarry(&val);
-    WriteMem(addr, val);
-    Register.PC += 2;
+    byte val = ReadMem(pGB, addr);
+    DoRotateLeftThroughCarry(pGB, &val);
+    WriteMem(pGB, addr, val);
+    pGB->CPU.Register.PC += 2;
     return 16;
 }
 
 //Same as above but only works with register A and shorter as they're not used from extended opcodes.
-static cycles Op_RotateRegisterLeftWithCarryA()
+static FORCE_INLINE cycles Op_RotateRegisterLeftWithCarryA(struct GBInstance* pGB)
 {
     //1 byte, 4 cycles, Flags Z00C
-    DoRotateLeftWithCarry(&Register.A);
-    Register.PC += 1;
+    DoRotateLeftWithCarry(pGB, &pGB->CPU.Register.A);
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static cycles Op_RotateRegisterLeftThroughCarryA()
+static FORCE_INLINE cycles Op_RotateRegisterLeftThroughCarryA(struct GBInstance* pGB)
 {
     //1 byte, 4 cycles, Flags Z00C
-    DoRotateLeftThroughCarry(&Register.A);
-    Register.PC += 1;
+    DoRotateLeftThroughCarry(pGB, &pGB->CPU.Register.A);
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-void DoRotateRightWithCarry(byte* pR)
+static FORCE_INLINE void DoRotateRightWithCarry(struct GBInstance* pGB, byte* pR)
 {
     bool bit0 = *pR & 0x1;
     *pR = ((*pR >> 1) | (bit0 << 7));
-    SetFlags(*pR == 0 ? FlagSet_On : FlagSet_Off, FlagSet_Off, FlagSet_Off, bit0 ? FlagSet_On : FlagSet_Off);
+    pGB->CPU.LazyCarry = bit0;
+    SetLazyFlags(pGB, LazyFlags_Shift, *pR, 0, 0);
 }
 
-static cycles Op_RotateRegisterRightWithCarry(byte* pR)
+static FORCE_INLINE cycles Op_RotateRegisterRightWithCarry(struct GBInstance* pGB, byte* pR)
 {
     //2 bytes, 8 cycles, Flags Z00C
-    DoRotateRightWithCarry(pR);
-    Register.PC += 2;
+    DoRotateRightWithCarry(pGB, pR);
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static cycles Op_RotateAddrRightWithCarry(uint16_t addr)
+static FORCE_INLINE cycles Op_RotateAddrRightWithCarry(struct GBInstance* pGB, uint16_t addr)
 {
     //2 bytes, 16 cycles, Flags Z00C
-    byte val = ReadMem(addr);
-    DoRotateRightWithCarry(&val);
-    WriteMem(addr, val);
-    Register.PC += 2;
+    byte val = ReadMem(pGB, addr);
+    DoRotateRightWithCarry(pGB, &val);
+    WriteMem(pGB, addr, val);
+    pGB->CPU.Register.PC += 2;
     return 16;
 }
 
-void DoRotateRightThroughCarry(byte* pR)
+static FORCE_INLINE void DoRotateRightThroughCarry(struct GBInstance* pGB, byte* pR)
 {
     bool bit0 = *pR & 0x1;
-    *pR = ((*pR >> 1) | (IsFlagSet(Flag_Carry) << 7));
-    SetFlags(*pR == 0 ? FlagSet_On : FlagSet_Off, FlagSet_Off, FlagSet_Off, bit0 ? FlagSet_On : FlagSet_Off);
+    *pR = ((*pR >> 1) | (IsFlagSet(pGB, Flag_Carry) << 7));
+    pGB->CPU.LazyCarry = bit0;
+    SetLazyFlags(pGB, LazyFlags_Shift, *pR, 0, 0);
 }
 
-static cycles Op_RotateRegisterRightThroughCarry(byte* pR)
+static FORCE_INLINE cycles Op_RotateRegisterRightThroughCarry(struct GBInstance* pGB, byte* pR)
 {
     //2 bytes, 8 cycles, Flags Z00C
-    DoRotateRightThroughCarry(pR);
-    Register.PC += 2;
+    DoRotateRightThroughCarry(pGB, pR);
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static cycles Op_RotateAddrRightThroughCarry(uint16_t addr)
+static FORCE_INLINE cycles Op_RotateAddrRightThroughCarry(struct GBInstance* pGB, uint16_t addr)
 {
     //2 bytes, 16 cycles, Flags Z00C
-    byte val = ReadMem(addr);
-    DoRotateRightThroughCarry(&val);
-    WriteMem(addr, val);
-    Register.PC += 2;
+    byte val = ReadMem(pGB, addr);
+    DoRotateRightThroughCarry(pGB, &val);
+    WriteMem(pGB, addr, val);
+    pGB->CPU.Register.PC += 2;
     return 16;
 }
 
 //Same as above but only works with register A and shorter as they're not used from extended opcodes.
-static cycles Op_RotateRegisterRightWithCarryA()
+static FORCE_INLINE cycles Op_RotateRegisterRightWithCarryA(struct GBInstance* pGB)
 {
     //1 byte, 4 cycles, Flags Z00C
-    DoRotateRightWithCarry(&Register.A);
-    Register.PC += 1;
+    DoRotateRightWithCarry(pGB, &pGB->CPU.Register.A);
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static cycles Op_RotateRegisterRightThroughCarryA()
+static FORCE_INLINE cycles Op_RotateRegisterRightThroughCarryA(struct GBInstance* pGB)
 {
     //1 byte, 4 cycles, Flags Z00C
-    DoRotateRightThroughCarry(&Register.A);
-    Register.PC += 1;
+    DoRotateRightThroughCarry(pGB, &pGB->CPU.Register.A);
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static void DoShiftLeft(byte* pR)
+static FORCE_INLINE void DoShiftLeft(struct GBInstance* pGB, byte* pR)
 {
     bool bit7 = *pR >> 7;
     *pR <<= 1;
-    SetFlags(*pR == 0 ? FlagSet_On : FlagSet_Off, FlagSet_Off, FlagSet_Off, bit7 ? FlagSet_On : FlagSet_Off);
+    pGB->CPU.LazyCarry = bit7;
+    SetLazyFlags(pGB, LazyFlags_Shift, *pR, 0, 0);
 }
 
-static cycles Op_ShiftRegisterLeft(byte* pR)
+static FORCE_INLINE cycles Op_ShiftRegisterLeft(struct GBInstance* pGB, byte* pR)
 {
     //2 byte, 8 cycles, Flags Z00C
-    DoShiftLeft(pR);
-    Register.PC += 2;
+    DoShiftLeft(pGB, pR);
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static cycles Op_ShiftAddrLeft(uint16_t addr)
+static FORCE_INLINE cycles Op_ShiftAddrLeft(struct GBInstance* pGB, uint16_t addr)
 {
     //2 byte, 16 cycles, Flags Z00C
-    byte val = ReadMem(addr);
-    DoShiftLeft(&val);
-    WriteMem(addr, val);
-    Register.PC += 2;
+    byte val = ReadMem(pGB, addr);
+    DoShiftLeft(pGB, &val);
+    WriteMem(pGB, addr, val);
+    pGB->CPU.Register.PC += 2;
     return 16;
 }
 
-static void DoShiftRight(byte* pR, bool resetMSB)
+static FORCE_INLINE void DoShiftRight(struct GBInstance* pGB, byte* pR, bool resetMSB)
 {
     byte bit0 = (*pR & 1);
     byte bit7 = 0;
@@ -942,699 +1027,1785 @@ static void DoShiftRight(byte* pR, bool resetMSB)
 
     *pR = ((*pR >> 1) | bit7);
 
-    SetFlags(*pR == 0 ? FlagSet_On : FlagSet_Off, FlagSet_Off, FlagSet_Off, bit0 != 0 ? FlagSet_On : FlagSet_Off);
+    pGB->CPU.LazyCarry = bit0 != 0;
+    SetLazyFlags(pGB, LazyFlags_Shift, *pR, 0, 0);
 }
 
-static cycles Op_ShiftRegisterRight(byte* pR, bool resetMSB)
+static FORCE_INLINE cycles Op_ShiftRegisterRight(struct GBInstance* pGB, byte* pR, bool resetMSB)
 {
     //2 byte, 8 cycles, Flags Z00C
-    DoShiftRight(pR, resetMSB);
-    Register.PC += 2;
+    DoShiftRight(pGB, pR, resetMSB);
+    pGB->CPU.Register.PC += 2;
     return 8;
 }
 
-static cycles Op_ShiftAddrRight(uint16_t addr, bool resetMSB)
+static FORCE_INLINE cycles Op_ShiftAddrRight(struct GBInstance* pGB, uint16_t addr, bool resetMSB)
 {
     //2 byte, 16 cycles, Flags Z00C
-    byte val = ReadMem(addr);
-    DoShiftRight(&val, resetMSB);
-    WriteMem(addr, val);
-    Register.PC += 2;
+    byte val = ReadMem(pGB, addr);
+    DoShiftRight(pGB, &val, resetMSB);
+    WriteMem(pGB, addr, val);
+    pGB->CPU.Register.PC += 2;
     return 16;
 }
 
-static cycles Op_SetCarryFlag()
+static FORCE_INLINE cycles Op_SetCarryFlag(struct GBInstance* pGB)
 {
     //1 byte, 4 cycles, Flags -001
-    SetFlags(FlagSet_Leave, FlagSet_Off, FlagSet_Off, FlagSet_On);
-    Register.PC += 1;
+    SetFlags(pGB, FlagSet_Leave, FlagSet_Off, FlagSet_Off, FlagSet_On);
+    pGB->CPU.Register.PC += 1;
     return 4;
 }
 
-static cycles Op_Restart(uint16_t addr)
+static FORCE_INLINE cycles Op_Restart(struct GBInstance* pGB, uint16_t addr)
 {
     //1 byte, 16 cycles, No flags
-    StackPush(Register.PC + 1);
-    Register.PC = addr;
+    StackPush(pGB, pGB->CPU.Register.PC + 1);
+    pGB->CPU.Register.PC = addr;
     return 16;
 }
 
-static cycles HandleOpCode()
+//Opcode lists. Each entry maps an opcode to its length in bytes, its worst case cycle count and the 
+//operator that handles it. These get expanded into the handler functions and the various dispatchers 
+//below so there's only one place that needs updating when adding new opcodes. Immediate values are 
+//passed in as 'operand' so they can be decoded ahead of time. 0xCB is missing as it's the prefix for 
+//the extended opcodes.
+#define PRIMARY_OPCODES(OP) \
+    /*Loads*/ \
+    OP(0x3E, 2, 8, Op_LoadImmediate8(pGB, &pGB->CPU.Register.A, operand)) \
+    OP(0x06, 2, 8, Op_LoadImmediate8(pGB, &pGB->CPU.Register.B, operand)) \
+    OP(0x0E, 2, 8, Op_LoadImmediate8(pGB, &pGB->CPU.Register.C, operand)) \
+    OP(0x16, 2, 8, Op_LoadImmediate8(pGB, &pGB->CPU.Register.D, operand)) \
+    OP(0x1E, 2, 8, Op_LoadImmediate8(pGB, &pGB->CPU.Register.E, operand)) \
+    OP(0x26, 2, 8, Op_LoadImmediate8(pGB, &pGB->CPU.Register.H, operand)) \
+    OP(0x2E, 2, 8, Op_LoadImmediate8(pGB, &pGB->CPU.Register.L, operand)) \
+    \
+    OP(0x01, 3, 12, Op_LoadImmediate16(pGB, &pGB->CPU.Register.BC, operand)) \
+    OP(0x11, 3, 12, Op_LoadImmediate16(pGB, &pGB->CPU.Register.DE, operand)) \
+    OP(0x21, 3, 12, Op_LoadImmediate16(pGB, &pGB->CPU.Register.HL, operand)) \
+    OP(0x31, 3, 12, Op_LoadImmediate16(pGB, &pGB->CPU.Register.SP, operand)) \
+    \
+    OP(0x7F, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.A, &pGB->CPU.Register.A)) \
+    OP(0x78, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.A, &pGB->CPU.Register.B)) \
+    OP(0x79, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.A, &pGB->CPU.Register.C)) \
+    OP(0x7A, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.A, &pGB->CPU.Register.D)) \
+    OP(0x7B, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.A, &pGB->CPU.Register.E)) \
+    OP(0x7C, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.A, &pGB->CPU.Register.H)) \
+    OP(0x7D, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.A, &pGB->CPU.Register.L)) \
+    OP(0x47, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.B, &pGB->CPU.Register.A)) \
+    OP(0x40, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.B, &pGB->CPU.Register.B)) \
+    OP(0x41, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.B, &pGB->CPU.Register.C)) \
+    OP(0x42, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.B, &pGB->CPU.Register.D)) \
+    OP(0x43, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.B, &pGB->CPU.Register.E)) \
+    OP(0x44, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.B, &pGB->CPU.Register.H)) \
+    OP(0x45, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.B, &pGB->CPU.Register.L)) \
+    OP(0x4F, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.C, &pGB->CPU.Register.A)) \
+    OP(0x48, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.C, &pGB->CPU.Register.B)) \
+    OP(0x49, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.C, &pGB->CPU.Register.C)) \
+    OP(0x4A, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.C, &pGB->CPU.Register.D)) \
+    OP(0x4B, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.C, &pGB->CPU.Register.E)) \
+    OP(0x4C, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.C, &pGB->CPU.Register.H)) \
+    OP(0x4D, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.C, &pGB->CPU.Register.L)) \
+    OP(0x57, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.D, &pGB->CPU.Register.A)) \
+    OP(0x50, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.D, &pGB->CPU.Register.B)) \
+    OP(0x51, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.D, &pGB->CPU.Register.C)) \
+    OP(0x52, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.D, &pGB->CPU.Register.D)) \
+    OP(0x53, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.D, &pGB->CPU.Register.E)) \
+    OP(0x54, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.D, &pGB->CPU.Register.H)) \
+    OP(0x55, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.D, &pGB->CPU.Register.L)) \
+    OP(0x5F, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.E, &pGB->CPU.Register.A)) \
+    OP(0x58, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.E, &pGB->CPU.Register.B)) \
+    OP(0x59, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.E, &pGB->CPU.Register.C)) \
+    OP(0x5A, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.E, &pGB->CPU.Register.D)) \
+    OP(0x5B, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.E, &pGB->CPU.Register.E)) \
+    OP(0x5C, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.E, &pGB->CPU.Register.H)) \
+    OP(0x5D, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.E, &pGB->CPU.Register.L)) \
+    OP(0x67, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.H, &pGB->CPU.Register.A)) \
+    OP(0x60, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.H, &pGB->CPU.Register.B)) \
+    OP(0x61, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.H, &pGB->CPU.Register.C)) \
+    OP(0x62, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.H, &pGB->CPU.Register.D)) \
+    OP(0x63, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.H, &pGB->CPU.Register.E)) \
+    OP(0x64, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.H, &pGB->CPU.Register.H)) \
+    OP(0x65, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.H, &pGB->CPU.Register.L)) \
+    OP(0x6F, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.L, &pGB->CPU.Register.A)) \
+    OP(0x68, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.L, &pGB->CPU.Register.B)) \
+    OP(0x69, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.L, &pGB->CPU.Register.C)) \
+    OP(0x6A, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.L, &pGB->CPU.Register.D)) \
+    OP(0x6B, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.L, &pGB->CPU.Register.E)) \
+    OP(0x6C, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.L, &pGB->CPU.Register.H)) \
+    OP(0x6D, 1, 4, Op_LoadRegister8(pGB, &pGB->CPU.Register.L, &pGB->CPU.Register.L)) \
+    \
+    OP(0x0A, 1, 8, Op_LoadRegisterAddr(pGB, &pGB->CPU.Register.A, pGB->CPU.Register.BC)) \
+    OP(0x1A, 1, 8, Op_LoadRegisterAddr(pGB, &pGB->CPU.Register.A, pGB->CPU.Register.DE)) \
+    OP(0x7E, 1, 8, Op_LoadRegisterAddr(pGB, &pGB->CPU.Register.A, pGB->CPU.Register.HL)) \
+    OP(0x46, 1, 8, Op_LoadRegisterAddr(pGB, &pGB->CPU.Register.B, pGB->CPU.Register.HL)) \
+    OP(0x4E, 1, 8, Op_LoadRegisterAddr(pGB, &pGB->CPU.Register.C, pGB->CPU.Register.HL)) \
+    OP(0x56, 1, 8, Op_LoadRegisterAddr(pGB, &pGB->CPU.Register.D, pGB->CPU.Register.HL)) \
+    OP(0x5E, 1, 8, Op_LoadRegisterAddr(pGB, &pGB->CPU.Register.E, pGB->CPU.Register.HL)) \
+    OP(0x66, 1, 8, Op_LoadRegisterAddr(pGB, &pGB->CPU.Register.H, pGB->CPU.Register.HL)) \
+    OP(0x6E, 1, 8, Op_LoadRegisterAddr(pGB, &pGB->CPU.Register.L, pGB->CPU.Register.HL)) \
+    \
+    OP(0x02, 1, 8, Op_LoadAddrRegister(pGB, pGB->CPU.Register.BC, &pGB->CPU.Register.A)) \
+    OP(0x12, 1, 8, Op_LoadAddrRegister(pGB, pGB->CPU.Register.DE, &pGB->CPU.Register.A)) \
+    OP(0x77, 1, 8, Op_LoadAddrRegister(pGB, pGB->CPU.Register.HL, &pGB->CPU.Register.A)) \
+    OP(0x70, 1, 8, Op_LoadAddrRegister(pGB, pGB->CPU.Register.HL, &pGB->CPU.Register.B)) \
+    OP(0x71, 1, 8, Op_LoadAddrRegister(pGB, pGB->CPU.Register.HL, &pGB->CPU.Register.C)) \
+    OP(0x72, 1, 8, Op_LoadAddrRegister(pGB, pGB->CPU.Register.HL, &pGB->CPU.Register.D)) \
+    OP(0x73, 1, 8, Op_LoadAddrRegister(pGB, pGB->CPU.Register.HL, &pGB->CPU.Register.E)) \
+    OP(0x74, 1, 8, Op_LoadAddrRegister(pGB, pGB->CPU.Register.HL, &pGB->CPU.Register.H)) \
+    OP(0x75, 1, 8, Op_LoadAddrRegister(pGB, pGB->CPU.Register.HL, &pGB->CPU.Register.L)) \
+    \
+    OP(0xE2, 1, 8, Op_LoadAddrRegister(pGB, 0xFF00 + pGB->CPU.Register.C, &pGB->CPU.Register.A)) \
+    OP(0xF2, 1, 8, Op_LoadRegisterAddr(pGB, &pGB->CPU.Register.A, 0xFF00 + pGB->CPU.Register.C)) \
+    \
+    OP(0x36, 2, 12, Op_LoadAddrImmediate(pGB, &pGB->CPU.Register.HL, operand)) \
+    \
+    OP(0x22, 1, 8, Op_LoadAddrRegisterAndInc(pGB, &pGB->CPU.Register.HL, &pGB->CPU.Register.A)) \
+    OP(0x32, 1, 8, Op_LoadAddrRegisterAndDec(pGB, &pGB->CPU.Register.HL, &pGB->CPU.Register.A)) \
+    \
+    OP(0x2A, 1, 8, Op_LoadRegisterAddrAndInc(pGB, &pGB->CPU.Register.A, &pGB->CPU.Register.HL)) \
+    OP(0x3A, 1, 8, Op_LoadRegisterAddrAndDec(pGB, &pGB->CPU.Register.A, &pGB->CPU.Register.HL)) \
+    \
+    /*These don't need to be any more complicated as they only work with the A register.*/ \
+    OP(0xE0, 2, 12, Op_LoadImmediateAddr8FromA(pGB, operand)) \
+    OP(0xF0, 2, 12, Op_LoadAFromImmediateAddr8(pGB, operand)) \
+    OP(0xEA, 3, 16, Op_LoadImmediateAddr16FromA(pGB, operand)) \
+    OP(0xFA, 3, 16, Op_LoadAFromImmediateAddr16(pGB, operand)) \
+    \
+    /*Push/Pop*/ \
+    OP(0xF5, 1, 16, Op_Push(pGB, &pGB->CPU.Register.AF)) \
+    OP(0xC5, 1, 16, Op_Push(pGB, &pGB->CPU.Register.BC)) \
+    OP(0xD5, 1, 16, Op_Push(pGB, &pGB->CPU.Register.DE)) \
+    OP(0xE5, 1, 16, Op_Push(pGB, &pGB->CPU.Register.HL)) \
+    OP(0xF1, 1, 16, Op_Pop(pGB, &pGB->CPU.Register.AF)) \
+    OP(0xC1, 1, 16, Op_Pop(pGB, &pGB->CPU.Register.BC)) \
+    OP(0xD1, 1, 16, Op_Pop(pGB, &pGB->CPU.Register.DE)) \
+    OP(0xE1, 1, 16, Op_Pop(pGB, &pGB->CPU.Register.HL)) \
+    \
+    /*Compare*/ \
+    OP(0xBF, 1, 4, Op_CompareRegister(pGB, &pGB->CPU.Register.A)) \
+    OP(0xB8, 1, 4, Op_CompareRegister(pGB, &pGB->CPU.Register.B)) \
+    OP(0xB9, 1, 4, Op_CompareRegister(pGB, &pGB->CPU.Register.C)) \
+    OP(0xBA, 1, 4, Op_CompareRegister(pGB, &pGB->CPU.Register.D)) \
+    OP(0xBB, 1, 4, Op_CompareRegister(pGB, &pGB->CPU.Register.E)) \
+    OP(0xBC, 1, 4, Op_CompareRegister(pGB, &pGB->CPU.Register.H)) \
+    OP(0xBD, 1, 4, Op_CompareRegister(pGB, &pGB->CPU.Register.L)) \
+    OP(0xBE, 1, 8, Op_CompareAddr(pGB)) \
+    OP(0xFE, 2, 8, Op_CompareImmediate(pGB, operand)) \
+    \
+    /*And*/ \
+    OP(0xA7, 1, 4, Op_AndRegister(pGB, &pGB->CPU.Register.A)) \
+    OP(0xA0, 1, 4, Op_AndRegister(pGB, &pGB->CPU.Register.B)) \
+    OP(0xA1, 1, 4, Op_AndRegister(pGB, &pGB->CPU.Register.C)) \
+    OP(0xA2, 1, 4, Op_AndRegister(pGB, &pGB->CPU.Register.D)) \
+    OP(0xA3, 1, 4, Op_AndRegister(pGB, &pGB->CPU.Register.E)) \
+    OP(0xA4, 1, 4, Op_AndRegister(pGB, &pGB->CPU.Register.H)) \
+    OP(0xA5, 1, 4, Op_AndRegister(pGB, &pGB->CPU.Register.L)) \
+    OP(0xA6, 1, 8, Op_AndAddr(pGB)) \
+    OP(0xE6, 2, 8, Op_AndImmediate(pGB, operand)) \
+    \
+    /*Or*/ \
+    OP(0xB7, 1, 4, Op_OrRegister(pGB, &pGB->CPU.Register.A)) \
+    OP(0xB0, 1, 4, Op_OrRegister(pGB, &pGB->CPU.Register.B)) \
+    OP(0xB1, 1, 4, Op_OrRegister(pGB, &pGB->CPU.Register.C)) \
+    OP(0xB2, 1, 4, Op_OrRegister(pGB, &pGB->CPU.Register.D)) \
+    OP(0xB3, 1, 4, Op_OrRegister(pGB, &pGB->CPU.Register.E)) \
+    OP(0xB4, 1, 4, Op_OrRegister(pGB, &pGB->CPU.Register.H)) \
+    OP(0xB5, 1, 4, Op_OrRegister(pGB, &pGB->CPU.Register.L)) \
+    OP(0xB6, 1, 8, Op_OrAddr(pGB)) \
+    OP(0xF6, 2, 8, Op_OrImmediate(pGB, operand)) \
+    \
+    /*Xor*/ \
+    OP(0xAF, 1, 4, Op_XorRegister(pGB, &pGB->CPU.Register.A)) \
+    OP(0xA8, 1, 4, Op_XorRegister(pGB, &pGB->CPU.Register.B)) \
+    OP(0xA9, 1, 4, Op_XorRegister(pGB, &pGB->CPU.Register.C)) \
+    OP(0xAA, 1, 4, Op_XorRegister(pGB, &pGB->CPU.Register.D)) \
+    OP(0xAB, 1, 4, Op_XorRegister(pGB, &pGB->CPU.Register.E)) \
+    OP(0xAC, 1, 4, Op_XorRegister(pGB, &pGB->CPU.Register.H)) \
+    OP(0xAD, 1, 4, Op_XorRegister(pGB, &pGB->CPU.Register.L)) \
+    OP(0xAE, 1, 8, Op_XorAddr(pGB)) \
+    OP(0xEE, 2, 8, Op_XorImmediate(pGB, operand)) \
+    \
+    /*Complement*/ \
+    OP(0x2F, 1, 4, Op_Complement(pGB)) \
+    \
+    /*Decimal Adjust*/ \
+    OP(0x27, 1, 4, Op_DecimalAdjust(pGB)) \
+    \
+    /*Increment*/ \
+    OP(0x3C, 1, 4, Op_Increment8(pGB, &pGB->CPU.Register.A)) \
+    OP(0x04, 1, 4, Op_Increment8(pGB, &pGB->CPU.Register.B)) \
+    OP(0x0C, 1, 4, Op_Increment8(pGB, &pGB->CPU.Register.C)) \
+    OP(0x14, 1, 4, Op_Increment8(pGB, &pGB->CPU.Register.D)) \
+    OP(0x1C, 1, 4, Op_Increment8(pGB, &pGB->CPU.Register.E)) \
+    OP(0x24, 1, 4, Op_Increment8(pGB, &pGB->CPU.Register.H)) \
+    OP(0x2C, 1, 4, Op_Increment8(pGB, &pGB->CPU.Register.L)) \
+    \
+    OP(0x34, 1, 12, Op_IncrementAddr(pGB, pGB->CPU.Register.HL)) \
+    \
+    OP(0x03, 1, 8, Op_Increment16(pGB, &pGB->CPU.Register.BC)) \
+    OP(0x13, 1, 8, Op_Increment16(pGB, &pGB->CPU.Register.DE)) \
+    OP(0x23, 1, 8, Op_Increment16(pGB, &pGB->CPU.Register.HL)) \
+    OP(0x33, 1, 8, Op_Increment16(pGB, &pGB->CPU.Register.SP)) \
+    \
+    /*Decrement*/ \
+    OP(0x3D, 1, 4, Op_Decrement8(pGB, &pGB->CPU.Register.A)) \
+    OP(0x05, 1, 4, Op_Decrement8(pGB, &pGB->CPU.Register.B)) \
+    OP(0x0D, 1, 4, Op_Decrement8(pGB, &pGB->CPU.Register.C)) \
+    OP(0x15, 1, 4, Op_Decrement8(pGB, &pGB->CPU.Register.D)) \
+    OP(0x1D, 1, 4, Op_Decrement8(pGB, &pGB->CPU.Register.E)) \
+    OP(0x25, 1, 4, Op_Decrement8(pGB, &pGB->CPU.Register.H)) \
+    OP(0x2D, 1, 4, Op_Decrement8(pGB, &pGB->CPU.Register.L)) \
+    \
+    OP(0x35, 1, 12, Op_DecrementAddr(pGB, pGB->CPU.Register.HL)) \
+    \
+    OP(0x0B, 1, 8, Op_Decrement16(pGB, &pGB->CPU.Register.BC)) \
+    OP(0x1B, 1, 8, Op_Decrement16(pGB, &pGB->CPU.Register.DE)) \
+    OP(0x2B, 1, 8, Op_Decrement16(pGB, &pGB->CPU.Register.HL)) \
+    OP(0x3B, 1, 8, Op_Decrement16(pGB, &pGB->CPU.Register.SP)) \
+    \
+    /*Add*/ \
+    OP(0x87, 1, 4, Op_AddRegister(pGB, &pGB->CPU.Register.A, false)) \
+    OP(0x80, 1, 4, Op_AddRegister(pGB, &pGB->CPU.Register.B, false)) \
+    OP(0x81, 1, 4, Op_AddRegister(pGB, &pGB->CPU.Register.C, false)) \
+    OP(0x82, 1, 4, Op_AddRegister(pGB, &pGB->CPU.Register.D, false)) \
+    OP(0x83, 1, 4, Op_AddRegister(pGB, &pGB->CPU.Register.E, false)) \
+    OP(0x84, 1, 4, Op_AddRegister(pGB, &pGB->CPU.Register.H, false)) \
+    OP(0x85, 1, 4, Op_AddRegister(pGB, &pGB->CPU.Register.L, false)) \
+    OP(0x86, 1, 8, Op_AddAddr(pGB, false)) \
+    OP(0xC6, 2, 8, Op_AddImmediate(pGB, operand, false)) \
+    \
+    OP(0x09, 1, 8, Op_AddHLRegister16(pGB, &pGB->CPU.Register.BC)) \
+    OP(0x19, 1, 8, Op_AddHLRegister16(pGB, &pGB->CPU.Register.DE)) \
+    OP(0x29, 1, 8, Op_AddHLRegister16(pGB, &pGB->CPU.Register.HL)) \
+    OP(0x39, 1, 8, Op_AddHLRegister16(pGB, &pGB->CPU.Register.SP)) \
+    \
+    /*Add Plus Carry*/ \
+    OP(0x8F, 1, 4, Op_AddRegister(pGB, &pGB->CPU.Register.A, true)) \
+    OP(0x88, 1, 4, Op_AddRegister(pGB, &pGB->CPU.Register.B, true)) \
+    OP(0x89, 1, 4, Op_AddRegister(pGB, &pGB->CPU.Register.C, true)) \
+    OP(0x8A, 1, 4, Op_AddRegister(pGB, &pGB->CPU.Register.D, true)) \
+    OP(0x8B, 1, 4, Op_AddRegister(pGB, &pGB->CPU.Register.E, true)) \
+    OP(0x8C, 1, 4, Op_AddRegister(pGB, &pGB->CPU.Register.H, true)) \
+    OP(0x8D, 1, 4, Op_AddRegister(pGB, &pGB->CPU.Register.L, true)) \
+    OP(0x8E, 1, 8, Op_AddAddr(pGB, true)) \
+    OP(0xCE, 2, 8, Op_AddImmediate(pGB, operand, true)) \
+    \
+    /*Subtract*/ \
+    OP(0x97, 1, 4, Op_SubtractRegister(pGB, &pGB->CPU.Register.A, false)) \
+    OP(0x90, 1, 4, Op_SubtractRegister(pGB, &pGB->CPU.Register.B, false)) \
+    OP(0x91, 1, 4, Op_SubtractRegister(pGB, &pGB->CPU.Register.C, false)) \
+    OP(0x92, 1, 4, Op_SubtractRegister(pGB, &pGB->CPU.Register.D, false)) \
+    OP(0x93, 1, 4, Op_SubtractRegister(pGB, &pGB->CPU.Register.E, false)) \
+    OP(0x94, 1, 4, Op_SubtractRegister(pGB, &pGB->CPU.Register.H, false)) \
+    OP(0x95, 1, 4, Op_SubtractRegister(pGB, &pGB->CPU.Register.L, false)) \
+    OP(0x96, 1, 8, Op_SubtractAddr(pGB, false)) \
+    OP(0xD6, 2, 8, Op_SubtractImmediate(pGB, operand, false)) \
+    \
+    /*Subtract Plus Carry*/ \
+    OP(0x9F, 1, 4, Op_SubtractRegister(pGB, &pGB->CPU.Register.A, true)) \
+    OP(0x98, 1, 4, Op_SubtractRegister(pGB, &pGB->CPU.Register.B, true)) \
+    OP(0x99, 1, 4, Op_SubtractRegister(pGB, &pGB->CPU.Register.C, true)) \
+    OP(0x9A, 1, 4, Op_SubtractRegister(pGB, &pGB->CPU.Register.D, true)) \
+    OP(0x9B, 1, 4, Op_SubtractRegister(pGB, &pGB->CPU.Register.E, true)) \
+    OP(0x9C, 1, 4, Op_SubtractRegister(pGB, &pGB->CPU.Register.H, true)) \
+    OP(0x9D, 1, 4, Op_SubtractRegister(pGB, &pGB->CPU.Register.L, true)) \
+    OP(0x9E, 1, 8, Op_SubtractAddr(pGB, true)) \
+    OP(0xDE, 2, 8, Op_SubtractImmediate(pGB, operand, true)) \
+    \
+    /*Jumps*/ \
+    OP(0x18, 2, 12, Op_Jump(pGB, operand)) \
+    OP(0xC3, 3, 16, Op_JumpAddr(pGB, operand)) \
+    OP(0xE9, 1, 4, Op_JumpRegister(pGB, &pGB->CPU.Register.HL)) \
+    OP(0x20, 2, 12, Op_JumpIf(pGB, Flag_Zero, false, operand)) \
+    OP(0x28, 2, 12, Op_JumpIf(pGB, Flag_Zero, true, operand)) \
+    OP(0x30, 2, 12, Op_JumpIf(pGB, Flag_Carry, false, operand)) \
+    OP(0x38, 2, 12, Op_JumpIf(pGB, Flag_Carry, true, operand)) \
+    OP(0xC2, 3, 16, Op_JumpAddrIf(pGB, Flag_Zero, false, operand)) \
+    OP(0xCA, 3, 16, Op_JumpAddrIf(pGB, Flag_Zero, true, operand)) \
+    OP(0xD2, 3, 16, Op_JumpAddrIf(pGB, Flag_Carry, false, operand)) \
+    OP(0xDA, 3, 16, Op_JumpAddrIf(pGB, Flag_Carry, true, operand)) \
+    \
+    /*Calls*/ \
+    OP(0xCD, 3, 24, Op_Call(pGB, operand)) \
+    OP(0xC4, 3, 24, Op_CallIf(pGB, Flag_Zero, false, operand)) \
+    OP(0xCC, 3, 24, Op_CallIf(pGB, Flag_Zero, true, operand)) \
+    OP(0xD4, 3, 24, Op_CallIf(pGB, Flag_Carry, false, operand)) \
+    OP(0xDC, 3, 24, Op_CallIf(pGB, Flag_Carry, true, operand)) \
+    \
+    /*Interrupts*/ \
+    OP(0xF3, 1, 4, Op_DisableInterrupts(pGB)) \
+    OP(0xFB, 1, 4, Op_EnableInterrupts(pGB)) \
+    \
+    /*Returns*/ \
+    OP(0xC9, 1, 16, Op_Return(pGB)) \
+    OP(0xC0, 1, 20, Op_ReturnIf(pGB, Flag_Zero, false)) \
+    OP(0xC8, 1, 20, Op_ReturnIf(pGB, Flag_Zero, true)) \
+    OP(0xD0, 1, 20, Op_ReturnIf(pGB, Flag_Carry, false)) \
+    OP(0xD8, 1, 20, Op_ReturnIf(pGB, Flag_Carry, true)) \
+    \
+    OP(0xD9, 1, 16, Op_EnableInterruptsAndReturn(pGB)) \
+    \
+    /*Rotate A Left*/ \
+    OP(0x07, 1, 4, Op_RotateRegisterLeftWithCarryA(pGB)) \
+    OP(0x17, 1, 4, Op_RotateRegisterLeftThroughCarryA(pGB)) \
+    \
+    /*Rotate A Right*/ \
+    OP(0x0F, 1, 4, Op_RotateRegisterRightWithCarryA(pGB)) \
+    OP(0x1F, 1, 4, Op_RotateRegisterRightThroughCarryA(pGB)) \
+    \
+    OP(0x37, 1, 4, Op_SetCarryFlag(pGB)) \
+    \
+    /*Restart*/ \
+    OP(0xC7, 1, 16, Op_Restart(pGB, 0x00)) \
+    OP(0xCF, 1, 16, Op_Restart(pGB, 0x08)) \
+    OP(0xD7, 1, 16, Op_Restart(pGB, 0x10)) \
+    OP(0xDF, 1, 16, Op_Restart(pGB, 0x18)) \
+    OP(0xE7, 1, 16, Op_Restart(pGB, 0x20)) \
+    OP(0xEF, 1, 16, Op_Restart(pGB, 0x28)) \
+    OP(0xF7, 1, 16, Op_Restart(pGB, 0x30)) \
+    OP(0xFF, 1, 16, Op_Restart(pGB, 0x38)) \
+    \
+    /*Misc*/ \
+    OP(0x00, 1, 4, Op_NOP(pGB)) \
+    OP(0x76, 1, 4, Op_Halt(pGB))
+
+#define EXTENDED_OPCODES(OP) \
+    /*Swap*/ \
+    OP(0x37, 2, 8, Op_Swap(pGB, &pGB->CPU.Register.A)) \
+    OP(0x30, 2, 8, Op_Swap(pGB, &pGB->CPU.Register.B)) \
+    OP(0x31, 2, 8, Op_Swap(pGB, &pGB->CPU.Register.C)) \
+    OP(0x32, 2, 8, Op_Swap(pGB, &pGB->CPU.Register.D)) \
+    OP(0x33, 2, 8, Op_Swap(pGB, &pGB->CPU.Register.E)) \
+    OP(0x34, 2, 8, Op_Swap(pGB, &pGB->CPU.Register.H)) \
+    OP(0x35, 2, 8, Op_Swap(pGB, &pGB->CPU.Register.L)) \
+    \
+    /*Set bit*/ \
+    OP(0xC7, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.A, 0)) \
+    OP(0xCF, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.A, 1)) \
+    OP(0xD7, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.A, 2)) \
+    OP(0xDF, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.A, 3)) \
+    OP(0xE7, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.A, 4)) \
+    OP(0xEF, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.A, 5)) \
+    OP(0xF7, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.A, 6)) \
+    OP(0xFF, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.A, 7)) \
+    OP(0xC0, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.B, 0)) \
+    OP(0xC8, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.B, 1)) \
+    OP(0xD0, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.B, 2)) \
+    OP(0xD8, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.B, 3)) \
+    OP(0xE0, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.B, 4)) \
+    OP(0xE8, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.B, 5)) \
+    OP(0xF0, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.B, 6)) \
+    OP(0xF8, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.B, 7)) \
+    OP(0xC1, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.C, 0)) \
+    OP(0xC9, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.C, 1)) \
+    OP(0xD1, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.C, 2)) \
+    OP(0xD9, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.C, 3)) \
+    OP(0xE1, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.C, 4)) \
+    OP(0xE9, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.C, 5)) \
+    OP(0xF1, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.C, 6)) \
+    OP(0xF9, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.C, 7)) \
+    OP(0xC2, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.D, 0)) \
+    OP(0xCA, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.D, 1)) \
+    OP(0xD2, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.D, 2)) \
+    OP(0xDA, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.D, 3)) \
+    OP(0xE2, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.D, 4)) \
+    OP(0xEA, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.D, 5)) \
+    OP(0xF2, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.D, 6)) \
+    OP(0xFA, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.D, 7)) \
+    OP(0xC3, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.E, 0)) \
+    OP(0xCB, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.E, 1)) \
+    OP(0xD3, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.E, 2)) \
+    OP(0xDB, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.E, 3)) \
+    OP(0xE3, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.E, 4)) \
+    OP(0xEB, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.E, 5)) \
+    OP(0xF3, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.E, 6)) \
+    OP(0xFB, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.E, 7)) \
+    OP(0xC4, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.H, 0)) \
+    OP(0xCC, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.H, 1)) \
+    OP(0xD4, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.H, 2)) \
+    OP(0xDC, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.H, 3)) \
+    OP(0xE4, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.H, 4)) \
+    OP(0xEC, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.H, 5)) \
+    OP(0xF4, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.H, 6)) \
+    OP(0xFC, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.H, 7)) \
+    OP(0xC5, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.L, 0)) \
+    OP(0xCD, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.L, 1)) \
+    OP(0xD5, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.L, 2)) \
+    OP(0xDD, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.L, 3)) \
+    OP(0xE5, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.L, 4)) \
+    OP(0xED, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.L, 5)) \
+    OP(0xF5, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.L, 6)) \
+    OP(0xFD, 2, 8, Op_SetRegisterBit(pGB, &pGB->CPU.Register.L, 7)) \
+    OP(0xC6, 2, 16, Op_SetAddrBit(pGB, pGB->CPU.Register.HL, 0)) \
+    OP(0xCE, 2, 16, Op_SetAddrBit(pGB, pGB->CPU.Register.HL, 1)) \
+    OP(0xD6, 2, 16, Op_SetAddrBit(pGB, pGB->CPU.Register.HL, 2)) \
+    OP(0xDE, 2, 16, Op_SetAddrBit(pGB, pGB->CPU.Register.HL, 3)) \
+    OP(0xE6, 2, 16, Op_SetAddrBit(pGB, pGB->CPU.Register.HL, 4)) \
+    OP(0xEE, 2, 16, Op_SetAddrBit(pGB, pGB->CPU.Register.HL, 5)) \
+    OP(0xF6, 2, 16, Op_SetAddrBit(pGB, pGB->CPU.Register.HL, 6)) \
+    OP(0xFE, 2, 16, Op_SetAddrBit(pGB, pGB->CPU.Register.HL, 7)) \
+    \
+    /*Test bit*/ \
+    OP(0x47, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.A, 0)) \
+    OP(0x4F, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.A, 1)) \
+    OP(0x57, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.A, 2)) \
+    OP(0x5F, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.A, 3)) \
+    OP(0x67, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.A, 4)) \
+    OP(0x6F, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.A, 5)) \
+    OP(0x77, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.A, 6)) \
+    OP(0x7F, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.A, 7)) \
+    OP(0x40, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.B, 0)) \
+    OP(0x48, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.B, 1)) \
+    OP(0x50, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.B, 2)) \
+    OP(0x58, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.B, 3)) \
+    OP(0x60, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.B, 4)) \
+    OP(0x68, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.B, 5)) \
+    OP(0x70, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.B, 6)) \
+    OP(0x78, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.B, 7)) \
+    OP(0x41, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.C, 0)) \
+    OP(0x49, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.C, 1)) \
+    OP(0x51, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.C, 2)) \
+    OP(0x59, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.C, 3)) \
+    OP(0x61, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.C, 4)) \
+    OP(0x69, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.C, 5)) \
+    OP(0x71, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.C, 6)) \
+    OP(0x79, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.C, 7)) \
+    OP(0x42, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.D, 0)) \
+    OP(0x4A, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.D, 1)) \
+    OP(0x52, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.D, 2)) \
+    OP(0x5A, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.D, 3)) \
+    OP(0x62, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.D, 4)) \
+    OP(0x6A, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.D, 5)) \
+    OP(0x72, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.D, 6)) \
+    OP(0x7A, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.D, 7)) \
+    OP(0x43, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.E, 0)) \
+    OP(0x4B, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.E, 1)) \
+    OP(0x53, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.E, 2)) \
+    OP(0x5B, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.E, 3)) \
+    OP(0x63, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.E, 4)) \
+    OP(0x6B, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.E, 5)) \
+    OP(0x73, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.E, 6)) \
+    OP(0x7B, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.E, 7)) \
+    OP(0x44, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.H, 0)) \
+    OP(0x4C, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.H, 1)) \
+    OP(0x54, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.H, 2)) \
+    OP(0x5C, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.H, 3)) \
+    OP(0x64, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.H, 4)) \
+    OP(0x6C, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.H, 5)) \
+    OP(0x74, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.H, 6)) \
+    OP(0x7C, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.H, 7)) \
+    OP(0x45, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.L, 0)) \
+    OP(0x4D, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.L, 1)) \
+    OP(0x55, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.L, 2)) \
+    OP(0x5D, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.L, 3)) \
+    OP(0x65, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.L, 4)) \
+    OP(0x6D, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.L, 5)) \
+    OP(0x75, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.L, 6)) \
+    OP(0x7D, 2, 8, Op_TestRegisterBit(pGB, &pGB->CPU.Register.L, 7)) \
+    OP(0x46, 2, 12, Op_TestAddrBit(pGB, pGB->CPU.Register.HL, 0)) \
+    OP(0x4E, 2, 12, Op_TestAddrBit(pGB, pGB->CPU.Register.HL, 1)) \
+    OP(0x56, 2, 12, Op_TestAddrBit(pGB, pGB->CPU.Register.HL, 2)) \
+    OP(0x5E, 2, 12, Op_TestAddrBit(pGB, pGB->CPU.Register.HL, 3)) \
+    OP(0x66, 2, 12, Op_TestAddrBit(pGB, pGB->CPU.Register.HL, 4)) \
+    OP(0x6E, 2, 12, Op_TestAddrBit(pGB, pGB->CPU.Register.HL, 5)) \
+    OP(0x76, 2, 12, Op_TestAddrBit(pGB, pGB->CPU.Register.HL, 6)) \
+    OP(0x7E, 2, 12, Op_TestAddrBit(pGB, pGB->CPU.Register.HL, 7)) \
+    \
+    /*Reset Bit*/ \
+    OP(0x87, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.A, 0)) \
+    OP(0x8F, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.A, 1)) \
+    OP(0x97, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.A, 2)) \
+    OP(0x9F, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.A, 3)) \
+    OP(0xA7, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.A, 4)) \
+    OP(0xAF, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.A, 5)) \
+    OP(0xB7, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.A, 6)) \
+    OP(0xBF, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.A, 7)) \
+    OP(0x80, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.B, 0)) \
+    OP(0x88, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.B, 1)) \
+    OP(0x90, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.B, 2)) \
+    OP(0x98, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.B, 3)) \
+    OP(0xA0, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.B, 4)) \
+    OP(0xA8, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.B, 5)) \
+    OP(0xB0, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.B, 6)) \
+    OP(0xB8, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.B, 7)) \
+    OP(0x81, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.C, 0)) \
+    OP(0x89, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.C, 1)) \
+    OP(0x91, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.C, 2)) \
+    OP(0x99, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.C, 3)) \
+    OP(0xA1, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.C, 4)) \
+    OP(0xA9, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.C, 5)) \
+    OP(0xB1, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.C, 6)) \
+    OP(0xB9, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.C, 7)) \
+    OP(0x82, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.D, 0)) \
+    OP(0x8A, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.D, 1)) \
+    OP(0x92, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.D, 2)) \
+    OP(0x9A, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.D, 3)) \
+    OP(0xA2, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.D, 4)) \
+    OP(0xAA, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.D, 5)) \
+    OP(0xB2, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.D, 6)) \
+    OP(0xBA, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.D, 7)) \
+    OP(0x83, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.E, 0)) \
+    OP(0x8B, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.E, 1)) \
+    OP(0x93, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.E, 2)) \
+    OP(0x9B, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.E, 3)) \
+    OP(0xA3, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.E, 4)) \
+    OP(0xAB, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.E, 5)) \
+    OP(0xB3, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.E, 6)) \
+    OP(0xBB, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.E, 7)) \
+    OP(0x84, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.H, 0)) \
+    OP(0x8C, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.H, 1)) \
+    OP(0x94, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.H, 2)) \
+    OP(0x9C, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.H, 3)) \
+    OP(0xA4, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.H, 4)) \
+    OP(0xAC, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.H, 5)) \
+    OP(0xB4, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.H, 6)) \
+    OP(0xBC, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.H, 7)) \
+    OP(0x85, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.L, 0)) \
+    OP(0x8D, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.L, 1)) \
+    OP(0x95, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.L, 2)) \
+    OP(0x9D, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.L, 3)) \
+    OP(0xA5, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.L, 4)) \
+    OP(0xAD, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.L, 5)) \
+    OP(0xB5, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.L, 6)) \
+    OP(0xBD, 2, 8, Op_ResetRegisterBit(pGB, &pGB->CPU.Register.L, 7)) \
+    OP(0x86, 2, 16, Op_ResetAddrBit(pGB, pGB->CPU.Register.HL, 0)) \
+    OP(0x8E, 2, 16, Op_ResetAddrBit(pGB, pGB->CPU.Register.HL, 1)) \
+    OP(0x96, 2, 16, Op_ResetAddrBit(pGB, pGB->CPU.Register.HL, 2)) \
+    OP(0x9E, 2, 16, Op_ResetAddrBit(pGB, pGB->CPU.Register.HL, 3)) \
+    OP(0xA6, 2, 16, Op_ResetAddrBit(pGB, pGB->CPU.Register.HL, 4)) \
+    OP(0xAE, 2, 16, Op_ResetAddrBit(pGB, pGB->CPU.Register.HL, 5)) \
+    OP(0xB6, 2, 16, Op_ResetAddrBit(pGB, pGB->CPU.Register.HL, 6)) \
+    OP(0xBE, 2, 16, Op_ResetAddrBit(pGB, pGB->CPU.Register.HL, 7)) \
+    \
+    /*Rotate Left*/ \
+    OP(0x07, 2, 8, Op_RotateRegisterLeftWithCarry(pGB, &pGB->CPU.Register.A)) \
+    OP(0x00, 2, 8, Op_RotateRegisterLeftWithCarry(pGB, &pGB->CPU.Register.B)) \
+    OP(0x01, 2, 8, Op_RotateRegisterLeftWithCarry(pGB, &pGB->CPU.Register.C)) \
+    OP(0x02, 2, 8, Op_RotateRegisterLeftWithCarry(pGB, &pGB->CPU.Register.D)) \
+    OP(0x03, 2, 8, Op_RotateRegisterLeftWithCarry(pGB, &pGB->CPU.Register.E)) \
+    OP(0x04, 2, 8, Op_RotateRegisterLeftWithCarry(pGB, &pGB->CPU.Register.H)) \
+    OP(0x05, 2, 8, Op_RotateRegisterLeftWithCarry(pGB, &pGB->CPU.Register.L)) \
+    OP(0x06, 2, 16, Op_RotateAddrLeftWithCarry(pGB, pGB->CPU.Register.HL)) \
+    \
+    OP(0x17, 2, 8, Op_RotateRegisterLeftThroughCarry(pGB, &pGB->CPU.Register.A)) \
+    OP(0x10, 2, 8, Op_RotateRegisterLeftThroughCarry(pGB, &pGB->CPU.Register.B)) \
+    OP(0x11, 2, 8, Op_RotateRegisterLeftThroughCarry(pGB, &pGB->CPU.Register.C)) \
+    OP(0x12, 2, 8, Op_RotateRegisterLeftThroughCarry(pGB, &pGB->CPU.Register.D)) \
+    OP(0x13, 2, 8, Op_RotateRegisterLeftThroughCarry(pGB, &pGB->CPU.Register.E)) \
+    OP(0x14, 2, 8, Op_RotateRegisterLeftThroughCarry(pGB, &pGB->CPU.Register.H)) \
+    OP(0x15, 2, 8, Op_RotateRegisterLeftThroughCarry(pGB, &pGB->CPU.Register.L)) \
+    OP(0x16, 2, 16, Op_RotateAddrLeftThroughCarry(pGB, pGB->CPU.Register.HL)) \
+    \
+    /*Rotate Right*/ \
+    OP(0x0F, 2, 8, Op_RotateRegisterRightWithCarry(pGB, &pGB->CPU.Register.A)) \
+    OP(0x08, 2, 8, Op_RotateRegisterRightWithCarry(pGB, &pGB->CPU.Register.B)) \
+    OP(0x09, 2, 8, Op_RotateRegisterRightWithCarry(pGB, &pGB->CPU.Register.C)) \
+    OP(0x0A, 2, 8, Op_RotateRegisterRightWithCarry(pGB, &pGB->CPU.Register.D)) \
+    OP(0x0B, 2, 8, Op_RotateRegisterRightWithCarry(pGB, &pGB->CPU.Register.E)) \
+    OP(0x0C, 2, 8, Op_RotateRegisterRightWithCarry(pGB, &pGB->CPU.Register.H)) \
+    OP(0x0D, 2, 8, Op_RotateRegisterRightWithCarry(pGB, &pGB->CPU.Register.L)) \
+    OP(0x0E, 2, 16, Op_RotateAddrRightWithCarry(pGB, pGB->CPU.Register.HL)) \
+    \
+    OP(0x1F, 2, 8, Op_RotateRegisterRightThroughCarry(pGB, &pGB->CPU.Register.A)) \
+    OP(0x18, 2, 8, Op_RotateRegisterRightThroughCarry(pGB, &pGB->CPU.Register.B)) \
+    OP(0x19, 2, 8, Op_RotateRegisterRightThroughCarry(pGB, &pGB->CPU.Register.C)) \
+    OP(0x1A, 2, 8, Op_RotateRegisterRightThroughCarry(pGB, &pGB->CPU.Register.D)) \
+    OP(0x1B, 2, 8, Op_RotateRegisterRightThroughCarry(pGB, &pGB->CPU.Register.E)) \
+    OP(0x1C, 2, 8, Op_RotateRegisterRightThroughCarry(pGB, &pGB->CPU.Register.H)) \
+    OP(0x1D, 2, 8, Op_RotateRegisterRightThroughCarry(pGB, &pGB->CPU.Register.L)) \
+    OP(0x1E, 2, 16, Op_RotateAddrRightThroughCarry(pGB, pGB->CPU.Register.HL)) \
+    \
+    /*Shift Left*/ \
+    OP(0x27, 2, 8, Op_ShiftRegisterLeft(pGB, &pGB->CPU.Register.A)) \
+    OP(0x20, 2, 8, Op_ShiftRegisterLeft(pGB, &pGB->CPU.Register.B)) \
+    OP(0x21, 2, 8, Op_ShiftRegisterLeft(pGB, &pGB->CPU.Register.C)) \
+    OP(0x22, 2, 8, Op_ShiftRegisterLeft(pGB, &pGB->CPU.Register.D)) \
+    OP(0x23, 2, 8, Op_ShiftRegisterLeft(pGB, &pGB->CPU.Register.E)) \
+    OP(0x24, 2, 8, Op_ShiftRegisterLeft(pGB, &pGB->CPU.Register.H)) \
+    OP(0x25, 2, 8, Op_ShiftRegisterLeft(pGB, &pGB->CPU.Register.L)) \
+    OP(0x26, 2, 16, Op_ShiftAddrLeft(pGB, pGB->CPU.Register.HL)) \
+    \
+    /*Shift Right*/ \
+    OP(0x2F, 2, 8, Op_ShiftRegisterRight(pGB, &pGB->CPU.Register.A, false)) \
+    OP(0x28, 2, 8, Op_ShiftRegisterRight(pGB, &pGB->CPU.Register.B, false)) \
+    OP(0x29, 2, 8, Op_ShiftRegisterRight(pGB, &pGB->CPU.Register.C, false)) \
+    OP(0x2A, 2, 8, Op_ShiftRegisterRight(pGB, &pGB->CPU.Register.D, false)) \
+    OP(0x2B, 2, 8, Op_ShiftRegisterRight(pGB, &pGB->CPU.Register.E, false)) \
+    OP(0x2C, 2, 8, Op_ShiftRegisterRight(pGB, &pGB->CPU.Register.H, false)) \
+    OP(0x2D, 2, 8, Op_ShiftRegisterRight(pGB, &pGB->CPU.Register.L, false)) \
+    OP(0x2E, 2, 16, Op_ShiftAddrRight(pGB, pGB->CPU.Register.HL, false)) \
+    \
+    OP(0x3F, 2, 8, Op_ShiftRegisterRight(pGB, &pGB->CPU.Register.A, true)) \
+    OP(0x38, 2, 8, Op_ShiftRegisterRight(pGB, &pGB->CPU.Register.B, true)) \
+    OP(0x39, 2, 8, Op_ShiftRegisterRight(pGB, &pGB->CPU.Register.C, true)) \
+    OP(0x3A, 2, 8, Op_ShiftRegisterRight(pGB, &pGB->CPU.Register.D, true)) \
+    OP(0x3B, 2, 8, Op_ShiftRegisterRight(pGB, &pGB->CPU.Register.E, true)) \
+    OP(0x3C, 2, 8, Op_ShiftRegisterRight(pGB, &pGB->CPU.Register.H, true)) \
+    OP(0x3D, 2, 8, Op_ShiftRegisterRight(pGB, &pGB->CPU.Register.L, true)) \
+    OP(0x3E, 2, 16, Op_ShiftAddrRight(pGB, pGB->CPU.Register.HL, false))
+
+typedef cycles(*OpHandler)(struct GBInstance* pGB, uint16_t operand);
+
+static cycles Op_Unhandled(struct GBInstance* pGB, uint16_t operand)
+{
+    DebugPrint("Unhandled opcode 0x%02X!\n", ReadMem(pGB, pGB->CPU.Register.PC));
+    assert(0);
+    return 0;
+}
+
+static cycles Op_ExtendedUnhandled(struct GBInstance* pGB, uint16_t operand)
+{
+    DebugPrint("Unhandled extended opcode 0x%02X!\n", ReadMem(pGB, pGB->CPU.Register.PC + 1));
+    assert(0);
+    return 0;
+}
+
+#define DEFINE_OP_HANDLER(opCode, length, numCycles, op) static cycles OpHandler_##opCode(struct GBInstance* pGB, uint16_t operand) { return op; }
+#define DEFINE_EXTENDED_OP_HANDLER(opCode, length, numCycles, op) static cycles ExtendedOpHandler_##opCode(struct GBInstance* pGB, uint16_t operand) { return op; }
+
+PRIMARY_OPCODES(DEFINE_OP_HANDLER)
+EXTENDED_OPCODES(DEFINE_EXTENDED_OP_HANDLER)
+
+static OpHandler OpTable[256];
+static OpHandler ExtendedOpTable[256];
+
+static byte OpLength[256];
+static cycles OpCycles[256];
+static cycles ExtendedOpCycles[256];
+
+static cycles Op_Extended(struct GBInstance* pGB, uint16_t operand)
+{
+    return ExtendedOpTable[operand](pGB, 0);
+}
+
+static bool OpTablesInitialised = false;
+
+static void InitOpTables()
+{
+    if (OpTablesInitialised)
+    {
+        return;
+    }
+
+    for (int i = 0; i < 256; ++i)
+    {
+        OpTable[i] = &Op_Unhandled;
+        ExtendedOpTable[i] = &Op_ExtendedUnhandled;
+        OpLength[i] = 1;
+        OpCycles[i] = 0;
+        ExtendedOpCycles[i] = 0;
+    }
+
+    #define SET_OP_HANDLER(opCode, length, numCycles, op) OpTable[opCode] = &OpHandler_##opCode; OpLength[opCode] = length; OpCycles[opCode] = numCycles;
+    #define SET_EXTENDED_OP_HANDLER(opCode, length, numCycles, op) ExtendedOpTable[opCode] = &ExtendedOpHandler_##opCode; ExtendedOpCycles[opCode] = numCycles;
+
+    PRIMARY_OPCODES(SET_OP_HANDLER)
+    EXTENDED_OPCODES(SET_EXTENDED_OP_HANDLER)
+
+    OpTable[0xCB] = &Op_Extended;
+    OpLength[0xCB] = 2;
+
+    OpTablesInitialised = true;
+}
+
+//Fetch window. Instructions are read straight from a host pointer to the region the PC is in rather
+//than going through AccessMem every time. The window only moves when the PC leaves the region, or is
+//thrown away when the memory map changes (see CPUInvalidateFetchWindow).
+static void UpdateFetchWindow(struct GBInstance* pGB, uint16_t addr)
+{
+    uint16_t start = 0;
+    uint16_t end = 0;
+
+    if (addr < 0x100)
+    {
+        //Where the boot ROM is mapped over the cartridge.
+        end = 0x100;
+    }
+    else if (addr < 0x4000)
+    {
+        start = 0x100;
+        end = 0x4000;
+    }
+    else if (addr < 0xFE00)
+    {
+        //ROM banks, VRAM, cartridge RAM and WRAM (and its echo) are all 8KB aligned.
+        start = addr & 0xE000;
+        end = MIN(start + 0x2000, 0xFE00);
+    }
+    else if (addr >= 0xFF80 && addr < 0xFFFF)
+    {
+        start = 0xFF80;
+        end = 0xFFFF;
+    }
+
+    //Cartridge RAM that's smaller than a bank (or not there at all) is mirrored, so fall back to
+    //the page.
+    if (end > start && AccessMem(pGB, end - 1) - AccessMem(pGB, start) != end - start - 1)
+    {
+        start = addr & 0xFF00;
+        end = start + 0x100;
+    }
+
+    //OAM, IO and IE aren't plain memory so always go through ReadMem.
+    pGB->CPU.FetchWindowStart = start;
+    pGB->CPU.FetchWindowSize = end - start;
+    pGB->CPU.pFetchWindow = pGB->CPU.FetchWindowSize > 0 ? AccessMem(pGB, start) : NULL;
+}
+
+static FORCE_INLINE byte FetchByte(struct GBInstance* pGB, uint16_t addr)
+{
+    if ((uint16_t)(addr - pGB->CPU.FetchWindowStart) >= pGB->CPU.FetchWindowSize)
+    {
+        UpdateFetchWindow(pGB, addr);
+
+        if (pGB->CPU.FetchWindowSize == 0)
+        {
+            return ReadMem(pGB, addr);
+        }
+    }
+
+    return pGB->CPU.pFetchWindow[addr - pGB->CPU.FetchWindowStart];
+}
+
+void CPUInvalidateFetchWindow(struct GBInstance* pGB)
+{
+    pGB->CPU.FetchWindowStart = 0;
+    pGB->CPU.FetchWindowSize = 0;
+    pGB->CPU.pFetchWindow = NULL;
+}
+
+static FORCE_INLINE uint16_t ReadOperand(struct GBInstance* pGB, uint16_t addr, byte opCode)
+{
+    switch (OpLength[opCode])
+    {
+        case 2: return FetchByte(pGB, addr + 1);
+        case 3: return FetchByte(pGB, addr + 1) | (FetchByte(pGB, addr + 2) << 8);
+        default: return 0;
+    }
+}
+
+//Dispatchers. They all do the same thing but the performance differs depending on the compiler and
+//platform so they can be switched between (see CPUSetDispatchMode).
+#define OP_CASE(opCode, length, numCycles, op) case opCode: return op;
+
+static cycles HandleOpCodeSwitch(struct GBInstance* pGB)
 {
-    byte opCode = ReadMem(Register.PC);
+    byte opCode = FetchByte(pGB, pGB->CPU.Register.PC);
+    uint16_t operand = ReadOperand(pGB, pGB->CPU.Register.PC, opCode);
 
     switch (opCode)
     {
-        //Loads
-        case 0x3E: return Op_LoadImmediate8(&Register.A);
-        case 0x06: return Op_LoadImmediate8(&Register.B);
-        case 0x0E: return Op_LoadImmediate8(&Register.C);
-        case 0x16: return Op_LoadImmediate8(&Register.D);
-        case 0x1E: return Op_LoadImmediate8(&Register.E);
-        case 0x26: return Op_LoadImmediate8(&Register.H);
-        case 0x2E: return Op_LoadImmediate8(&Register.L);
-
-        case 0x01: return Op_LoadImmediate16(&Register.BC);
-        case 0x11: return Op_LoadImmediate16(&Register.DE);
-        case 0x21: return Op_LoadImmediate16(&Register.HL);
-        case 0x31: return Op_LoadImmediate16(&Register.SP);
-
-        case 0x7F: return Op_LoadRegister8(&Register.A, &Register.A);
-        case 0x78: return Op_LoadRegister8(&Register.A, &Register.B);
-        case 0x79: return Op_LoadRegister8(&Register.A, &Register.C);
-        case 0x7A: return Op_LoadRegister8(&Register.A, &Register.D);
-        case 0x7B: return Op_LoadRegister8(&Register.A, &Register.E);
-        case 0x7C: return Op_LoadRegister8(&Register.A, &Register.H);
-        case 0x7D: return Op_LoadRegister8(&Register.A, &Register.L);
-        case 0x47: return Op_LoadRegister8(&Register.B, &Register.A);
-        case 0x40: return Op_LoadRegister8(&Register.B, &Register.B);
-        case 0x41: return Op_LoadRegister8(&Register.B, &Register.C);
-        case 0x42: return Op_LoadRegister8(&Register.B, &Register.D);
-        case 0x43: return Op_LoadRegister8(&Register.B, &Register.E);
-        case 0x44: return Op_LoadRegister8(&Register.B, &Register.H);
-        case 0x45: return Op_LoadRegister8(&Register.B, &Register.L);
-        case 0x4F: return Op_LoadRegister8(&Register.C, &Register.A);
-        case 0x48: return Op_LoadRegister8(&Register.C, &Register.B);
-        case 0x49: return Op_LoadRegister8(&Register.C, &Register.C);
-        case 0x4A: return Op_LoadRegister8(&Register.C, &Register.D);
-        case 0x4B: return Op_LoadRegister8(&Register.C, &Register.E);
-        case 0x4C: return Op_LoadRegister8(&Register.C, &Register.H);
-        case 0x4D: return Op_LoadRegister8(&Register.C, &Register.L);
-        case 0x57: return Op_LoadRegister8(&Register.D, &Register.A);
-        case 0x50: return Op_LoadRegister8(&Register.D, &Register.B);
-        case 0x51: return Op_LoadRegister8(&Register.D, &Register.C);
-        case 0x52: return Op_LoadRegister8(&Register.D, &Register.D);
-        case 0x53: return Op_LoadRegister8(&Register.D, &Register.E);
-        case 0x54: return Op_LoadRegister8(&Register.D, &Register.H);
-        case 0x55: return Op_LoadRegister8(&Register.D, &Register.L);
-        case 0x5F: return Op_LoadRegister8(&Register.E, &Register.A);
-        case 0x58: return Op_LoadRegister8(&Register.E, &Register.B);
-        case 0x59: return Op_LoadRegister8(&Register.E, &Register.C);
-        case 0x5A: return Op_LoadRegister8(&Register.E, &Register.D);
-        case 0x5B: return Op_LoadRegister8(&Register.E, &Register.E);
-        case 0x5C: return Op_LoadRegister8(&Register.E, &Register.H);
-        case 0x5D: return Op_LoadRegister8(&Register.E, &Register.L);
-        case 0x67: return Op_LoadRegister8(&Register.H, &Register.A);
-        case 0x60: return Op_LoadRegister8(&Register.H, &Register.B);
-        case 0x61: return Op_LoadRegister8(&Register.H, &Register.C);
-        case 0x62: return Op_LoadRegister8(&Register.H, &Register.D);
-        case 0x63: return Op_LoadRegister8(&Register.H, &Register.E);
-        case 0x64: return Op_LoadRegister8(&Register.H, &Register.H);
-        case 0x65: return Op_LoadRegister8(&Register.H, &Register.L);
-        case 0x6F: return Op_LoadRegister8(&Register.L, &Register.A);
-        case 0x68: return Op_LoadRegister8(&Register.L, &Register.B);
-        case 0x69: return Op_LoadRegister8(&Register.L, &Register.C);
-        case 0x6A: return Op_LoadRegister8(&Register.L, &Register.D);
-        case 0x6B: return Op_LoadRegister8(&Register.L, &Register.E);
-        case 0x6C: return Op_LoadRegister8(&Register.L, &Register.H);
-        case 0x6D: return Op_LoadRegister8(&Register.L, &Register.L);
-
-        case 0x0A: return Op_LoadRegisterAddr(&Register.A, Register.BC);
-        case 0x1A: return Op_LoadRegisterAddr(&Register.A, Register.DE);
-        case 0x7E: return Op_LoadRegisterAddr(&Register.A, Register.HL);
-        case 0x46: return Op_LoadRegisterAddr(&Register.B, Register.HL);
-        case 0x4E: return Op_LoadRegisterAddr(&Register.C, Register.HL);
-        case 0x56: return Op_LoadRegisterAddr(&Register.D, Register.HL);
-        case 0x5E: return Op_LoadRegisterAddr(&Register.E, Register.HL);
-        case 0x66: return Op_LoadRegisterAddr(&Register.H, Register.HL);
-        case 0x6E: return Op_LoadRegisterAddr(&Register.L, Register.HL);
-
-        case 0x02: return Op_LoadAddrRegister(Register.BC, &Register.A);
-        case 0x12: return Op_LoadAddrRegister(Register.DE, &Register.A);
-        case 0x77: return Op_LoadAddrRegister(Register.HL, &Register.A);
-        case 0x70: return Op_LoadAddrRegister(Register.HL, &Register.B);
-        case 0x71: return Op_LoadAddrRegister(Register.HL, &Register.C);
-        case 0x72: return Op_LoadAddrRegister(Register.HL, &Register.D);
-        case 0x73: return Op_LoadAddrRegister(Register.HL, &Register.E);
-        case 0x74: return Op_LoadAddrRegister(Register.HL, &Register.H);
-        case 0x75: return Op_LoadAddrRegister(Register.HL, &Register.L);
-
-        case 0xE2: return Op_LoadAddrRegister(0xFF00 + Register.C, &Register.A);
-        case 0xF2: return Op_LoadRegisterAddr(&Register.A, 0xFF00 + Register.C);
-
-        case 0x36: return Op_LoadAddrImmediate(&Register.HL);
-
-        case 0x22: return Op_LoadAddrRegisterAndInc(&Register.HL, &Register.A);
-        case 0x32: return Op_LoadAddrRegisterAndDec(&Register.HL, &Register.A);
-
-        case 0x2A: return Op_LoadRegisterAddrAndInc(&Register.A, &Register.HL);
-        case 0x3A: return Op_LoadRegisterAddrAndDec(&Register.A, &Register.HL);
-
-        //These don't need to be any more complicated as they only work with the A register.
-        case 0xE0: return Op_LoadImmediateAddr8FromA();
-        case 0xF0: return Op_LoadAFromImmediateAddr8();
-        case 0xEA: return Op_LoadImmediateAddr16FromA();
-        case 0xFA: return Op_LoadAFromImmediateAddr16();
-
-        //Push/Pop
-        case 0xF5: return Op_Push(&Register.AF);
-        case 0xC5: return Op_Push(&Register.BC);
-        case 0xD5: return Op_Push(&Register.DE);
-        case 0xE5: return Op_Push(&Register.HL);
-        case 0xF1: return Op_Pop(&Register.AF);
-        case 0xC1: return Op_Pop(&Register.BC);
-        case 0xD1: return Op_Pop(&Register.DE);
-        case 0xE1: return Op_Pop(&Register.HL);
-
-        //Compare
-        case 0xBF: return Op_CompareRegister(&Register.A);
-        case 0xB8: return Op_CompareRegister(&Register.B);
-        case 0xB9: return Op_CompareRegister(&Register.C);
-        case 0xBA: return Op_CompareRegister(&Register.D);
-        case 0xBB: return Op_CompareRegister(&Register.E);
-        case 0xBC: return Op_CompareRegister(&Register.H);
-        case 0xBD: return Op_CompareRegister(&Register.L);
-        case 0xBE: return Op_CompareAddr();
-        case 0xFE: return Op_CompareImmediate();
-
-        //And
-        case 0xA7: return Op_AndRegister(&Register.A);
-        case 0xA0: return Op_AndRegister(&Register.B);
-        case 0xA1: return Op_AndRegister(&Register.C);
-        case 0xA2: return Op_AndRegister(&Register.D);
-        case 0xA3: return Op_AndRegister(&Register.E);
-        case 0xA4: return Op_AndRegister(&Register.H);
-        case 0xA5: return Op_AndRegister(&Register.L);
-        case 0xA6: return Op_AndAddr();
-        case 0xE6: return Op_AndImmediate();
-
-        //Or
-        case 0xB7: return Op_OrRegister(&Register.A);
-        case 0xB0: return Op_OrRegister(&Register.B);
-        case 0xB1: return Op_OrRegister(&Register.C);
-        case 0xB2: return Op_OrRegister(&Register.D);
-        case 0xB3: return Op_OrRegister(&Register.E);
-        case 0xB4: return Op_OrRegister(&Register.H);
-        case 0xB5: return Op_OrRegister(&Register.L);
-        case 0xB6: return Op_OrAddr();
-        case 0xF6: return Op_OrImmediate();
-
-        //Xor
-        case 0xAF: return Op_XorRegister(&Register.A);
-        case 0xA8: return Op_XorRegister(&Register.B);
-        case 0xA9: return Op_XorRegister(&Register.C);
-        case 0xAA: return Op_XorRegister(&Register.D);
-        case 0xAB: return Op_XorRegister(&Register.E);
-        case 0xAC: return Op_XorRegister(&Register.H);
-        case 0xAD: return Op_XorRegister(&Register.L);
-        case 0xAE: return Op_XorAddr();
-        case 0xEE: return Op_XorImmediate();
-
-        //Complement
-        case 0x2F: return Op_Complement();
-
-        //Decimal Adjust
-        case 0x27: return Op_DecimalAdjust();
-
-        //Increment
-        case 0x3C: return Op_Increment8(&Register.A);
-        case 0x04: return Op_Increment8(&Register.B);
-        case 0x0C: return Op_Increment8(&Register.C);
-        case 0x14: return Op_Increment8(&Register.D);
-        case 0x1C: return Op_Increment8(&Register.E);
-        case 0x24: return Op_Increment8(&Register.H);
-        case 0x2C: return Op_Increment8(&Register.L);
-
-        case 0x34: return Op_IncrementAddr(Register.HL);
-
-        case 0x03: return Op_Increment16(&Register.BC);
-        case 0x13: return Op_Increment16(&Register.DE);
-        case 0x23: return Op_Increment16(&Register.HL);
-        case 0x33: return Op_Increment16(&Register.SP);
-
-        //Decrement
-        case 0x3D: return Op_Decrement8(&Register.A);
-        case 0x05: return Op_Decrement8(&Register.B);
-        case 0x0D: return Op_Decrement8(&Register.C);
-        case 0x15: return Op_Decrement8(&Register.D);
-        case 0x1D: return Op_Decrement8(&Register.E);
-        case 0x25: return Op_Decrement8(&Register.H);
-        case 0x2D: return Op_Decrement8(&Register.L);
-
-        case 0x35: return Op_DecrementAddr(Register.HL);
-
-        case 0x0B: return Op_Decrement16(&Register.BC);
-        case 0x1B: return Op_Decrement16(&Register.DE);
-        case 0x2B: return Op_Decrement16(&Register.HL);
-        case 0x3B: return Op_Decrement16(&Register.SP);
-
-        //Add
-        case 0x87: return Op_AddRegister(&Register.A, false);
-        case 0x80: return Op_AddRegister(&Register.B, false);
-        case 0x81: return Op_AddRegister(&Register.C, false);
-        case 0x82: return Op_AddRegister(&Register.D, false);
-        case 0x83: return Op_AddRegister(&Register.E, false);
-        case 0x84: return Op_AddRegister(&Register.H, false);
-        case 0x85: return Op_AddRegister(&Register.L, false);
-        case 0x86: return Op_AddAddr(false);
-        case 0xC6: return Op_AddImmediate(false);
-        
-        case 0x09: return Op_AddHLRegister16(&Register.BC);
-        case 0x19: return Op_AddHLRegister16(&Register.DE);
-        case 0x29: return Op_AddHLRegister16(&Register.HL);
-        case 0x39: return Op_AddHLRegister16(&Register.SP);
-
-        //Add Plus Carry
-        case 0x8F: return Op_AddRegister(&Register.A, true);
-        case 0x88: return Op_AddRegister(&Register.B, true);
-        case 0x89: return Op_AddRegister(&Register.C, true);
-        case 0x8A: return Op_AddRegister(&Register.D, true);
-        case 0x8B: return Op_AddRegister(&Register.E, true);
-        case 0x8C: return Op_AddRegister(&Register.H, true);
-        case 0x8D: return Op_AddRegister(&Register.L, true);
-        case 0x8E: return Op_AddAddr(true);
-        case 0xCE: return Op_AddImmediate(true);
-
-        //Subtract
-        case 0x97: return Op_SubtractRegister(&Register.A, false);
-        case 0x90: return Op_SubtractRegister(&Register.B, false);
-        case 0x91: return Op_SubtractRegister(&Register.C, false);
-        case 0x92: return Op_SubtractRegister(&Register.D, false);
-        case 0x93: return Op_SubtractRegister(&Register.E, false);
-        case 0x94: return Op_SubtractRegister(&Register.H, false);
-        case 0x95: return Op_SubtractRegister(&Register.L, false);
-        case 0x96: return Op_SubtractAddr(false);
-        case 0xD6: return Op_SubtractImmediate(false);
-
-        //Subtract Plus Carry
-        case 0x9F: return Op_SubtractRegister(&Register.A, true);
-        case 0x98: return Op_SubtractRegister(&Register.B, true);
-        case 0x99: return Op_SubtractRegister(&Register.C, true);
-        case 0x9A: return Op_SubtractRegister(&Register.D, true);
-        case 0x9B: return Op_SubtractRegister(&Register.E, true);
-        case 0x9C: return Op_SubtractRegister(&Register.H, true);
-        case 0x9D: return Op_SubtractRegister(&Register.L, true);
-        case 0x9E: return Op_SubtractAddr(true);
-        case 0xDE: return Op_SubtractImmediate(true);
-
-        //Jumps
-        case 0x18: return Op_Jump();
-        case 0xC3: return Op_JumpAddr();
-        case 0xE9: return Op_JumpRegister(&Register.HL);
-        case 0x20: return Op_JumpIf(Flag_Zero, false);
-        case 0x28: return Op_JumpIf(Flag_Zero, true);
-        case 0x30: return Op_JumpIf(Flag_Carry, false);
-        case 0x38: return Op_JumpIf(Flag_Carry, true);
-        case 0xC2: return Op_JumpAddrIf(Flag_Zero, false);
-        case 0xCA: return Op_JumpAddrIf(Flag_Zero, true);
-        case 0xD2: return Op_JumpAddrIf(Flag_Carry, false);
-        case 0xDA: return Op_JumpAddrIf(Flag_Carry, true);
-
-        //Calls
-        case 0xCD: return Op_Call();
-        case 0xC4: return Op_CallIf(Flag_Zero, false);
-        case 0xCC: return Op_CallIf(Flag_Zero, true);
-        case 0xD4: return Op_CallIf(Flag_Carry, false);
-        case 0xDC: return Op_CallIf(Flag_Carry, true);
-
-        //Interrupts
-        case 0xF3: return Op_DisableInterrupts();
-        case 0xFB: return Op_EnableInterrupts();
-
-        //Returns
-        case 0xC9: return Op_Return();
-        case 0xC0: return Op_ReturnIf(Flag_Zero, false);
-        case 0xC8: return Op_ReturnIf(Flag_Zero, true);
-        case 0xD0: return Op_ReturnIf(Flag_Carry, false);
-        case 0xD8: return Op_ReturnIf(Flag_Carry, true);
-
-        case 0xD9: return Op_EnableInterruptsAndReturn();
-
-        //Rotate A Left
-        case 0x07: return Op_RotateRegisterLeftWithCarryA();
-        case 0x17: return Op_RotateRegisterLeftThroughCarryA();
-
-        //Rotate A Right
-        case 0x0F: return Op_RotateRegisterRightWithCarryA();
-        case 0x1F: return Op_RotateRegisterRightThroughCarryA();
-
-        case 0x37: return Op_SetCarryFlag();
-
-        //Restart
-        case 0xC7: return Op_Restart(0x00);
-        case 0xCF: return Op_Restart(0x08);
-        case 0xD7: return Op_Restart(0x10);
-        case 0xDF: return Op_Restart(0x18);
-        case 0xE7: return Op_Restart(0x20);
-        case 0xEF: return Op_Restart(0x28);
-        case 0xF7: return Op_Restart(0x30);
-        case 0xFF: return Op_Restart(0x38);
-
-        //CB
+        PRIMARY_OPCODES(OP_CASE)
+
         case 0xCB:
         {
-            byte extOpCode = ReadMem(Register.PC + 1);
-
-            switch (extOpCode)
+            switch (operand)
             {
-                //Swap
-                case 0x37: return Op_Swap(&Register.A);
-                case 0x30: return Op_Swap(&Register.B);
-                case 0x31: return Op_Swap(&Register.C);
-                case 0x32: return Op_Swap(&Register.D);
-                case 0x33: return Op_Swap(&Register.E);
-                case 0x34: return Op_Swap(&Register.H);
-                case 0x35: return Op_Swap(&Register.L);
-
-                //Set bit
-                case 0xC7: return Op_SetRegisterBit(&Register.A, 0);
-                case 0xCF: return Op_SetRegisterBit(&Register.A, 1);
-                case 0xD7: return Op_SetRegisterBit(&Register.A, 2);
-                case 0xDF: return Op_SetRegisterBit(&Register.A, 3);
-                case 0xE7: return Op_SetRegisterBit(&Register.A, 4);
-                case 0xEF: return Op_SetRegisterBit(&Register.A, 5);
-                case 0xF7: return Op_SetRegisterBit(&Register.A, 6);
-                case 0xFF: return Op_SetRegisterBit(&Register.A, 7);
-                case 0xC0: return Op_SetRegisterBit(&Register.B, 0);
-                case 0xC8: return Op_SetRegisterBit(&Register.B, 1);
-                case 0xD0: return Op_SetRegisterBit(&Register.B, 2);
-                case 0xD8: return Op_SetRegisterBit(&Register.B, 3);
-                case 0xE0: return Op_SetRegisterBit(&Register.B, 4);
-                case 0xE8: return Op_SetRegisterBit(&Register.B, 5);
-                case 0xF0: return Op_SetRegisterBit(&Register.B, 6);
-                case 0xF8: return Op_SetRegisterBit(&Register.B, 7);
-                case 0xC1: return Op_SetRegisterBit(&Register.C, 0);
-                case 0xC9: return Op_SetRegisterBit(&Register.C, 1);
-                case 0xD1: return Op_SetRegisterBit(&Register.C, 2);
-                case 0xD9: return Op_SetRegisterBit(&Register.C, 3);
-                case 0xE1: return Op_SetRegisterBit(&Register.C, 4);
-                case 0xE9: return Op_SetRegisterBit(&Register.C, 5);
-                case 0xF1: return Op_SetRegisterBit(&Register.C, 6);
-                case 0xF9: return Op_SetRegisterBit(&Register.C, 7);
-                case 0xC2: return Op_SetRegisterBit(&Register.D, 0);
-                case 0xCA: return Op_SetRegisterBit(&Register.D, 1);
-                case 0xD2: return Op_SetRegisterBit(&Register.D, 2);
-                case 0xDA: return Op_SetRegisterBit(&Register.D, 3);
-                case 0xE2: return Op_SetRegisterBit(&Register.D, 4);
-                case 0xEA: return Op_SetRegisterBit(&Register.D, 5);
-                case 0xF2: return Op_SetRegisterBit(&Register.D, 6);
-                case 0xFA: return Op_SetRegisterBit(&Register.D, 7);
-                case 0xC3: return Op_SetRegisterBit(&Register.E, 0);
-                case 0xCB: return Op_SetRegisterBit(&Register.E, 1);
-                case 0xD3: return Op_SetRegisterBit(&Register.E, 2);
-                case 0xDB: return Op_SetRegisterBit(&Register.E, 3);
-                case 0xE3: return Op_SetRegisterBit(&Register.E, 4);
-                case 0xEB: return Op_SetRegisterBit(&Register.E, 5);
-                case 0xF3: return Op_SetRegisterBit(&Register.E, 6);
-                case 0xFB: return Op_SetRegisterBit(&Register.E, 7);
-                case 0xC4: return Op_SetRegisterBit(&Register.H, 0);
-                case 0xCC: return Op_SetRegisterBit(&Register.H, 1);
-                case 0xD4: return Op_SetRegisterBit(&Register.H, 2);
-                case 0xDC: return Op_SetRegisterBit(&Register.H, 3);
-                case 0xE4: return Op_SetRegisterBit(&Register.H, 4);
-                case 0xEC: return Op_SetRegisterBit(&Register.H, 5);
-                case 0xF4: return Op_SetRegisterBit(&Register.H, 6);
-                case 0xFC: return Op_SetRegisterBit(&Register.H, 7);
-                case 0xC5: return Op_SetRegisterBit(&Register.L, 0);
-                case 0xCD: return Op_SetRegisterBit(&Register.L, 1);
-                case 0xD5: return Op_SetRegisterBit(&Register.L, 2);
-                case 0xDD: return Op_SetRegisterBit(&Register.L, 3);
-                case 0xE5: return Op_SetRegisterBit(&Register.L, 4);
-                case 0xED: return Op_SetRegisterBit(&Register.L, 5);
-                case 0xF5: return Op_SetRegisterBit(&Register.L, 6);
-                case 0xFD: return Op_SetRegisterBit(&Register.L, 7);
-                case 0xC6: return Op_SetAddrBit(Register.HL, 0);
-                case 0xCE: return Op_SetAddrBit(Register.HL, 1);
-                case 0xD6: return Op_SetAddrBit(Register.HL, 2);
-                case 0xDE: return Op_SetAddrBit(Register.HL, 3);
-                case 0xE6: return Op_SetAddrBit(Register.HL, 4);
-                case 0xEE: return Op_SetAddrBit(Register.HL, 5);
-                case 0xF6: return Op_SetAddrBit(Register.HL, 6);
-                case 0xFE: return Op_SetAddrBit(Register.HL, 7);
-
-                //Test bit
-                case 0x47: return Op_TestRegisterBit(&Register.A, 0);
-                case 0x4F: return Op_TestRegisterBit(&Register.A, 1);
-                case 0x57: return Op_TestRegisterBit(&Register.A, 2);
-                case 0x5F: return Op_TestRegisterBit(&Register.A, 3);
-                case 0x67: return Op_TestRegisterBit(&Register.A, 4);
-                case 0x6F: return Op_TestRegisterBit(&Register.A, 5);
-                case 0x77: return Op_TestRegisterBit(&Register.A, 6);
-                case 0x7F: return Op_TestRegisterBit(&Register.A, 7);
-                case 0x40: return Op_TestRegisterBit(&Register.B, 0);
-                case 0x48: return Op_TestRegisterBit(&Register.B, 1);
-                case 0x50: return Op_TestRegisterBit(&Register.B, 2);
-                case 0x58: return Op_TestRegisterBit(&Register.B, 3);
-                case 0x60: return Op_TestRegisterBit(&Register.B, 4);
-                case 0x68: return Op_TestRegisterBit(&Register.B, 5);
-                case 0x70: return Op_TestRegisterBit(&Register.B, 6);
-                case 0x78: return Op_TestRegisterBit(&Register.B, 7);
-                case 0x41: return Op_TestRegisterBit(&Register.C, 0);
-                case 0x49: return Op_TestRegisterBit(&Register.C, 1);
-                case 0x51: return Op_TestRegisterBit(&Register.C, 2);
-                case 0x59: return Op_TestRegisterBit(&Register.C, 3);
-                case 0x61: return Op_TestRegisterBit(&Register.C, 4);
-                case 0x69: return Op_TestRegisterBit(&Register.C, 5);
-                case 0x71: return Op_TestRegisterBit(&Register.C, 6);
-                case 0x79: return Op_TestRegisterBit(&Register.C, 7);
-                case 0x42: return Op_TestRegisterBit(&Register.D, 0);
-                case 0x4A: return Op_TestRegisterBit(&Register.D, 1);
-                case 0x52: return Op_TestRegisterBit(&Register.D, 2);
-                case 0x5A: return Op_TestRegisterBit(&Register.D, 3);
-                case 0x62: return Op_TestRegisterBit(&Register.D, 4);
-                case 0x6A: return Op_TestRegisterBit(&Register.D, 5);
-                case 0x72: return Op_TestRegisterBit(&Register.D, 6);
-                case 0x7A: return Op_TestRegisterBit(&Register.D, 7);
-                case 0x43: return Op_TestRegisterBit(&Register.E, 0);
-                case 0x4B: return Op_TestRegisterBit(&Register.E, 1);
-                case 0x53: return Op_TestRegisterBit(&Register.E, 2);
-                case 0x5B: return Op_TestRegisterBit(&Register.E, 3);
-                case 0x63: return Op_TestRegisterBit(&Register.E, 4);
-                case 0x6B: return Op_TestRegisterBit(&Register.E, 5);
-                case 0x73: return Op_TestRegisterBit(&Register.E, 6);
-                case 0x7B: return Op_TestRegisterBit(&Register.E, 7);
-                case 0x44: return Op_TestRegisterBit(&Register.H, 0);
-                case 0x4C: return Op_TestRegisterBit(&Register.H, 1);
-                case 0x54: return Op_TestRegisterBit(&Register.H, 2);
-                case 0x5C: return Op_TestRegisterBit(&Register.H, 3);
-                case 0x64: return Op_TestRegisterBit(&Register.H, 4);
-                case 0x6C: return Op_TestRegisterBit(&Register.H, 5);
-                case 0x74: return Op_TestRegisterBit(&Register.H, 6);
-                case 0x7C: return Op_TestRegisterBit(&Register.H, 7);
-                case 0x45: return Op_TestRegisterBit(&Register.L, 0);
-                case 0x4D: return Op_TestRegisterBit(&Register.L, 1);
-                case 0x55: return Op_TestRegisterBit(&Register.L, 2);
-                case 0x5D: return Op_TestRegisterBit(&Register.L, 3);
-                case 0x65: return Op_TestRegisterBit(&Register.L, 4);
-                case 0x6D: return Op_TestRegisterBit(&Register.L, 5);
-                case 0x75: return Op_TestRegisterBit(&Register.L, 6);
-                case 0x7D: return Op_TestRegisterBit(&Register.L, 7);
-                case 0x46: return Op_TestAddrBit(Register.HL, 0);
-                case 0x4E: return Op_TestAddrBit(Register.HL, 1);
-                case 0x56: return Op_TestAddrBit(Register.HL, 2);
-                case 0x5E: return Op_TestAddrBit(Register.HL, 3);
-                case 0x66: return Op_TestAddrBit(Register.HL, 4);
-                case 0x6E: return Op_TestAddrBit(Register.HL, 5);
-                case 0x76: return Op_TestAddrBit(Register.HL, 6);
-                case 0x7E: return Op_TestAddrBit(Register.HL, 7);
-
-                //Reset Bit
-                case 0x87: return Op_ResetRegisterBit(&Register.A, 0);
-                case 0x8F: return Op_ResetRegisterBit(&Register.A, 1);
-                case 0x97: return Op_ResetRegisterBit(&Register.A, 2);
-                case 0x9F: return Op_ResetRegisterBit(&Register.A, 3);
-                case 0xA7: return Op_ResetRegisterBit(&Register.A, 4);
-                case 0xAF: return Op_ResetRegisterBit(&Register.A, 5);
-                case 0xB7: return Op_ResetRegisterBit(&Register.A, 6);
-                case 0xBF: return Op_ResetRegisterBit(&Register.A, 7);
-                case 0x80: return Op_ResetRegisterBit(&Register.B, 0);
-                case 0x88: return Op_ResetRegisterBit(&Register.B, 1);
-                case 0x90: return Op_ResetRegisterBit(&Register.B, 2);
-                case 0x98: return Op_ResetRegisterBit(&Register.B, 3);
-                case 0xA0: return Op_ResetRegisterBit(&Register.B, 4);
-                case 0xA8: return Op_ResetRegisterBit(&Register.B, 5);
-                case 0xB0: return Op_ResetRegisterBit(&Register.B, 6);
-                case 0xB8: return Op_ResetRegisterBit(&Register.B, 7);
-                case 0x81: return Op_ResetRegisterBit(&Register.C, 0);
-                case 0x89: return Op_ResetRegisterBit(&Register.C, 1);
-                case 0x91: return Op_ResetRegisterBit(&Register.C, 2);
-                case 0x99: return Op_ResetRegisterBit(&Register.C, 3);
-                case 0xA1: return Op_ResetRegisterBit(&Register.C, 4);
-                case 0xA9: return Op_ResetRegisterBit(&Register.C, 5);
-                case 0xB1: return Op_ResetRegisterBit(&Register.C, 6);
-                case 0xB9: return Op_ResetRegisterBit(&Register.C, 7);
-                case 0x82: return Op_ResetRegisterBit(&Register.D, 0);
-                case 0x8A: return Op_ResetRegisterBit(&Register.D, 1);
-                case 0x92: return Op_ResetRegisterBit(&Register.D, 2);
-                case 0x9A: return Op_ResetRegisterBit(&Register.D, 3);
-                case 0xA2: return Op_ResetRegisterBit(&Register.D, 4);
-                case 0xAA: return Op_ResetRegisterBit(&Register.D, 5);
-                case 0xB2: return Op_ResetRegisterBit(&Register.D, 6);
-                case 0xBA: return Op_ResetRegisterBit(&Register.D, 7);
-                case 0x83: return Op_ResetRegisterBit(&Register.E, 0);
-                case 0x8B: return Op_ResetRegisterBit(&Register.E, 1);
-                case 0x93: return Op_ResetRegisterBit(&Register.E, 2);
-                case 0x9B: return Op_ResetRegisterBit(&Register.E, 3);
-                case 0xA3: return Op_ResetRegisterBit(&Register.E, 4);
-                case 0xAB: return Op_ResetRegisterBit(&Register.E, 5);
-                case 0xB3: return Op_ResetRegisterBit(&Register.E, 6);
-                case 0xBB: return Op_ResetRegisterBit(&Register.E, 7);
-                case 0x84: return Op_ResetRegisterBit(&Register.H, 0);
-                case 0x8C: return Op_ResetRegisterBit(&Register.H, 1);
-                case 0x94: return Op_ResetRegisterBit(&Register.H, 2);
-                case 0x9C: return Op_ResetRegisterBit(&Register.H, 3);
-                case 0xA4: return Op_ResetRegisterBit(&Register.H, 4);
-                case 0xAC: return Op_ResetRegisterBit(&Register.H, 5);
-                case 0xB4: return Op_ResetRegisterBit(&Register.H, 6);
-                case 0xBC: return Op_ResetRegisterBit(&Register.H, 7);
-                case 0x85: return Op_ResetRegisterBit(&Register.L, 0);
-                case 0x8D: return Op_ResetRegisterBit(&Register.L, 1);
-                case 0x95: return Op_ResetRegisterBit(&Register.L, 2);
-                case 0x9D: return Op_ResetRegisterBit(&Register.L, 3);
-                case 0xA5: return Op_ResetRegisterBit(&Register.L, 4);
-                case 0xAD: return Op_ResetRegisterBit(&Register.L, 5);
-                case 0xB5: return Op_ResetRegisterBit(&Register.L, 6);
-                case 0xBD: return Op_ResetRegisterBit(&Register.L, 7);
-                case 0x86: return Op_ResetAddrBit(Register.HL, 0);
-                case 0x8E: return Op_ResetAddrBit(Register.HL, 1);
-                case 0x96: return Op_ResetAddrBit(Register.HL, 2);
-                case 0x9E: return Op_ResetAddrBit(Register.HL, 3);
-                case 0xA6: return Op_ResetAddrBit(Register.HL, 4);
-                case 0xAE: return Op_ResetAddrBit(Register.HL, 5);
-                case 0xB6: return Op_ResetAddrBit(Register.HL, 6);
-                case 0xBE: return Op_ResetAddrBit(Register.HL, 7);
-
-                //Rotate Left
-                case 0x07: return Op_RotateRegisterLeftWithCarry(&Register.A);
-                case 0x00: return Op_RotateRegisterLeftWithCarry(&Register.B);
-                case 0x01: return Op_RotateRegisterLeftWithCarry(&Register.C);
-                case 0x02: return Op_RotateRegisterLeftWithCarry(&Register.D);
-                case 0x03: return Op_RotateRegisterLeftWithCarry(&Register.E);
-                case 0x04: return Op_RotateRegisterLeftWithCarry(&Register.H);
-                case 0x05: return Op_RotateRegisterLeftWithCarry(&Register.L);
-                case 0x06: return Op_RotateAddrLeftWithCarry(Register.HL);
-
-                case 0x17: return Op_RotateRegisterLeftThroughCarry(&Register.A);
-                case 0x10: return Op_RotateRegisterLeftThroughCarry(&Register.B);
-                case 0x11: return Op_RotateRegisterLeftThroughCarry(&Register.C);
-                case 0x12: return Op_RotateRegisterLeftThroughCarry(&Register.D);
-                case 0x13: return Op_RotateRegisterLeftThroughCarry(&Register.E);
-                case 0x14: return Op_RotateRegisterLeftThroughCarry(&Register.H);
-                case 0x15: return Op_RotateRegisterLeftThroughCarry(&Register.L);
-                case 0x16: return Op_RotateAddrLeftThroughCarry(Register.HL);
-
-                //Rotate Right
-                case 0x0F: return Op_RotateRegisterRightWithCarry(&Register.A);
-                case 0x08: return Op_RotateRegisterRightWithCarry(&Register.B);
-                case 0x09: return Op_RotateRegisterRightWithCarry(&Register.C);
-                case 0x0A: return Op_RotateRegisterRightWithCarry(&Register.D);
-                case 0x0B: return Op_RotateRegisterRightWithCarry(&Register.E);
-                case 0x0C: return Op_RotateRegisterRightWithCarry(&Register.H);
-                case 0x0D: return Op_RotateRegisterRightWithCarry(&Register.L);
-                case 0x0E: return Op_RotateAddrRightWithCarry(Register.HL);
-                
-                case 0x1F: return Op_RotateRegisterRightThroughCarry(&Register.A);
-                case 0x18: return Op_RotateRegisterRightThroughCarry(&Register.B);
-                case 0x19: return Op_RotateRegisterRightThroughCarry(&Register.C);
-                case 0x1A: return Op_RotateRegisterRightThroughCarry(&Register.D);
-                case 0x1B: return Op_RotateRegisterRightThroughCarry(&Register.E);
-                case 0x1C: return Op_RotateRegisterRightThroughCarry(&Register.H);
-                case 0x1D: return Op_RotateRegisterRightThroughCarry(&Register.L);
-                case 0x1E: return Op_RotateAddrRightThroughCarry(Register.HL);
-
-                //Shift Left
-                case 0x27: return Op_ShiftRegisterLeft(&Register.A);
-                case 0x20: return Op_ShiftRegisterLeft(&Register.B);
-                case 0x21: return Op_ShiftRegisterLeft(&Register.C);
-                case 0x22: return Op_ShiftRegisterLeft(&Register.D);
-                case 0x23: return Op_ShiftRegisterLeft(&Register.E);
-                case 0x24: return Op_ShiftRegisterLeft(&Register.H);
-                case 0x25: return Op_ShiftRegisterLeft(&Register.L);
-                case 0x26: return Op_ShiftAddrLeft(Register.HL);
-
-                //Shift Right
-                case 0x2F: return Op_ShiftRegisterRight(&Register.A, false);
-                case 0x28: return Op_ShiftRegisterRight(&Register.B, false);
-                case 0x29: return Op_ShiftRegisterRight(&Register.C, false);
-                case 0x2A: return Op_ShiftRegisterRight(&Register.D, false);
-                case 0x2B: return Op_ShiftRegisterRight(&Register.E, false);
-                case 0x2C: return Op_ShiftRegisterRight(&Register.H, false);
-                case 0x2D: return Op_ShiftRegisterRight(&Register.L, false);
-                case 0x2E: return Op_ShiftAddrRight(Register.HL, false);
-
-                case 0x3F: return Op_ShiftRegisterRight(&Register.A, true);
-                case 0x38: return Op_ShiftRegisterRight(&Register.B, true);
-                case 0x39: return Op_ShiftRegisterRight(&Register.C, true);
-                case 0x3A: return Op_ShiftRegisterRight(&Register.D, true);
-                case 0x3B: return Op_ShiftRegisterRight(&Register.E, true);
-                case 0x3C: return Op_ShiftRegisterRight(&Register.H, true);
-                case 0x3D: return Op_ShiftRegisterRight(&Register.L, true);
-                case 0x3E: return Op_ShiftAddrRight(Register.HL, false);
-
-                default:
-                    DebugPrint("Unhandled extended opcode 0x%02X!\n", extOpCode);
-                    assert(0);
+                EXTENDED_OPCODES(OP_CASE)
+
+                default: return Op_ExtendedUnhandled(pGB, 0);
             }
         }
-        break;
 
-        case 0x00: return Op_NOP();
-        case 0x76: return Op_Halt();
+        default: return Op_Unhandled(pGB, 0);
+    }
+}
+
+static cycles HandleOpCodeTable(struct GBInstance* pGB)
+{
+    byte opCode = FetchByte(pGB, pGB->CPU.Register.PC);
+    return OpTable[opCode](pGB, ReadOperand(pGB, pGB->CPU.Register.PC, opCode));
+}
+
+#if THREADED_DISPATCH_SUPPORTED
+//Uses computed gotos (GCC/Clang extension) to jump straight to the handler.
+#define OP_LABEL_ADDR(opCode, length, numCycles, op) [opCode] = &&Label_##opCode,
+#define OP_LABEL(opCode, length, numCycles, op) Label_##opCode: return op;
+#define EXTENDED_OP_LABEL_ADDR(opCode, length, numCycles, op) [opCode] = &&ExtendedLabel_##opCode,
+#define EXTENDED_OP_LABEL(opCode, length, numCycles, op) ExtendedLabel_##opCode: return op;
+
+static cycles HandleOpCodeThreaded(struct GBInstance* pGB)
+{
+    static void* const OpLabels[256] = {
+        [0 ... 255] = &&Label_Unhandled,
+        PRIMARY_OPCODES(OP_LABEL_ADDR)
+        [0xCB] = &&Label_Extended
+    };
+
+    static void* const ExtendedOpLabels[256] = {
+        [0 ... 255] = &&ExtendedLabel_Unhandled,
+        EXTENDED_OPCODES(EXTENDED_OP_LABEL_ADDR)
+    };
+
+    byte opCode = FetchByte(pGB, pGB->CPU.Register.PC);
+    uint16_t operand = ReadOperand(pGB, pGB->CPU.Register.PC, opCode);
+
+    goto *OpLabels[opCode];
+
+    PRIMARY_OPCODES(OP_LABEL)
+
+Label_Extended:
+    goto *ExtendedOpLabels[operand];
+
+    EXTENDED_OPCODES(EXTENDED_OP_LABEL)
+
+Label_Unhandled:
+    return Op_Unhandled(pGB, 0);
+
+ExtendedLabel_Unhandled:
+    return Op_ExtendedUnhandled(pGB, 0);
+}
+#endif
+
+//Block cache. Straight-line runs of code are decoded once into handler/operand pairs and then run
+//from the cache, saving the fetch and decode for every instruction. Blocks are keyed by the host
+//address of their code as well as the PC so that different banks mapped to the same address don't
+//clash.
+#define BLOCK_CACHE_SIZE 2048   //Must be a power of 2.
+#define BLOCK_OP_POOL_SIZE (16 * 1024)
+#define MAX_BLOCK_OPS 32
+#define MAX_BLOCK_CYCLES 128    //Stops the rest of the system falling too far behind the CPU.
+
+struct DecodedOp
+{
+    OpHandler Handler;
+    uint16_t Operand;
+    byte OpCode;
+    bool Extended;
+};
+
+//Loops that are common enough to be worth running in one go, see DetectFusedLoop().
+enum FusedLoop
+{
+    FusedLoop_None,
+    FusedLoop_Copy,     //LD A,(HL+)  LD (DE),A  INC DE  DEC BC  LD A,B  OR C  JR NZ
+    FusedLoop_Fill,     //LD (HL+/-),A  DEC r  JR NZ
+    FusedLoop_Delay8,   //DEC r  JR NZ
+    FusedLoop_Delay16   //DEC rr  LD A,r  OR r  JR NZ
+};
+
+struct CodeBlock
+{
+    const byte* pCode;  //Host address of the first instruction, NULL if the entry is empty.
+    uint16_t StartAddr;
+    uint16_t EndAddr;   //One past the last byte of the block.
+    int NumOps;
+    cycles NumCycles;   //Worst case, ie. assuming any branch is taken.
+    struct DecodedOp* pOps;
+    int NumRuns;
+    JitBlockFunc pNative;
+    bool IsIdleLoop;    //See IsIdleLoop().
+    enum FusedLoop FusedLoop;
+};
+
+struct CPUBlockCache
+{
+    struct CodeBlock Blocks[BLOCK_CACHE_SIZE];
+    struct DecodedOp OpPool[BLOCK_OP_POOL_SIZE];
+    int OpPoolUsed;
+};
+
+#define JIT_THRESHOLD 16    //Number of runs before a block is worth compiling.
+
+static bool IsCacheableAddr(uint16_t addr)
+{
+    //Cartridge RAM can be banked without being written to and IO/HRAM are too volatile to be worth it.
+    return addr < 0xA000 || (addr >= 0xC000 && addr < 0xFE00);
+}
+
+static bool EndsBlock(byte opCode)
+{
+    switch (opCode)
+    {
+        //Anything that changes the PC other than by stepping over the instruction.
+        case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:                          //JR
+        case 0xC3: case 0xC2: case 0xCA: case 0xD2: case 0xDA: case 0xE9:               //JP
+        case 0xCD: case 0xC4: case 0xCC: case 0xD4: case 0xDC:                          //CALL
+        case 0xC9: case 0xC0: case 0xC8: case 0xD0: case 0xD8: case 0xD9:               //RET
+        case 0xC7: case 0xCF: case 0xD7: case 0xDF: case 0xE7: case 0xEF: case 0xF7: case 0xFF:    //RST
+        //Interrupts need checking after these.
+        case 0x76: case 0xF3: case 0xFB:
+            return true;
 
         default:
-            DebugPrint("Unhandled opcode 0x%02X!\n", opCode);
-            assert(0);
+            return false;
     }
+}
 
-    return 0;
+//Spots blocks that just spin polling IO/HRAM (eg. waiting for LY to hit a line) until something else
+//changes it. They have to load A from IO/HRAM, only test it and then branch back to the start, so
+//running them again gives exactly the same result until the rest of the system moves on.
+//Whether the block ends with a conditional jump back to its start.
+static bool LoopsToStart(const struct CodeBlock* pBlock)
+{
+    const struct DecodedOp* pLastOp = &pBlock->pOps[pBlock->NumOps - 1];
+
+    if (pLastOp->Extended)
+    {
+        return false;
+    }
+
+    switch (pLastOp->OpCode)
+    {
+        case 0x20: case 0x28: case 0x30: case 0x38:    //JR cc
+            return (uint16_t)(pBlock->EndAddr + FromTwosComplement((byte)pLastOp->Operand)) == pBlock->StartAddr;
+
+        case 0xC2: case 0xCA: case 0xD2: case 0xDA:    //JP cc
+            return pLastOp->Operand == pBlock->StartAddr;
+
+        default:
+            return false;
+    }
 }
 
-void CheckInterrupts()
+static bool IsIdleLoop(const struct CodeBlock* pBlock)
 {
-    if (!IME || *Register_IF == 0)
-        return;
+    const struct DecodedOp* pFirstOp = &pBlock->pOps[0];
+    const struct DecodedOp* pLastOp = &pBlock->pOps[pBlock->NumOps - 1];
+
+    if (pBlock->NumOps < 2 || pFirstOp->Extended || pLastOp->Extended)
+    {
+        return false;
+    }
+
+    //LDH A,(n), LD A,(C) or LD A,(nn) from the top page.
+    if (pFirstOp->OpCode != 0xF0 && pFirstOp->OpCode != 0xF2 && !(pFirstOp->OpCode == 0xFA && pFirstOp->Operand >= 0xFF00))
+    {
+        return false;
+    }
 
-    for (int i = 0; i < NumInterrupts; ++i)
+    for (int i = 1; i < pBlock->NumOps - 1; ++i)
     {
-        if (IsRegisterBitSet(Register_IE, i) && IsRegisterBitSet(Register_IF, i))
+        const struct DecodedOp* pOp = &pBlock->pOps[i];
+
+        if (pOp->Extended)
         {
-            IME = false;
-            CPURunning = true;
-            UnsetRegisterBit(Register_IF, i);
-            StackPush(Register.PC);
-            Register.PC = InterruptOp[i];
-            break;
+            //BIT n,A
+            if ((pOp->OpCode & 0xC7) != 0x47)
+            {
+                return false;
+            }
+        }
+        else if (pOp->OpCode != 0xFE && pOp->OpCode != 0xE6 && pOp->OpCode != 0xA7 && pOp->OpCode != 0xB7
+            && !(pOp->OpCode >= 0xB8 && pOp->OpCode <= 0xBF && pOp->OpCode != 0xBE))
+        {
+            //Not CP n, AND n, AND A, OR A or CP r.
+            return false;
         }
     }
+
+    return LoopsToStart(pBlock);
+}
+
+//What an idle loop's first op reads. Nothing in the loop changes C.
+static uint16_t IdleLoopReadAddr(struct GBInstance* pGB, const struct CodeBlock* pBlock)
+{
+    const struct DecodedOp* pFirstOp = &pBlock->pOps[0];
+
+    switch (pFirstOp->OpCode)
+    {
+        case 0xF0: return 0xFF00 + (pFirstOp->Operand & 0xFF);
+        case 0xF2: return 0xFF00 + pGB->CPU.Register.C;
+        default: return pFirstOp->Operand;
+    }
+}
+
+static bool IsInterruptPending(struct GBInstance* pGB)
+{
+    return pGB->CPU.PendingInterrupts != 0;
+}
+
+//Called after an idle loop has gone round once. Works out how many more times it would go round
+//before the rest of the system changes anything it's reading and skips them. untilChange is counted
+//from the start of the loop. Returns the extra cycles.
+static cycles SkipIdleLoop(struct GBInstance* pGB, const struct CodeBlock* pBlock, cycles loopCycles, cycles untilChange)
+{
+    if (IsInterruptPending(pGB) || loopCycles <= 0)
+    {
+        return 0;
+    }
+
+    //DIV and TIMA go up without an event, so a loop polling them has to ask the timer too. It's now the
+    //scheduler's cycle plus whatever this run hasn't handed over yet, and the loop started loopCycles ago.
+    uint16_t readAddr = IdleLoopReadAddr(pGB, pBlock);
+
+    if (readAddr == REGISTER_DIV_ADDR || readAddr == REGISTER_TIMA_ADDR)
+    {
+        uint64_t loopStart = SchedulerGetCycles(pGB) + pGB->CPU.PendingCycles - loopCycles;
+        untilChange = MIN(untilChange, TimerCyclesUntilIncrement(pGB, loopStart));
+    }
+
+    //Everything up to (but not including) the cycle the next change happens on is safe to skip.
+    cycles numLoops = (untilChange - 1) / loopCycles;
+
+    if (numLoops <= 0)
+    {
+        return 0;
+    }
+
+    cycles skippedCycles = numLoops * loopCycles;
+    pGB->CPUCold.IdleCyclesSkipped += skippedCycles;
+
+    return skippedCycles;
 }
 
-void CPUSetInterrupt(int interruptIdx)
+//The register decremented by DEC r/DEC rr, NULL if it's not one of those.
+static byte* DecrementedRegister8(struct GBInstance* pGB, const struct DecodedOp* pOp)
 {
-    SetRegisterBit(Register_IF, interruptIdx);
+    if (pOp->Extended)
+    {
+        return NULL;
+    }
+
+    switch (pOp->OpCode)
+    {
+        case 0x05: return &pGB->CPU.Register.B;
+        case 0x0D: return &pGB->CPU.Register.C;
+        case 0x15: return &pGB->CPU.Register.D;
+        case 0x1D: return &pGB->CPU.Register.E;
+        case 0x25: return &pGB->CPU.Register.H;
+        case 0x2D: return &pGB->CPU.Register.L;
+        case 0x3D: return &pGB->CPU.Register.A;
+        default: return NULL;
+    }
 }
 
-bool CPUInit(uint16_t startAddr, byte interruptOps[], int numInterrupts)
+static uint16_t* DecrementedRegister16(struct GBInstance* pGB, const struct DecodedOp* pOp)
 {
-    Register.PC = startAddr;
+    if (pOp->Extended)
+    {
+        return NULL;
+    }
+
+    switch (pOp->OpCode)
+    {
+        case 0x0B: return &pGB->CPU.Register.BC;
+        case 0x1B: return &pGB->CPU.Register.DE;
+        case 0x2B: return &pGB->CPU.Register.HL;
+        default: return NULL;
+    }
+}
 
-    CPURunning = true;
+static bool MatchesOpCodes(const struct CodeBlock* pBlock, const byte* pOpCodes, int numOps)
+{
+    if (pBlock->NumOps != numOps)
+    {
+        return false;
+    }
 
-    NumInterrupts = numInterrupts;
-    for (int i = 0; i < NumInterrupts; ++i)
+    for (int i = 0; i < numOps; ++i)
     {
-        InterruptOp[i] = interruptOps[i];
+        if (pBlock->pOps[i].Extended || pBlock->pOps[i].OpCode != pOpCodes[i])
+        {
+            return false;
+        }
     }
 
     return true;
 }
 
-cycles CPUTick()
+static enum FusedLoop DetectFusedLoop(struct GBInstance* pGB, const struct CodeBlock* pBlock)
 {
-    CheckInterrupts();
+    static const byte CopyOpCodes[] = { 0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1, 0x20 };
 
-    if (CPURunning)
+    const struct DecodedOp* pOps = pBlock->pOps;
+
+    //All of them count down to zero.
+    if (pOps[pBlock->NumOps - 1].OpCode != 0x20 || !LoopsToStart(pBlock))
     {
-        return HandleOpCode();
+        return FusedLoop_None;
     }
 
-    return 0;
+    if (MatchesOpCodes(pBlock, CopyOpCodes, sizeof(CopyOpCodes)))
+    {
+        return FusedLoop_Copy;
+    }
+
+    if (pBlock->NumOps == 2 && DecrementedRegister8(pGB, &pOps[0]) != NULL)
+    {
+        return FusedLoop_Delay8;
+    }
+
+    //The counter can't be the fill value or the address.
+    byte* pCounter = pBlock->NumOps == 3 ? DecrementedRegister8(pGB, &pOps[1]) : NULL;
+
+    if (pCounter != NULL && pCounter != &pGB->CPU.Register.A && pCounter != &pGB->CPU.Register.H && pCounter != &pGB->CPU.Register.L
+        && !pOps[0].Extended && (pOps[0].OpCode == 0x22 || pOps[0].OpCode == 0x32))
+    {
+        return FusedLoop_Fill;
+    }
+
+    //LD A,high  OR low  (or the other way round) to test the whole register pair.
+    uint16_t* pCounter16 = pBlock->NumOps == 4 ? DecrementedRegister16(pGB, &pOps[0]) : NULL;
+
+    if (pCounter16 != NULL && !pOps[1].Extended && !pOps[2].Extended)
+    {
+        byte high = 0x78 + (pOps[0].OpCode >> 4) * 2;    //LD A,B/D/H
+        byte low = high + 1;                            //LD A,C/E/L
+
+        if ((pOps[1].OpCode == high && pOps[2].OpCode == (byte)(low + 0x38))
+            || (pOps[1].OpCode == low && pOps[2].OpCode == (byte)(high + 0x38)))
+        {
+            return FusedLoop_Delay16;
+        }
+    }
+
+    return FusedLoop_None;
+}
+
+//Whether size bytes from addr are plain memory that's contiguous on the host, ie. it can be bulk
+//copied without missing any side effects.
+static bool IsPlainMemory(struct GBInstance* pGB, uint16_t addr, int size, bool write)
+{
+    int end = addr + size;
+
+    if (size <= 0 || end > 0xFFFF)
+    {
+        return false;
+    }
+
+    //Writes to ROM and everything from OAM up (apart from HRAM) have side effects. So can writes to
+    //cartridge RAM if it's disabled or the clock is mapped there instead, and writes to VRAM are tracked.
+    bool inHRAM = addr >= 0xFF80;
+    bool inVRAM = addr < VRAM_ADDR + VRAM_SIZE && end > VRAM_ADDR;
+    bool inCartRAM = addr < CART_RAM_ADDR + CART_RAM_SIZE && end > CART_RAM_ADDR;
+    bool inRange = write ? (addr >= ROM_SIZE && end <= 0xFE00 && !inVRAM && !inCartRAM) : end <= 0xFE00;
+
+    if (!inHRAM && !inRange)
+    {
+        return false;
+    }
+
+    if (write)
+    {
+        //Overwriting cached code needs to go through WriteMem.
+        for (int line = addr >> CPU_CODE_LINE_SHIFT; line <= (end - 1) >> CPU_CODE_LINE_SHIFT; ++line)
+        {
+            if (pGB->CPUCold.CodeLines[line])
+            {
+                return false;
+            }
+        }
+    }
+
+    return AccessMem(pGB, end - 1) - AccessMem(pGB, addr) == size - 1;
+}
+
+//Runs all but the last time round a fused loop in one go. The last time round is left to the block
+//itself so that everything the loop leaves behind (the flags, A etc.) ends up exactly right. Like the
+//idle loops, it only goes as far as untilChange. Returns the cycles taken, 0 if the loop needs to
+//be run normally.
+static cycles RunFusedLoop(struct GBInstance* pGB, const struct CodeBlock* pBlock, cycles untilChange)
+{
+    const struct DecodedOp* pOps = pBlock->pOps;
+    byte* pCounter = NULL;
+    uint16_t* pCounter16 = NULL;
+    int numLoops = 0;
+
+    switch (pBlock->FusedLoop)
+    {
+        case FusedLoop_Copy:
+            pCounter16 = &pGB->CPU.Register.BC;
+            break;
+
+        case FusedLoop_Fill:
+            pCounter = DecrementedRegister8(pGB, &pOps[1]);
+            break;
+
+        case FusedLoop_Delay8:
+            pCounter = DecrementedRegister8(pGB, &pOps[0]);
+            break;
+
+        case FusedLoop_Delay16:
+            pCounter16 = DecrementedRegister16(pGB, &pOps[0]);
+            break;
+
+        default:
+            return 0;
+    }
+
+    //Counting down from 0 goes all the way round.
+    if (pCounter != NULL)
+    {
+        numLoops = *pCounter == 0 ? 0x100 : *pCounter;
+    }
+    else
+    {
+        numLoops = *pCounter16 == 0 ? 0x10000 : *pCounter16;
+    }
+
+    numLoops = MIN(numLoops - 1, (untilChange - 1) / pBlock->NumCycles);
+
+    if (numLoops <= 0)
+    {
+        return 0;
+    }
+
+    if (pBlock->FusedLoop == FusedLoop_Copy)
+    {
+        uint16_t from = pGB->CPU.Register.HL;
+        uint16_t to = pGB->CPU.Register.DE;
+
+        //Copying forwards onto itself repeats the data so leave that to the interpreter.
+        if ((to > from && to < from + numLoops) || !IsPlainMemory(pGB, from, numLoops, false) || !IsPlainMemory(pGB, to, numLoops, true))
+        {
+            return 0;
+        }
+
+        memmove(AccessMem(pGB, to), AccessMem(pGB, from), numLoops);
+        pGB->CPU.Register.HL += numLoops;
+        pGB->CPU.Register.DE += numLoops;
+    }
+    else if (pBlock->FusedLoop == FusedLoop_Fill)
+    {
+        bool increment = pOps[0].OpCode == 0x22;
+        uint16_t start = increment ? pGB->CPU.Register.HL : pGB->CPU.Register.HL - (numLoops - 1);
+
+        if ((!increment && pGB->CPU.Register.HL < numLoops - 1) || !IsPlainMemory(pGB, start, numLoops, true))
+        {
+            return 0;
+        }
+
+        memset(AccessMem(pGB, start), pGB->CPU.Register.A, numLoops);
+        pGB->CPU.Register.HL = increment ? pGB->CPU.Register.HL + numLoops : pGB->CPU.Register.HL - numLoops;
+    }
+
+    if (pCounter != NULL)
+    {
+        *pCounter -= numLoops;
+    }
+    else
+    {
+        *pCounter16 -= numLoops;
+    }
+
+    pGB->CPUCold.InstructionCount += numLoops * pBlock->NumOps;
+    return numLoops * pBlock->NumCycles;
+}
+
+static struct CodeBlock* DecodeBlock(struct GBInstance* pGB, struct CodeBlock* pBlock, const byte* pCode, uint16_t startAddr)
+{
+    if (pGB->CPU.pBlockCache->OpPoolUsed + MAX_BLOCK_OPS > BLOCK_OP_POOL_SIZE)
+    {
+        CPUFlushBlockCache(pGB);
+    }
+
+    pBlock->pCode = pCode;
+    pBlock->StartAddr = startAddr;
+    pBlock->NumOps = 0;
+    pBlock->NumCycles = 0;
+    pBlock->NumRuns = 0;
+    pBlock->pNative = NULL;
+    pBlock->pOps = &pGB->CPU.pBlockCache->OpPool[pGB->CPU.pBlockCache->OpPoolUsed];
+
+    uint16_t addr = startAddr;
+
+    //Blocks don't cross a page so they never straddle the boot ROM, a bank or a cacheable region.
+    while ((addr & 0xFF00) == (startAddr & 0xFF00) && pBlock->NumOps < MAX_BLOCK_OPS)
+    {
+        byte opCode = FetchByte(pGB, addr);
+        uint16_t operand = ReadOperand(pGB, addr, opCode);
+        OpHandler handler = OpTable[opCode];
+        cycles numCycles = OpCycles[opCode];
+        bool extended = opCode == 0xCB;
+
+        if (extended)
+        {
+            handler = ExtendedOpTable[operand];
+            numCycles = ExtendedOpCycles[operand];
+            operand = 0;
+        }
+
+        //Leave anything unhandled to the interpreter so it gets reported properly.
+        if (handler == &Op_Unhandled || handler == &Op_ExtendedUnhandled)
+        {
+            break;
+        }
+
+        if (pBlock->NumOps > 0 && pBlock->NumCycles + numCycles > MAX_BLOCK_CYCLES)
+        {
+            break;
+        }
+
+        pBlock->pOps[pBlock->NumOps].Handler = handler;
+        pBlock->pOps[pBlock->NumOps].Operand = operand;
+        pBlock->pOps[pBlock->NumOps].OpCode = extended ? ReadMem(pGB, addr + 1) : opCode;
+        pBlock->pOps[pBlock->NumOps].Extended = extended;
+        pBlock->NumOps++;
+        pBlock->NumCycles += numCycles;
+
+        addr += OpLength[opCode];
+
+        if (EndsBlock(opCode))
+        {
+            break;
+        }
+    }
+
+    if (pBlock->NumOps == 0)
+    {
+        pBlock->pCode = NULL;
+        return NULL;
+    }
+
+    pBlock->EndAddr = addr;
+    pBlock->IsIdleLoop = IsIdleLoop(pBlock);
+    pBlock->FusedLoop = DetectFusedLoop(pGB, pBlock);
+    pGB->CPU.pBlockCache->OpPoolUsed += pBlock->NumOps;
+
+    //Keep track of code in RAM so the block can be thrown away if it's overwritten.
+    if (startAddr >= ROM_SIZE)
+    {
+        for (int line = startAddr >> CPU_CODE_LINE_SHIFT; line <= (addr - 1) >> CPU_CODE_LINE_SHIFT; ++line)
+        {
+            pGB->CPUCold.CodeLines[line] = true;
+        }
+    }
+
+    return pBlock;
+}
+
+static struct CodeBlock* LookupBlock(struct GBInstance* pGB, uint16_t addr)
+{
+    if (!IsCacheableAddr(addr))
+    {
+        return NULL;
+    }
+
+    const byte* pCode = AccessMem(pGB, addr);
+    uintptr_t key = (uintptr_t)pCode;
+    struct CodeBlock* pBlock = &pGB->CPU.pBlockCache->Blocks[(key ^ (key >> 12)) & (BLOCK_CACHE_SIZE - 1)];
+
+    if (pBlock->pCode == pCode && pBlock->StartAddr == addr)
+    {
+        return pBlock;
+    }
+
+    return DecodeBlock(pGB, pBlock, pCode, addr);
+}
+
+//Each op's cycles are handed over as it goes, so anything catching up with the CPU part way through
+//the block gets up to the op doing it.
+static cycles RunBlock(struct GBInstance* pGB, const struct CodeBlock* pBlock)
+{
+    cycles numCycles = 0;
+
+    for (int i = 0; i < pBlock->NumOps; ++i)
+    {
+        cycles opCycles = pBlock->pOps[i].Handler(pGB, pBlock->pOps[i].Operand);
+        pGB->CPU.PendingCycles += opCycles;
+        numCycles += opCycles;
+    }
+
+    pGB->CPUCold.InstructionCount += pBlock->NumOps;
+    return numCycles;
+}
+
+void CPUInvalidateCode(struct GBInstance* pGB, uint16_t addr)
+{
+    uint16_t lineStart = addr & ~(CPU_CODE_LINE_SIZE - 1);
+    uint16_t lineEnd = lineStart + CPU_CODE_LINE_SIZE;
+
+    for (int i = 0; i < BLOCK_CACHE_SIZE; ++i)
+    {
+        struct CodeBlock* pBlock = &pGB->CPU.pBlockCache->Blocks[i];
+
+        if (pBlock->pCode != NULL && pBlock->StartAddr < lineEnd && pBlock->EndAddr > lineStart)
+        {
+            pBlock->pCode = NULL;
+        }
+    }
+
+    pGB->CPUCold.CodeLines[addr >> CPU_CODE_LINE_SHIFT] = false;
+}
+
+static void CompileBlock(struct GBInstance* pGB, struct CodeBlock* pBlock)
+{
+    struct JitOp ops[MAX_BLOCK_OPS];
+
+    for (int i = 0; i < pBlock->NumOps; ++i)
+    {
+        const struct DecodedOp* pOp = &pBlock->pOps[i];
+
+        ops[i].Handler = pOp->Handler;
+        ops[i].Operand = pOp->Operand;
+        ops[i].OpCode = pOp->OpCode;
+        ops[i].Extended = pOp->Extended;
+        ops[i].Length = pOp->Extended ? 2 : OpLength[pOp->OpCode];
+        ops[i].NumCycles = pOp->Extended ? ExtendedOpCycles[pOp->OpCode] : OpCycles[pOp->OpCode];
+    }
+
+    pBlock->pNative = JitCompileBlock(pGB->CPUCold.pJitArena, ops, pBlock->NumOps, pBlock->StartAddr);
+
+    if (pBlock->pNative == NULL)
+    {
+        //Out of space so start again next tick. This block gets interpreted in the meantime.
+        pGB->CPU.JitFlushPending = true;
+    }
+}
+
+//Runs the block through both the interpreter and the compiled code and makes sure they agree. The
+//interpreter's results are the ones that are kept. Only memory is snapshotted, so a block that writes
+//anywhere else (cartridge RAM, bank controllers, IO, VRAM) can't be run twice and isn't checked. The
+//same goes for a block that had the rest of the system catch up with it, as that can't be undone.
+static cycles RunBlockSelfCheck(struct GBInstance* pGB, const struct CodeBlock* pBlock)
+{
+    byte* StartMem = pGB->CPUCold.pSelfCheckMem;
+    byte* InterpretedMem = &pGB->CPUCold.pSelfCheckMem[MEM_SIZE];
+
+    //Flags are compared too so they can't be left pending.
+    MaterialiseFlags(pGB);
+
+    struct CPURegisters startRegister = pGB->CPU.Register;
+    bool startRunning = pGB->CPU.Running;
+    bool startIME = pGB->CPU.IME;
+    cycles startPendingCycles = pGB->CPU.PendingCycles;
+    SystemSnapshotMemory(pGB, StartMem);
+
+    SystemBeginWatchingWrites(pGB);
+    cycles interpretedCycles = RunBlock(pGB, pBlock);
+
+    if (SystemEndWatchingWrites(pGB) > 0 || pGB->CPU.PendingCycles != startPendingCycles + interpretedCycles)
+    {
+        return interpretedCycles;
+    }
+
+    MaterialiseFlags(pGB);
+    struct CPURegisters interpretedRegister = pGB->CPU.Register;
+    bool interpretedRunning = pGB->CPU.Running;
+    bool interpretedIME = pGB->CPU.IME;
+    SystemSnapshotMemory(pGB, InterpretedMem);
+
+    pGB->CPU.Register = startRegister;
+    pGB->CPU.Running = startRunning;
+    pGB->CPU.IME = startIME;
+    pGB->CPU.PendingCycles = startPendingCycles;
+    SystemRestoreMemory(pGB, StartMem);
+    UpdatePendingInterrupts(pGB);
+
+    //The compiled code shouldn't write anywhere the interpreter didn't either.
+    SystemBeginWatchingWrites(pGB);
+    cycles nativeCycles = pBlock->pNative(pGB);
+    int nativeSideEffectWrites = SystemEndWatchingWrites(pGB);
+
+    MaterialiseFlags(pGB);
+    SystemSnapshotMemory(pGB, StartMem);
+
+    if (nativeCycles != interpretedCycles
+        || pGB->CPU.PendingCycles != startPendingCycles + interpretedCycles
+        || nativeSideEffectWrites > 0
+        || memcmp(&pGB->CPU.Register, &interpretedRegister, sizeof(pGB->CPU.Register)) != 0
+        || pGB->CPU.Running != interpretedRunning
+        || pGB->CPU.IME != interpretedIME
+        || memcmp(StartMem, InterpretedMem, MEM_SIZE) != 0)
+    {
+        DebugPrint("JIT mismatch in block 0x%04X-0x%04X!\n", pBlock->StartAddr, pBlock->EndAddr);
+        DebugPrint("\tInterpreter: AF=%04X BC=%04X DE=%04X HL=%04X SP=%04X PC=%04X cycles=%d\n",
+            interpretedRegister.AF, interpretedRegister.BC, interpretedRegister.DE, interpretedRegister.HL, interpretedRegister.SP, interpretedRegister.PC, interpretedCycles);
+        DebugPrint("\tJIT:         AF=%04X BC=%04X DE=%04X HL=%04X SP=%04X PC=%04X cycles=%d pending=%d side effect writes=%d\n",
+            pGB->CPU.Register.AF, pGB->CPU.Register.BC, pGB->CPU.Register.DE, pGB->CPU.Register.HL, pGB->CPU.Register.SP, pGB->CPU.Register.PC, nativeCycles,
+            pGB->CPU.PendingCycles - startPendingCycles, nativeSideEffectWrites);
+        assert(0);
+
+        pGB->CPU.Register = interpretedRegister;
+        pGB->CPU.Running = interpretedRunning;
+        pGB->CPU.IME = interpretedIME;
+        pGB->CPU.PendingCycles = startPendingCycles + interpretedCycles;
+        SystemRestoreMemory(pGB, InterpretedMem);
+        UpdatePendingInterrupts(pGB);
+    }
+
+    return interpretedCycles;
+}
+
+static cycles RunBlockJit(struct GBInstance* pGB, struct CodeBlock* pBlock)
+{
+    if (pBlock->pNative == NULL && ++pBlock->NumRuns == JIT_THRESHOLD)
+    {
+        CompileBlock(pGB, pBlock);
+    }
+
+    if (pBlock->pNative == NULL)
+    {
+        return RunBlock(pGB, pBlock);
+    }
+
+    if (pGB->CPUCold.JitMode == CPUJit_SelfCheck)
+    {
+        return RunBlockSelfCheck(pGB, pBlock);
+    }
+
+    pGB->CPUCold.InstructionCount += pBlock->NumOps;
+    return pBlock->pNative(pGB);
+}
+
+void CPUFlushBlockCache(struct GBInstance* pGB)
+{
+    memset(pGB->CPU.pBlockCache->Blocks, 0, sizeof(pGB->CPU.pBlockCache->Blocks));
+    memset(pGB->CPUCold.CodeLines, 0, sizeof(pGB->CPUCold.CodeLines));
+    pGB->CPU.pBlockCache->OpPoolUsed = 0;
+
+    if (pGB->CPUCold.JitMode != CPUJit_Off)
+    {
+        JitFlush(pGB->CPUCold.pJitArena);
+    }
+}
+
+void CPUSetBlockCacheEnabled(struct GBInstance* pGB, bool enabled)
+{
+    pGB->CPU.BlockCacheEnabled = enabled;
+    CPUFlushBlockCache(pGB);
+}
+
+bool CPUSetJitMode(struct GBInstance* pGB, enum CPUJitMode mode)
+{
+    bool success = true;
+
+    if (mode != CPUJit_Off && pGB->CPUCold.pJitArena == NULL)
+    {
+        pGB->CPUCold.pJitArena = JitCreateArena();
+
+        if (pGB->CPUCold.pJitArena == NULL)
+        {
+            DebugPrint("JIT isn't supported on this host, using the interpreter.\n");
+            mode = CPUJit_Off;
+            success = false;
+        }
+    }
+
+    //Snapshots of memory from before and after the interpreter runs the block.
+    if (mode == CPUJit_SelfCheck && pGB->CPUCold.pSelfCheckMem == NULL)
+    {
+        pGB->CPUCold.pSelfCheckMem = malloc(MEM_SIZE * 2);
+
+        if (pGB->CPUCold.pSelfCheckMem == NULL)
+        {
+            DebugPrint("Failed to allocate JIT self check memory!\n");
+            mode = CPUJit_On;
+            success = false;
+        }
+    }
+
+    pGB->CPUCold.JitMode = mode;
+
+    //The JIT works on cached blocks.
+    if (pGB->CPUCold.JitMode != CPUJit_Off)
+    {
+        pGB->CPU.BlockCacheEnabled = true;
+    }
+
+    CPUFlushBlockCache(pGB);
+
+    return success;
+}
+
+void CheckInterrupts(struct GBInstance* pGB)
+{
+    if (pGB->CPU.PendingInterrupts == 0)
+        return;
+
+    //The lowest bit has the highest priority.
+    int i = CountTrailingZeros(pGB->CPU.PendingInterrupts);
+
+    UnsetRegisterBit(Register_IF(pGB), i);
+    SetIME(pGB, false);
+    pGB->CPU.Running = true;
+    StackPush(pGB, pGB->CPU.Register.PC);
+    pGB->CPU.Register.PC = pGB->CPUCold.InterruptOp[i];
+}
+
+void CPUSetInterrupt(struct GBInstance* pGB, int interruptIdx)
+{
+    SetRegisterBit(Register_IF(pGB), interruptIdx);
+    UpdatePendingInterrupts(pGB);
+}
+
+void CPUInterruptRegistersChanged(struct GBInstance* pGB)
+{
+    UpdatePendingInterrupts(pGB);
+}
+
+void CPUSetDispatchMode(struct GBInstance* pGB, enum CPUDispatchMode mode)
+{
+    switch (mode)
+    {
+        case CPUDispatch_Switch: pGB->CPU.HandleOpCode = &HandleOpCodeSwitch; break;
+        case CPUDispatch_Table: pGB->CPU.HandleOpCode = &HandleOpCodeTable; break;
+#if THREADED_DISPATCH_SUPPORTED
+        case CPUDispatch_Threaded: pGB->CPU.HandleOpCode = &HandleOpCodeThreaded; break;
+#endif
+        default:
+            DebugPrint("Unsupported dispatch mode %d!\n", mode);
+            assert(0);
+    }
+}
+
+uint64_t CPUGetInstructionCount(struct GBInstance* pGB)
+{
+    return pGB->CPUCold.InstructionCount;
+}
+
+uint64_t CPUGetIdleCyclesSkipped(struct GBInstance* pGB)
+{
+    return pGB->CPUCold.IdleCyclesSkipped;
+}
+
+bool CPUCreate(struct GBInstance* pGB)
+{
+#if THREADED_DISPATCH_SUPPORTED
+    pGB->CPU.HandleOpCode = &HandleOpCodeThreaded;
+#else
+    pGB->CPU.HandleOpCode = &HandleOpCodeTable;
+#endif
+
+    //Caching is off by default in debug builds so that the debugger gets to see every instruction.
+    pGB->CPU.BlockCacheEnabled = !DEBUG_ENABLED;
+    pGB->CPUCold.JitMode = CPUJit_Off;
+
+    pGB->CPU.pBlockCache = calloc(1, sizeof(struct CPUBlockCache));
+
+    if (pGB->CPU.pBlockCache == NULL)
+    {
+        DebugPrint("Failed to allocate block cache!\n");
+        return false;
+    }
+
+    return true;
+}
+
+void CPUDestroy(struct GBInstance* pGB)
+{
+    if (pGB->CPUCold.pJitArena != NULL)
+    {
+        JitDestroyArena(pGB->CPUCold.pJitArena);
+    }
+
+    free(pGB->CPUCold.pSelfCheckMem);
+    free(pGB->CPU.pBlockCache);
+}
+
+bool CPUInit(struct GBInstance* pGB, uint16_t startAddr, byte interruptOps[], int numInterrupts)
+{
+    InitOpTables();
+
+    memset(&pGB->CPU.Register, 0, sizeof(pGB->CPU.Register));
+    pGB->CPU.Register.PC = startAddr;
+
+    pGB->CPU.Running = true;
+    pGB->CPU.IME = false;
+    pGB->CPUCold.InstructionCount = 0;
+    pGB->CPUCold.IdleCyclesSkipped = 0;
+    pGB->CPU.LazyOp = LazyFlags_None;
+
+    CPUFlushBlockCache(pGB);
+    CPUInvalidateFetchWindow(pGB);
+    pGB->CPU.JitFlushPending = false;
+
+    pGB->CPUCold.NumInterrupts = numInterrupts;
+    for (int i = 0; i < pGB->CPUCold.NumInterrupts; ++i)
+    {
+        pGB->CPUCold.InterruptOp[i] = interruptOps[i];
+    }
+
+    UpdatePendingInterrupts(pGB);
+
+    return true;
+}
+
+//Runs a single instruction, or a block of them, adding them to PendingCycles. Returns 0 if the CPU is HALTed.
+static cycles Tick(struct GBInstance* pGB, cycles untilChange)
+{
+    CheckInterrupts(pGB);
+
+    if (pGB->CPU.Running)
+    {
+        if (pGB->CPU.BlockCacheEnabled)
+        {
+            if (pGB->CPU.JitFlushPending)
+            {
+                CPUFlushBlockCache(pGB);
+                pGB->CPU.JitFlushPending = false;
+            }
+
+            struct CodeBlock* pBlock = LookupBlock(pGB, pGB->CPU.Register.PC);
+
+            //A block always runs to its end, so it's only used if that's before anything else changes.
+            //Otherwise it's single stepped up to the change so interrupts aren't raised late.
+            if (pBlock != NULL && pBlock->NumCycles <= untilChange)
+            {
+                cycles numCycles = 0;
+
+                if (pBlock->FusedLoop != FusedLoop_None)
+                {
+                    //Leaves room for the block to go round once more afterwards.
+                    numCycles = RunFusedLoop(pGB, pBlock, untilChange - pBlock->NumCycles);
+                    pGB->CPU.PendingCycles += numCycles;
+                }
+
+                //These add their cycles to PendingCycles themselves.
+                numCycles += pGB->CPUCold.JitMode != CPUJit_Off ? RunBlockJit(pGB, pBlock) : RunBlock(pGB, pBlock);
+
+                if (pBlock->IsIdleLoop && pGB->CPU.Register.PC == pBlock->StartAddr)
+                {
+                    cycles skippedCycles = SkipIdleLoop(pGB, pBlock, numCycles, untilChange);
+                    pGB->CPU.PendingCycles += skippedCycles;
+                    numCycles += skippedCycles;
+                }
+
+                return numCycles;
+            }
+        }
+
+        pGB->CPUCold.InstructionCount++;
+        cycles numCycles = pGB->CPU.HandleOpCode(pGB);
+        pGB->CPU.PendingCycles += numCycles;
+        return numCycles;
+    }
+
+    return 0;
+}
+
+void CPUBreakRun(struct GBInstance* pGB)
+{
+    pGB->CPU.BreakRun = true;
+}
+
+cycles CPUTakePendingCycles(struct GBInstance* pGB)
+{
+    cycles numCycles = pGB->CPU.PendingCycles;
+    pGB->CPU.PendingCycles = 0;
+    return numCycles;
+}
+
+cycles CPURunFor(struct GBInstance* pGB, cycles budget)
+{
+    cycles numCycles = 0;
+    pGB->CPU.PendingCycles = 0;
+    pGB->CPU.BreakRun = false;
+
+    do
+    {
+        cycles tickCycles = Tick(pGB, budget - numCycles);
+
+        if (tickCycles == 0)
+        {
+            break;
+        }
+
+        numCycles += tickCycles;
+    }
+    while (numCycles < budget && !pGB->CPU.BreakRun);
+
+    return CPUTakePendingCycles(pGB);
 }
 
 #if DEBUG_ENABLED
 
-const struct CPURegisters* DebugGetCPURegisters()
+const struct CPURegisters* DebugGetCPURegisters(struct GBInstance* pGB)
 {
-    return &Register;
+    MaterialiseFlags(pGB);
+    return &pGB->CPU.Register;
 }
 
 #endif
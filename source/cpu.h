@@ -53,13 +53,136 @@ struct CPURegisters
     uint16_t PC; //Program counter
 };
 
-void CPUSetInterrupt(int interruptIdx);
+//Computed gotos are a GCC/Clang extension.
+#if defined(__GNUC__) || defined(__clang__)
+#define THREADED_DISPATCH_SUPPORTED 1
+#else
+#define THREADED_DISPATCH_SUPPORTED 0
+#endif
+
+enum CPUDispatchMode
+{
+    CPUDispatch_Switch,
+    CPUDispatch_Table,
+    CPUDispatch_Threaded    //Only available if THREADED_DISPATCH_SUPPORTED.
+};
+
+//Code in RAM is tracked in lines so that writes to it can invalidate the block cache.
+#define CPU_CODE_LINE_SHIFT 6
+#define CPU_CODE_LINE_SIZE (1 << CPU_CODE_LINE_SHIFT)
+#define CPU_NUM_CODE_LINES ((64 * 1024) >> CPU_CODE_LINE_SHIFT)
+
+enum CPUJitMode
+{
+    CPUJit_Off,
+    CPUJit_On,
+    CPUJit_SelfCheck    //Runs every compiled block through the interpreter as well and compares the results. Blocks
+                        //that write anywhere but WRAM and HRAM are only interpreted.
+};
+
+//Lazy flags, see cpu.c.
+enum LazyFlagsOp
+{
+    LazyFlags_None,
+    LazyFlags_Add,      //Z0HC
+    LazyFlags_Sub,      //Z1HC
+    LazyFlags_And,      //Z010
+    LazyFlags_Zero,     //Z000
+    LazyFlags_Inc,      //Z0H-
+    LazyFlags_Dec,      //Z1H-
+    LazyFlags_Shift,    //Z00C
+    LazyFlags_Bit       //Z01-
+};
+
+struct GBInstance;
+struct CPUBlockCache;
+struct JitArena;
+
+//What the CPU touches on every instruction (or every block). It's ordered to pack tightly and is kept
+//to a single cache line, so that it and the scheduler are all an instance needs in cache to run.
+struct CPUState
+{
+    struct CPURegisters Register;
+
+    bool Running;
+    bool IME;                   //Interrupt master flag.
+    byte PendingInterrupts;     //Requested and enabled interrupts, 0 if IME is clear.
+    bool BreakRun;              //Set when the current CPURunFor needs to stop early.
+
+    bool BlockCacheEnabled;
+    bool JitFlushPending;
+
+    byte LazyResult;
+    byte LazyLHS;
+    byte LazyRHS;
+    bool LazyCarry;             //For ops that leave the carry alone or shift a bit into it.
+    enum LazyFlagsOp LazyOp;
+
+    cycles PendingCycles;       //Cycles run by the current CPURunFor that haven't been handed over yet.
+
+    uint16_t FetchWindowStart;
+    uint16_t FetchWindowSize;   //0 if there's no window.
+    const byte* pFetchWindow;   //Host address of FetchWindowStart.
+
+    cycles(*HandleOpCode)(struct GBInstance* pGB);
+    struct CPUBlockCache* pBlockCache;
+};
+
+//Everything else, which is either only needed now and then or (like CodeLines) too big to keep with the rest.
+struct CPUColdState
+{
+    byte InterruptOp[8];
+    int NumInterrupts;
+
+    uint64_t IdleCyclesSkipped;
+    uint64_t InstructionCount;
+
+    enum CPUJitMode JitMode;
+
+    bool CodeLines[CPU_NUM_CODE_LINES];     //Lines of RAM that have cached code in them.
+
+    struct JitArena* pJitArena;             //Only created once the JIT's turned on.
+    byte* pSelfCheckMem;                    //Likewise for the self check.
+};
+
+//Sets up the defaults for a new instance. The CPU can be configured from then on, even before CPUInit.
+bool CPUCreate(struct GBInstance* pGB);
+void CPUDestroy(struct GBInstance* pGB);
+
+void CPUSetInterrupt(struct GBInstance* pGB, int interruptIdx);
+
+//Has to be called after IE or IF have been written to other than through CPUSetInterrupt.
+void CPUInterruptRegistersChanged(struct GBInstance* pGB);
+
+void CPUSetDispatchMode(struct GBInstance* pGB, enum CPUDispatchMode mode);
+uint64_t CPUGetInstructionCount(struct GBInstance* pGB);
+uint64_t CPUGetIdleCyclesSkipped(struct GBInstance* pGB);   //Cycles fast-forwarded through busy-wait loops.
+
+void CPUSetBlockCacheEnabled(struct GBInstance* pGB, bool enabled);
+void CPUFlushBlockCache(struct GBInstance* pGB);
+void CPUInvalidateCode(struct GBInstance* pGB, uint16_t addr);
+
+//Has to be called whenever the memory map changes (ie. the boot ROM being unmapped).
+void CPUInvalidateFetchWindow(struct GBInstance* pGB);
+
+//Returns false (and sticks with the interpreter) if the JIT isn't supported on this host.
+bool CPUSetJitMode(struct GBInstance* pGB, enum CPUJitMode mode);
+
+bool CPUInit(struct GBInstance* pGB, uint16_t startAddr, byte interruptOps[], int numInterrupts);
+
+//Runs instructions until at least budget cycles have passed, the CPU HALTs or CPUBreakRun is called.
+//Nothing outside of the CPU is updated in the meantime so the budget shouldn't go past the next time
+//the rest of the system changes. Returns the number of cycles run that haven't already been taken by
+//CPUTakePendingCycles, 0 if the CPU is HALTed.
+cycles CPURunFor(struct GBInstance* pGB, cycles budget);
+void CPUBreakRun(struct GBInstance* pGB);
 
-bool CPUInit(uint16_t startAddr, byte interruptOps[], int numInterrupts);
-cycles CPUTick();
+//Hands over the cycles run so far by the current CPURunFor (excluding the current instruction) so
+//the rest of the system can be brought up to date mid-run.
+cycles CPUTakePendingCycles(struct GBInstance* pGB);
 
 #if DEBUG_ENABLED
-const struct CPURegisters* DebugGetCPURegisters();
+const struct CPURegisters* DebugGetCPURegisters(struct GBInstance* pGB);
 #endif
 
 #endif
@@ -31,6 +31,9 @@ uint32_t DebugScreenshotTime = 0;
 
 static CallbackFunc BreakpointHitCallback = NULL;
 
+//The instance being debugged.
+static struct GBInstance* pDebugGB = NULL;
+
 struct KnownDataBlock
 {
     uint16_t FromAddr;
@@ -168,13 +171,13 @@ int DisassembleROMInstruction(uint16_t addr)
     const char* pOpStr = NULL;
     int opSize = 0;
 
-    byte opCode = ReadMem(addr);
+    byte opCode = ReadMem(pDebugGB, addr);
     uint16_t dataAddr = addr + 1;
 
     if (opCode == 0xCB)
     {
         dataAddr++;
-        opCode = ReadMem(addr + 1);
+        opCode = ReadMem(pDebugGB, addr + 1);
         opSize = CPUExtendedOpGetDebugInfo(opCode, &pOpStr);
     }
     else
@@ -191,35 +194,35 @@ int DisassembleROMInstruction(uint16_t addr)
     if (pDataLoc = strstr(pOpStr, "d8"))
     {
         dataLocLen = 2; //strlen("d8")
-        byte val = ReadMem(dataAddr);
+        byte val = ReadMem(pDebugGB, dataAddr);
         snprintf(dataStr, 16, "$%x", val);
     }
     //"d16" 16-bit data
     else if (pDataLoc = strstr(pOpStr, "d16"))
     {
         dataLocLen = 3; //strlen("d16")
-        uint16_t val = ReadMem16(dataAddr);
+        uint16_t val = ReadMem16(pDebugGB, dataAddr);
         snprintf(dataStr, 16, "$%.4x", val);
     }
     //"a8" 8-bit unsigned data added to 0xFF00
     else if (pDataLoc = strstr(pOpStr, "a8"))
     {
         dataLocLen = 2; //strlen("a8")
-        byte val = ReadMem(dataAddr);
+        byte val = ReadMem(pDebugGB, dataAddr);
         snprintf(dataStr, 16, "$FF00+$%x", val);
     }
     //"a16" little-endian 16-bit address
     else if (pDataLoc = strstr(pOpStr, "a16"))
     {
         dataLocLen = 3; //strlen("a16")
-        uint16_t val = ReadMem16(dataAddr);
+        uint16_t val = ReadMem16(pDebugGB, dataAddr);
         snprintf(dataStr, 16, "$%.4x", val);
     }
     //"r8" 8-bit signed data
     else if (pDataLoc = strstr(pOpStr, "r8"))
     {
         dataLocLen = 2; //strlen("r8")
-        int8_t val = (int8_t)ReadMem(dataAddr);
+        int8_t val = (int8_t)ReadMem(pDebugGB, dataAddr);
         snprintf(dataStr, 16, "%d", val);
     }
 
@@ -278,7 +281,7 @@ void DisassembleROM()
 
 void OnStep()
 {
-    const struct CPURegisters* cpuRegisters = DebugGetCPURegisters();
+    const struct CPURegisters* cpuRegisters = DebugGetCPURegisters(pDebugGB);
 
     int disassemblyIdx = GetDisassembledROMIdxFromAddr(cpuRegisters->PC);
 
@@ -305,7 +308,7 @@ void OnStep()
     if (DebugHasBreakpoint(cpuRegisters->PC))
     {
         DebugPrint("Breakpoint hit at 0x%.4X!\n", cpuRegisters->PC);
-        EnableSingleStepMode();
+        EnableSingleStepMode(pDebugGB);
 
         if (BreakpointHitCallback != NULL)
         {
@@ -331,7 +334,7 @@ void DebugTick(uint32_t dt)
     {
         if (DebugScreenshotTime <= dt)
         {
-            PPUScreenshotScreenBuffer();
+            PPUScreenshotScreenBuffer(pDebugGB);
             DebugScreenshotTime = 0;
         }
         else
@@ -341,12 +344,13 @@ void DebugTick(uint32_t dt)
     }
 }
 
-void DebugInit()
+void DebugInit(struct GBInstance* pGB)
 {
+    pDebugGB = pGB;
     memset(DebugBreakpoints, INVALID_BREAKPOINT, sizeof(DebugBreakpoints));
 
-    RegisterStepCallback(&OnStep);
-    RegisterROMChangedCallback(&OnROMChanged);
+    RegisterStepCallback(pGB, &OnStep);
+    RegisterROMChangedCallback(pGB, &OnROMChanged);
 
     AddKnownDataBlock(0x00A8, 0x00DF); //Nintendo logo and r symbol in boot rom.
     AddKnownDataBlock(0x0104, 0x014F); //Nintendo logo in cartridge and cartridge header.
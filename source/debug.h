@@ -39,7 +39,8 @@ void DebugSetScreenshotTime(uint32_t time);
 void RegisterBreakpointHitCallback(CallbackFunc callback);
 
 void DebugTick(uint32_t dt);
-void DebugInit();
+//The debugger only looks at the one instance.
+void DebugInit(struct GBInstance* pGB);
 
 #endif
 
@@ -0,0 +1,84 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <stddef.h>
+
+#include "types.h"
+#include "system.h"
+#include "cpu.h"
+#include "ppu.h"
+#include "timer.h"
+#include "scheduler.h"
+#include "cartridge.h"
+#include "cheats.h"
+
+//Everything about one emulated Game Boy. Nothing that changes while it runs lives outside of here, so
+//any number of them can be run side by side. Only the modules themselves should be poking around in
+//it, everything else goes through their functions.
+//
+//It's laid out by how often things are used rather than by module, so that running lots of instances
+//doesn't mean lots of cache misses: the hot state first, on as few cache lines as possible, then the
+//memory map and the framebuffer, then everything that's only looked at now and then.
+struct GBInstance
+{
+    //Hot. What the CPU loop touches on every instruction or step.
+    CACHE_ALIGNED struct CPUState CPU;
+    cycles StepCaughtUpCycles;  //Cycles the CPU has run during the current step that everything else has already caught up with.
+    int TickCycles;
+    struct SchedulerState Scheduler;
+
+    //Warm. What the scheduled events touch, every few hundred cycles.
+    struct PPUState PPU;
+    struct TimerState Timer;
+    struct VideoDirtyState VideoDirty;
+    struct SchedulerColdState SchedulerCold;
+
+    //Memory map. Every 256 byte page has a host pointer for reads and one for writes. Pages with writes
+    //that have side effects (bank controllers, IO) or that are tracked (VRAM, OAM) have no write pointer
+    //and go through WriteMemSlow instead. The IO page has no read pointer either, as some registers are
+    //only worked out when they're read, so its reads go through ReadMemSlow.
+    CACHE_ALIGNED byte* ReadPages[MEM_NUM_PAGES];
+    byte* WritePages[MEM_NUM_PAGES];
+
+    //Addressable Memory. This should be accessed via the Read/Write/Access functions to allow for memory mapping.
+    //LY and the other registers live here too, as that's where the CPU reads them from.
+    CACHE_ALIGNED byte Mem[MEM_SIZE];
+
+    CACHE_ALIGNED enum Colour ScreenBuffer[SCREEN_RES_X * SCREEN_RES_Y];
+
+    //Cold.
+    struct CPUColdState CPUCold;
+
+    //Writes that went somewhere other than plain memory, and what cartridge RAM was mapped for writing
+    //as when SystemBeginWatchingWrites was called.
+    int NumSideEffectWrites;
+    int WatchedWritesStart;
+    byte* WatchedCartRAMPages[CART_RAM_SIZE >> MEM_PAGE_SHIFT];
+
+    //What's mapped at 0 once the boot ROM goes away.
+    byte* pPageUnderBootROM;
+    byte BootROM[BOOT_ROM_SIZE];
+
+    byte DirectionInputState;
+    byte ButtonInputState;
+
+    //For calculating emulation speed.
+    int TickCounter;
+    int CycleCounter;
+    float EmulationSpeed;
+
+#if DEBUG_ENABLED
+    bool SingleStepMode;
+    bool SingleStepPending;
+    CallbackFunc StepCallback;
+    CallbackFunc ROMChangedCallback;
+#endif
+
+    struct CartridgeState Cartridge;
+    struct CheatState Cheats;
+};
+
+//The hot state has to stay within two cache lines.
+STATIC_ASSERT(offsetof(struct GBInstance, PPU) <= 2 * CACHE_LINE_SIZE, HotStateFitsInTwoCacheLines);
+
+#endif
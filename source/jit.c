@@ -0,0 +1,669 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "jit.h"
+#include "instance.h"
+
+#include PLATFORM_INCLUDE(PLATFORM_NAME/platform_debug.h)
+#include PLATFORM_INCLUDE(PLATFORM_NAME/platform_memory.h)
+
+//Translates decoded blocks into x86-64. Register moves, the 8-bit ALU ops (bar ADC and SBC) and loads
+//and stores through the memory map are emitted natively, anything else calls through to the
+//interpreter's handler. The ALU ops record their lazy flags exactly as the interpreter does, so either
+//side can pick them up. Memory accesses look up the page like ReadMem and WriteMem do, and if it isn't
+//plain memory (or the write would hit cached code) they fall back to the handler for that instruction
+//so the side effects are the same. A compiled block always runs from its first instruction to its last
+//and then returns the number of cycles taken. Like the interpreter, it adds them to PendingCycles as it
+//goes (at least before anything that could have the rest of the system catch up with it).
+
+#define JIT_ARENA_SIZE (4 * 1024 * 1024)
+#define JIT_MAX_OP_SIZE 112         //Bytes of host code per instruction, worst case.
+#define JIT_MAX_BLOCK_OVERHEAD 64   //Prologue, epilogue and alignment.
+
+//The three pushes in the prologue leave the stack aligned.
+#if defined(_WIN32)
+#define JIT_STACK_ADJUST 32         //Shadow space.
+#else
+#define JIT_STACK_ADJUST 0
+#endif
+
+struct JitArena
+{
+    byte* pCode;
+    size_t Used;
+    byte* pEmit;
+    cycles UnsyncedCycles;  //Cycles of the natively emitted ops that haven't been added to PendingCycles yet.
+};
+
+//rbx points at the CPU state while a block runs, so the registers and lazy flags are all [rbx + disp8].
+#define CPU_OFFSET(member) ((int)offsetof(struct CPUState, member))
+
+//Offsets of the registers in the order they're encoded in the opcodes. 6 is (HL) which isn't a register.
+static const int RegisterOffset8[8] = {
+    CPU_OFFSET(Register.B),
+    CPU_OFFSET(Register.C),
+    CPU_OFFSET(Register.D),
+    CPU_OFFSET(Register.E),
+    CPU_OFFSET(Register.H),
+    CPU_OFFSET(Register.L),
+    -1,
+    CPU_OFFSET(Register.A)
+};
+
+static const int RegisterOffset16[4] = {
+    CPU_OFFSET(Register.BC),
+    CPU_OFFSET(Register.DE),
+    CPU_OFFSET(Register.HL),
+    CPU_OFFSET(Register.SP)
+};
+
+//In the order they're encoded in the opcodes.
+enum JitALUOp
+{
+    JitALU_Add,
+    JitALU_AddCarry,
+    JitALU_Sub,
+    JitALU_SubCarry,
+    JitALU_And,
+    JitALU_Xor,
+    JitALU_Or,
+    JitALU_Compare
+};
+
+static void Emit8(struct JitArena* pArena, byte val)
+{
+    *pArena->pEmit++ = val;
+}
+
+static void Emit16(struct JitArena* pArena, uint16_t val)
+{
+    memcpy(pArena->pEmit, &val, sizeof(val));
+    pArena->pEmit += sizeof(val);
+}
+
+static void Emit32(struct JitArena* pArena, uint32_t val)
+{
+    memcpy(pArena->pEmit, &val, sizeof(val));
+    pArena->pEmit += sizeof(val);
+}
+
+static void Emit64(struct JitArena* pArena, uint64_t val)
+{
+    memcpy(pArena->pEmit, &val, sizeof(val));
+    pArena->pEmit += sizeof(val);
+}
+
+static void EmitLoadReg8(struct JitArena* pArena, int toOffset, int fromOffset)
+{
+    Emit8(pArena, 0x8A); Emit8(pArena, 0x43); Emit8(pArena, fromOffset);    //mov al, [rbx + from]
+    Emit8(pArena, 0x88); Emit8(pArena, 0x43); Emit8(pArena, toOffset);      //mov [rbx + to], al
+}
+
+static void EmitStoreImmediate8(struct JitArena* pArena, int offset, byte val)
+{
+    Emit8(pArena, 0xC6); Emit8(pArena, 0x43); Emit8(pArena, offset); Emit8(pArena, val);    //mov byte [rbx + offset], val
+}
+
+static void EmitStoreImmediate16(struct JitArena* pArena, int offset, uint16_t val)
+{
+    Emit8(pArena, 0x66); Emit8(pArena, 0xC7); Emit8(pArena, 0x43); Emit8(pArena, offset); Emit16(pArena, val);  //mov word [rbx + offset], val
+}
+
+static void EmitSetPC(struct JitArena* pArena, uint16_t addr)
+{
+    EmitStoreImmediate16(pArena, CPU_OFFSET(Register.PC), addr);
+}
+
+//Brings PendingCycles up to date before anything that might take it.
+static void EmitSyncPendingCycles(struct JitArena* pArena)
+{
+    if (pArena->UnsyncedCycles > 0)
+    {
+        Emit8(pArena, 0x81); Emit8(pArena, 0x43); Emit8(pArena, CPU_OFFSET(PendingCycles)); Emit32(pArena, pArena->UnsyncedCycles);  //add dword [rbx + pending], cycles
+        pArena->UnsyncedCycles = 0;
+    }
+}
+
+//The handler's cycles are only added if they haven't been counted as native ones already.
+static void EmitCallHandler(struct JitArena* pArena, const struct JitOp* pOp, bool addCycles)
+{
+#if defined(_WIN32)
+    Emit8(pArena, 0x4C); Emit8(pArena, 0x89); Emit8(pArena, 0xE9);  //mov rcx, r13
+    Emit8(pArena, 0xBA); Emit32(pArena, pOp->Operand);              //mov edx, operand
+#else
+    Emit8(pArena, 0x4C); Emit8(pArena, 0x89); Emit8(pArena, 0xEF);  //mov rdi, r13
+    Emit8(pArena, 0xBE); Emit32(pArena, pOp->Operand);              //mov esi, operand
+#endif
+    Emit8(pArena, 0x48); Emit8(pArena, 0xB8); Emit64(pArena, (uint64_t)(uintptr_t)pOp->Handler);   //mov rax, handler
+    Emit8(pArena, 0xFF); Emit8(pArena, 0xD0);                       //call rax
+
+    if (addCycles)
+    {
+        Emit8(pArena, 0x41); Emit8(pArena, 0x01); Emit8(pArena, 0xC4);  //add r12d, eax
+        Emit8(pArena, 0x01); Emit8(pArena, 0x43); Emit8(pArena, CPU_OFFSET(PendingCycles));    //add [rbx + pending], eax
+    }
+}
+
+//Short jumps, patched once the target's known. Nothing ever jumps further than a single instruction's code.
+static byte* EmitJump8(struct JitArena* pArena, byte opCode)
+{
+    Emit8(pArena, opCode);
+    Emit8(pArena, 0);
+    return pArena->pEmit - 1;
+}
+
+static void PatchJump8(struct JitArena* pArena, byte* pJump)
+{
+    ptrdiff_t distance = pArena->pEmit - (pJump + 1);
+    assert(distance <= INT8_MAX);
+    *pJump = (byte)distance;
+}
+
+//Puts a Game Boy address in ecx.
+static void EmitLoadAddr(struct JitArena* pArena, int fromOffset)
+{
+    Emit8(pArena, 0x0F); Emit8(pArena, 0xB7); Emit8(pArena, 0x4B); Emit8(pArena, fromOffset);  //movzx ecx, word [rbx + from]
+}
+
+static void EmitLoadAddrImmediate(struct JitArena* pArena, uint16_t addr)
+{
+    Emit8(pArena, 0xB9); Emit32(pArena, addr);                      //mov ecx, addr
+}
+
+//Leaves the host address of the Game Boy address in ecx in rdx, the same way ReadMem and WriteMem find
+//it. Anything they'd send the slow way jumps to the fallback instead. Returns how many jumps there are.
+static int EmitPageLookup(struct JitArena* pArena, bool write, byte** pSlowJumps)
+{
+    int numJumps = 0;
+    int pagesOffset = write ? offsetof(struct GBInstance, WritePages) : offsetof(struct GBInstance, ReadPages);
+
+    //The fallback's handler might catch the system up. Either way this op's cycles are left unsynced.
+    EmitSyncPendingCycles(pArena);
+
+    Emit8(pArena, 0x89); Emit8(pArena, 0xC8);                       //mov eax, ecx
+    Emit8(pArena, 0xC1); Emit8(pArena, 0xE8); Emit8(pArena, MEM_PAGE_SHIFT);    //shr eax, MEM_PAGE_SHIFT
+    Emit8(pArena, 0x49); Emit8(pArena, 0x8B); Emit8(pArena, 0x94); Emit8(pArena, 0xC5); Emit32(pArena, pagesOffset);  //mov rdx, [r13 + rax * 8 + pages]
+    Emit8(pArena, 0x48); Emit8(pArena, 0x85); Emit8(pArena, 0xD2);  //test rdx, rdx
+    pSlowJumps[numJumps++] = EmitJump8(pArena, 0x74);               //jz fallback
+
+    if (write)
+    {
+        //Writes over cached code have to throw it away, so they're left to WriteMem.
+        Emit8(pArena, 0x89); Emit8(pArena, 0xC8);                   //mov eax, ecx
+        Emit8(pArena, 0xC1); Emit8(pArena, 0xE8); Emit8(pArena, CPU_CODE_LINE_SHIFT);  //shr eax, CPU_CODE_LINE_SHIFT
+        Emit8(pArena, 0x41); Emit8(pArena, 0x80); Emit8(pArena, 0xBC); Emit8(pArena, 0x05);
+        Emit32(pArena, offsetof(struct GBInstance, CPUCold.CodeLines)); Emit8(pArena, 0);  //cmp byte [r13 + rax + code lines], 0
+        pSlowJumps[numJumps++] = EmitJump8(pArena, 0x75);           //jnz fallback
+    }
+
+    Emit8(pArena, 0x0F); Emit8(pArena, 0xB6); Emit8(pArena, 0xC1);  //movzx eax, cl
+    Emit8(pArena, 0x48); Emit8(pArena, 0x01); Emit8(pArena, 0xC2);  //add rdx, rax
+
+    return numJumps;
+}
+
+//Ends the native path of a memory access and emits the fallback, which runs the whole instruction
+//through its handler. The handler steps the PC itself, so it's set to the instruction first.
+static void EmitHandlerFallback(struct JitArena* pArena, const struct JitOp* pOp, uint16_t addr, byte** pSlowJumps, int numSlowJumps)
+{
+    byte* pDoneJump = EmitJump8(pArena, 0xEB);                      //jmp done
+
+    for (int i = 0; i < numSlowJumps; ++i)
+    {
+        PatchJump8(pArena, pSlowJumps[i]);
+    }
+
+    EmitSetPC(pArena, addr);
+    EmitCallHandler(pArena, pOp, false);
+
+    PatchJump8(pArena, pDoneJump);
+}
+
+//HL is stepped after the access for the LD (HL+)/(HL-) instructions.
+static void EmitStepHL(struct JitArena* pArena, int stepHL)
+{
+    if (stepHL != 0)
+    {
+        Emit8(pArena, 0x66); Emit8(pArena, 0xFF); Emit8(pArena, stepHL > 0 ? 0x43 : 0x4B); Emit8(pArena, CPU_OFFSET(Register.HL));  //inc/dec word [rbx + HL]
+    }
+}
+
+//Reads from the address in ecx into a register.
+static void EmitReadMem(struct JitArena* pArena, const struct JitOp* pOp, uint16_t addr, int toOffset, int stepHL)
+{
+    byte* slowJumps[2];
+    int numSlowJumps = EmitPageLookup(pArena, false, slowJumps);
+
+    Emit8(pArena, 0x0F); Emit8(pArena, 0xB6); Emit8(pArena, 0x02);  //movzx eax, byte [rdx]
+    Emit8(pArena, 0x88); Emit8(pArena, 0x43); Emit8(pArena, toOffset);  //mov [rbx + to], al
+    EmitStepHL(pArena, stepHL);
+
+    EmitHandlerFallback(pArena, pOp, addr, slowJumps, numSlowJumps);
+}
+
+//Writes a register (or the immediate operand if fromOffset is -1) to the address in ecx.
+static void EmitWriteMem(struct JitArena* pArena, const struct JitOp* pOp, uint16_t addr, int fromOffset, int stepHL)
+{
+    byte* slowJumps[2];
+    int numSlowJumps = EmitPageLookup(pArena, true, slowJumps);
+
+    if (fromOffset >= 0)
+    {
+        Emit8(pArena, 0x8A); Emit8(pArena, 0x43); Emit8(pArena, fromOffset);    //mov al, [rbx + from]
+    }
+    else
+    {
+        Emit8(pArena, 0xB0); Emit8(pArena, (byte)pOp->Operand);    //mov al, operand
+    }
+
+    Emit8(pArena, 0x88); Emit8(pArena, 0x02);                       //mov [rdx], al
+    EmitStepHL(pArena, stepHL);
+
+    EmitHandlerFallback(pArena, pOp, addr, slowJumps, numSlowJumps);
+}
+
+//HRAM is plain memory but shares its page with IO, so when the address is known it's accessed directly.
+static bool IsHighRAM(uint16_t addr)
+{
+    return addr >= IO_ADDR + IO_SIZE && addr != REGISTER_IE_ADDR;
+}
+
+static void EmitReadHighRAM(struct JitArena* pArena, uint16_t addr, int toOffset)
+{
+    Emit8(pArena, 0x41); Emit8(pArena, 0x8A); Emit8(pArena, 0x85); Emit32(pArena, offsetof(struct GBInstance, Mem) + addr);  //mov al, [r13 + mem]
+    Emit8(pArena, 0x88); Emit8(pArena, 0x43); Emit8(pArena, toOffset);  //mov [rbx + to], al
+}
+
+static void EmitWriteHighRAM(struct JitArena* pArena, uint16_t addr, int fromOffset)
+{
+    Emit8(pArena, 0x8A); Emit8(pArena, 0x43); Emit8(pArena, fromOffset);    //mov al, [rbx + from]
+    Emit8(pArena, 0x41); Emit8(pArena, 0x88); Emit8(pArena, 0x85); Emit32(pArena, offsetof(struct GBInstance, Mem) + addr);  //mov [r13 + mem], al
+}
+
+//A op= cl, recording the lazy flags the way the interpreter's Do* functions do. Not for ADC or SBC,
+//which need the carry worked out first.
+static void EmitALU(struct JitArena* pArena, enum JitALUOp op)
+{
+    enum LazyFlagsOp lazyOp;
+
+    //The op's stored as a dword.
+    assert(sizeof(enum LazyFlagsOp) == sizeof(uint32_t));
+
+    Emit8(pArena, 0x8A); Emit8(pArena, 0x43); Emit8(pArena, CPU_OFFSET(Register.A));    //mov al, [rbx + A]
+
+    switch (op)
+    {
+        case JitALU_Add:
+        case JitALU_Sub:
+        case JitALU_Compare:
+            Emit8(pArena, 0x88); Emit8(pArena, 0x43); Emit8(pArena, CPU_OFFSET(LazyLHS));   //mov [rbx + lhs], al
+            Emit8(pArena, 0x88); Emit8(pArena, 0x4B); Emit8(pArena, CPU_OFFSET(LazyRHS));   //mov [rbx + rhs], cl
+            Emit8(pArena, op == JitALU_Add ? 0x00 : 0x28); Emit8(pArena, 0xC8);             //add/sub al, cl
+            lazyOp = op == JitALU_Add ? LazyFlags_Add : LazyFlags_Sub;
+            break;
+
+        case JitALU_And:
+            Emit8(pArena, 0x20); Emit8(pArena, 0xC8);               //and al, cl
+            lazyOp = LazyFlags_And;
+            break;
+
+        case JitALU_Xor:
+            Emit8(pArena, 0x30); Emit8(pArena, 0xC8);               //xor al, cl
+            lazyOp = LazyFlags_Zero;
+            break;
+
+        case JitALU_Or:
+            Emit8(pArena, 0x08); Emit8(pArena, 0xC8);               //or al, cl
+            lazyOp = LazyFlags_Zero;
+            break;
+
+        default:
+            assert(0);
+            return;
+    }
+
+    if (lazyOp != LazyFlags_Add && lazyOp != LazyFlags_Sub)
+    {
+        EmitStoreImmediate8(pArena, CPU_OFFSET(LazyLHS), 0);
+        EmitStoreImmediate8(pArena, CPU_OFFSET(LazyRHS), 0);
+    }
+
+    //CP only keeps the flags.
+    if (op != JitALU_Compare)
+    {
+        Emit8(pArena, 0x88); Emit8(pArena, 0x43); Emit8(pArena, CPU_OFFSET(Register.A));    //mov [rbx + A], al
+    }
+
+    Emit8(pArena, 0x88); Emit8(pArena, 0x43); Emit8(pArena, CPU_OFFSET(LazyResult));       //mov [rbx + result], al
+    Emit8(pArena, 0xC7); Emit8(pArena, 0x43); Emit8(pArena, CPU_OFFSET(LazyOp)); Emit32(pArena, lazyOp);    //mov dword [rbx + op], lazyOp
+}
+
+//Emits the instruction natively if possible. pNextPC is set to where the PC should end up. If it can
+//fall back to its handler pMayCallHandler is set, as that leaves the PC stepped past it.
+static bool EmitNativeOp(struct JitArena* pArena, const struct JitOp* pOp, uint16_t addr, uint16_t* pNextPC, bool* pMayCallHandler)
+{
+    if (pOp->Extended)
+    {
+        return false;
+    }
+
+    byte opCode = pOp->OpCode;
+    *pNextPC = addr + pOp->Length;
+    *pMayCallHandler = false;
+
+    int to = (opCode >> 3) & 0x7;
+    int from = opCode & 0x7;
+
+    //LD r,r and the (HL) versions, but not HALT, which sits in the middle of them.
+    if (opCode >= 0x40 && opCode < 0x80 && opCode != 0x76)
+    {
+        if (from == 6)
+        {
+            EmitLoadAddr(pArena, CPU_OFFSET(Register.HL));
+            EmitReadMem(pArena, pOp, addr, RegisterOffset8[to], 0);
+            *pMayCallHandler = true;
+        }
+        else if (to == 6)
+        {
+            EmitLoadAddr(pArena, CPU_OFFSET(Register.HL));
+            EmitWriteMem(pArena, pOp, addr, RegisterOffset8[from], 0);
+            *pMayCallHandler = true;
+        }
+        else
+        {
+            EmitLoadReg8(pArena, RegisterOffset8[to], RegisterOffset8[from]);
+        }
+
+        return true;
+    }
+
+    //ALU A,r and ALU A,(HL).
+    if (opCode >= 0x80 && opCode < 0xC0)
+    {
+        enum JitALUOp aluOp = to;
+
+        if (aluOp == JitALU_AddCarry || aluOp == JitALU_SubCarry)
+        {
+            return false;
+        }
+
+        if (from == 6)
+        {
+            byte* slowJumps[2];
+            EmitLoadAddr(pArena, CPU_OFFSET(Register.HL));
+            int numSlowJumps = EmitPageLookup(pArena, false, slowJumps);
+            Emit8(pArena, 0x0F); Emit8(pArena, 0xB6); Emit8(pArena, 0x0A);  //movzx ecx, byte [rdx]
+            EmitALU(pArena, aluOp);
+            EmitHandlerFallback(pArena, pOp, addr, slowJumps, numSlowJumps);
+            *pMayCallHandler = true;
+        }
+        else
+        {
+            Emit8(pArena, 0x8A); Emit8(pArena, 0x4B); Emit8(pArena, RegisterOffset8[from]);   //mov cl, [rbx + from]
+            EmitALU(pArena, aluOp);
+        }
+
+        return true;
+    }
+
+    switch (opCode)
+    {
+        case 0x00:  //NOP
+            return true;
+
+        case 0x06: case 0x0E: case 0x16: case 0x1E: case 0x26: case 0x2E: case 0x3E:   //LD r,n
+            EmitStoreImmediate8(pArena, RegisterOffset8[to], (byte)pOp->Operand);
+            return true;
+
+        case 0x01: case 0x11: case 0x21: case 0x31:    //LD rr,nn
+            EmitStoreImmediate16(pArena, RegisterOffset16[opCode >> 4], pOp->Operand);
+            return true;
+
+        case 0x03: case 0x13: case 0x23: case 0x33:    //INC rr
+            Emit8(pArena, 0x66); Emit8(pArena, 0xFF); Emit8(pArena, 0x43); Emit8(pArena, RegisterOffset16[opCode >> 4]);    //inc word [rbx + offset]
+            return true;
+
+        case 0x0B: case 0x1B: case 0x2B: case 0x3B:    //DEC rr
+            Emit8(pArena, 0x66); Emit8(pArena, 0xFF); Emit8(pArena, 0x4B); Emit8(pArena, RegisterOffset16[opCode >> 4]);    //dec word [rbx + offset]
+            return true;
+
+        case 0x02: case 0x12:   //LD (BC),A / LD (DE),A
+            EmitLoadAddr(pArena, RegisterOffset16[opCode >> 4]);
+            EmitWriteMem(pArena, pOp, addr, CPU_OFFSET(Register.A), 0);
+            *pMayCallHandler = true;
+            return true;
+
+        case 0x0A: case 0x1A:   //LD A,(BC) / LD A,(DE)
+            EmitLoadAddr(pArena, RegisterOffset16[opCode >> 4]);
+            EmitReadMem(pArena, pOp, addr, CPU_OFFSET(Register.A), 0);
+            *pMayCallHandler = true;
+            return true;
+
+        case 0x22: case 0x32:   //LD (HL+),A / LD (HL-),A
+            EmitLoadAddr(pArena, CPU_OFFSET(Register.HL));
+            EmitWriteMem(pArena, pOp, addr, CPU_OFFSET(Register.A), opCode == 0x22 ? 1 : -1);
+            *pMayCallHandler = true;
+            return true;
+
+        case 0x2A: case 0x3A:   //LD A,(HL+) / LD A,(HL-)
+            EmitLoadAddr(pArena, CPU_OFFSET(Register.HL));
+            EmitReadMem(pArena, pOp, addr, CPU_OFFSET(Register.A), opCode == 0x2A ? 1 : -1);
+            *pMayCallHandler = true;
+            return true;
+
+        case 0x36:  //LD (HL),n
+            EmitLoadAddr(pArena, CPU_OFFSET(Register.HL));
+            EmitWriteMem(pArena, pOp, addr, -1, 0);
+            *pMayCallHandler = true;
+            return true;
+
+        case 0xEA:  //LD (nn),A
+            if (IsHighRAM(pOp->Operand))
+            {
+                EmitWriteHighRAM(pArena, pOp->Operand, CPU_OFFSET(Register.A));
+            }
+            else
+            {
+                EmitLoadAddrImmediate(pArena, pOp->Operand);
+                EmitWriteMem(pArena, pOp, addr, CPU_OFFSET(Register.A), 0);
+                *pMayCallHandler = true;
+            }
+            return true;
+
+        case 0xFA:  //LD A,(nn)
+            if (IsHighRAM(pOp->Operand))
+            {
+                EmitReadHighRAM(pArena, pOp->Operand, CPU_OFFSET(Register.A));
+            }
+            else
+            {
+                EmitLoadAddrImmediate(pArena, pOp->Operand);
+                EmitReadMem(pArena, pOp, addr, CPU_OFFSET(Register.A), 0);
+                *pMayCallHandler = true;
+            }
+            return true;
+
+        //IO registers are left to the handlers.
+        case 0xE0:  //LDH (n),A
+            if (!IsHighRAM(IO_ADDR + (pOp->Operand & 0xFF)))
+            {
+                return false;
+            }
+
+            EmitWriteHighRAM(pArena, IO_ADDR + (pOp->Operand & 0xFF), CPU_OFFSET(Register.A));
+            return true;
+
+        case 0xF0:  //LDH A,(n)
+            if (!IsHighRAM(IO_ADDR + (pOp->Operand & 0xFF)))
+            {
+                return false;
+            }
+
+            EmitReadHighRAM(pArena, IO_ADDR + (pOp->Operand & 0xFF), CPU_OFFSET(Register.A));
+            return true;
+
+        case 0xC6: case 0xD6: case 0xE6: case 0xEE: case 0xF6: case 0xFE:   //ALU A,n
+            Emit8(pArena, 0xB1); Emit8(pArena, (byte)pOp->Operand);        //mov cl, operand
+            EmitALU(pArena, to);
+            return true;
+
+        case 0x18:  //JR n
+            *pNextPC = addr + 2 + (int8_t)pOp->Operand;
+            return true;
+
+        case 0xC3:  //JP nn
+            *pNextPC = pOp->Operand;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+struct JitArena* JitCreateArena()
+{
+#if JIT_SUPPORTED
+    struct JitArena* pArena = malloc(sizeof(struct JitArena));
+
+    if (pArena == NULL)
+    {
+        return NULL;
+    }
+
+    pArena->pCode = PlatformAllocExecutable(JIT_ARENA_SIZE);
+
+    if (pArena->pCode == NULL)
+    {
+        DebugPrint("Failed to allocate JIT arena!\n");
+        free(pArena);
+        return NULL;
+    }
+
+    pArena->Used = 0;
+    pArena->pEmit = NULL;
+
+    return pArena;
+#else
+    return NULL;
+#endif
+}
+
+void JitDestroyArena(struct JitArena* pArena)
+{
+    PlatformFreeExecutable(pArena->pCode, JIT_ARENA_SIZE);
+    free(pArena);
+}
+
+void JitFlush(struct JitArena* pArena)
+{
+    pArena->Used = 0;
+}
+
+JitBlockFunc JitCompileBlock(struct JitArena* pArena, const struct JitOp* pOps, int numOps, uint16_t startAddr)
+{
+    if (pArena->Used + (numOps * JIT_MAX_OP_SIZE) + JIT_MAX_BLOCK_OVERHEAD > JIT_ARENA_SIZE)
+    {
+        return NULL;
+    }
+
+    //Keep functions 16 byte aligned.
+    pArena->Used = (pArena->Used + 15) & ~(size_t)15;
+
+    byte* pFunc = &pArena->pCode[pArena->Used];
+    pArena->pEmit = pFunc;
+    pArena->UnsyncedCycles = 0;
+
+    //Prologue. r13 holds the instance (for passing on to the handlers), rbx points at its CPU state and
+    //r12d accumulates the cycles returned by the handlers.
+    Emit8(pArena, 0x53);                                    //push rbx
+    Emit8(pArena, 0x41); Emit8(pArena, 0x54);               //push r12
+    Emit8(pArena, 0x41); Emit8(pArena, 0x55);               //push r13
+
+    if (JIT_STACK_ADJUST > 0)
+    {
+        Emit8(pArena, 0x48); Emit8(pArena, 0x83); Emit8(pArena, 0xEC); Emit8(pArena, JIT_STACK_ADJUST);    //sub rsp, adjust
+    }
+
+#if defined(_WIN32)
+    Emit8(pArena, 0x49); Emit8(pArena, 0x89); Emit8(pArena, 0xCD);  //mov r13, rcx
+#else
+    Emit8(pArena, 0x49); Emit8(pArena, 0x89); Emit8(pArena, 0xFD);  //mov r13, rdi
+#endif
+    Emit8(pArena, 0x49); Emit8(pArena, 0x8D); Emit8(pArena, 0x9D); Emit32(pArena, offsetof(struct GBInstance, CPU));    //lea rbx, [r13 + cpu]
+    Emit8(pArena, 0x45); Emit8(pArena, 0x31); Emit8(pArena, 0xE4);  //xor r12d, r12d
+
+    //The PC is only written back when a handler needs it or at the end of the block.
+    uint16_t addr = startAddr;
+    int pcInRegisters = startAddr;    //-1 once it's not known.
+    uint16_t nextPC = startAddr;
+    bool pcFromHandler = false;
+    cycles nativeCycles = 0;
+
+    for (int i = 0; i < numOps; ++i)
+    {
+        const struct JitOp* pOp = &pOps[i];
+
+        bool mayCallHandler;
+
+        if (EmitNativeOp(pArena, pOp, addr, &nextPC, &mayCallHandler))
+        {
+            nativeCycles += pOp->NumCycles;
+            pArena->UnsyncedCycles += pOp->NumCycles;
+            pcFromHandler = false;
+
+            if (mayCallHandler)
+            {
+                pcInRegisters = -1;
+            }
+        }
+        else
+        {
+            if (pcInRegisters != addr)
+            {
+                EmitSetPC(pArena, addr);
+            }
+
+            EmitSyncPendingCycles(pArena);
+            EmitCallHandler(pArena, pOp, true);
+
+            //Handlers step the PC themselves (or jump somewhere else if it's the last op).
+            nextPC = addr + pOp->Length;
+            pcInRegisters = nextPC;
+            pcFromHandler = true;
+        }
+
+        addr += pOp->Length;
+    }
+
+    if (!pcFromHandler && pcInRegisters != nextPC)
+    {
+        EmitSetPC(pArena, nextPC);
+    }
+
+    EmitSyncPendingCycles(pArena);
+
+    if (nativeCycles > 0)
+    {
+        Emit8(pArena, 0x41); Emit8(pArena, 0x81); Emit8(pArena, 0xC4); Emit32(pArena, nativeCycles);   //add r12d, nativeCycles
+    }
+
+    //Epilogue.
+    Emit8(pArena, 0x44); Emit8(pArena, 0x89); Emit8(pArena, 0xE0);  //mov eax, r12d
+
+    if (JIT_STACK_ADJUST > 0)
+    {
+        Emit8(pArena, 0x48); Emit8(pArena, 0x83); Emit8(pArena, 0xC4); Emit8(pArena, JIT_STACK_ADJUST);    //add rsp, adjust
+    }
+
+    Emit8(pArena, 0x41); Emit8(pArena, 0x5D);               //pop r13
+    Emit8(pArena, 0x41); Emit8(pArena, 0x5C);               //pop r12
+    Emit8(pArena, 0x5B);                                    //pop rbx
+    Emit8(pArena, 0xC3);                                    //ret
+
+    assert(pArena->pEmit - pFunc <= (numOps * JIT_MAX_OP_SIZE) + JIT_MAX_BLOCK_OVERHEAD);
+    pArena->Used += pArena->pEmit - pFunc;
+
+    return (JitBlockFunc)(uintptr_t)pFunc;
+}
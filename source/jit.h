@@ -0,0 +1,42 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "types.h"
+#include "cpu.h"
+
+//The recompiler only knows how to emit x86-64.
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_SUPPORTED 1
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+struct GBInstance;
+
+typedef cycles(*JitOpHandler)(struct GBInstance* pGB, uint16_t operand);
+typedef cycles(*JitBlockFunc)(struct GBInstance* pGB);
+
+struct JitOp
+{
+    JitOpHandler Handler;   //Called for anything that can't be translated to native code, and for memory accesses that
+                            //turn out not to be to plain memory.
+    uint16_t Operand;
+    byte OpCode;
+    bool Extended;          //OpCode is from the 0xCB table.
+    byte Length;
+    cycles NumCycles;
+};
+
+//Where the compiled code goes. Each instance has its own so they can compile at the same time, and
+//the code only works with the instance it was compiled by.
+struct JitArena;
+
+//Returns NULL if the JIT isn't supported on this host.
+struct JitArena* JitCreateArena();
+void JitDestroyArena(struct JitArena* pArena);
+void JitFlush(struct JitArena* pArena);
+
+//Returns NULL if the block can't be compiled, in which case it should be interpreted.
+JitBlockFunc JitCompileBlock(struct JitArena* pArena, const struct JitOp* pOps, int numOps, uint16_t startAddr);
+
+#endif
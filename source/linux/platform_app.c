@@ -9,6 +9,8 @@
 static DirectionInputCallbackFunc DirectionInputCallback = NULL;
 static ButtonInputCallbackFunc ButtonInputCallback = NULL;
 
+static struct GBInstance* pAppGB = NULL;
+
 static struct timeval StartTime;
 
 static SDL_Window* Window;
@@ -16,7 +18,7 @@ static SDL_Renderer* WindowRenderer;
 
 static void RenderPPUScreenBuffer()
 {
-    const enum Colour* pScreenBuffer = PPUGetScreenBuffer();
+    const enum Colour* pScreenBuffer = PPUGetScreenBuffer(pAppGB);
 
     for (int y = 0; y < SCREEN_RES_Y; ++y)
     {
@@ -37,8 +39,10 @@ static void RenderPPUScreenBuffer()
     }
 }
 
-bool AppInit()
+bool AppInit(struct GBInstance* pGB)
 {
+    pAppGB = pGB;
+
     gettimeofday(&StartTime, NULL);
 
     if (SDL_Init(SDL_INIT_VIDEO) != 0)
@@ -87,14 +91,14 @@ bool AppTick()
         {
             switch (e.key.keysym.sym)
             {
-                case SDLK_UP: DirectionInputCallback(Input_Up, true); break;
-                case SDLK_DOWN: DirectionInputCallback(Input_Down, true); break;
-                case SDLK_LEFT: DirectionInputCallback(Input_Left, true); break;
-                case SDLK_RIGHT: DirectionInputCallback(Input_Right, true); break;
-                case SDLK_z: ButtonInputCallback(Input_A, true); break;
-                case SDLK_x: ButtonInputCallback(Input_B, true); break;
-                case SDLK_s: ButtonInputCallback(Input_Start, true); break;
-                case SDLK_a: ButtonInputCallback(Input_Select, true); break;
+                case SDLK_UP: DirectionInputCallback(pAppGB, Input_Up, true); break;
+                case SDLK_DOWN: DirectionInputCallback(pAppGB, Input_Down, true); break;
+                case SDLK_LEFT: DirectionInputCallback(pAppGB, Input_Left, true); break;
+                case SDLK_RIGHT: DirectionInputCallback(pAppGB, Input_Right, true); break;
+                case SDLK_z: ButtonInputCallback(pAppGB, Input_A, true); break;
+                case SDLK_x: ButtonInputCallback(pAppGB, Input_B, true); break;
+                case SDLK_s: ButtonInputCallback(pAppGB, Input_Start, true); break;
+                case SDLK_a: ButtonInputCallback(pAppGB, Input_Select, true); break;
             }
         }
 
@@ -102,14 +106,14 @@ bool AppTick()
         {
             switch (e.key.keysym.sym)
             {
-                case SDLK_UP: DirectionInputCallback(Input_Up, false); break;
-                case SDLK_DOWN: DirectionInputCallback(Input_Down, false); break;
-                case SDLK_LEFT: DirectionInputCallback(Input_Left, false); break;
-                case SDLK_RIGHT: DirectionInputCallback(Input_Right, false); break;
-                case SDLK_z: ButtonInputCallback(Input_A, false); break;
-                case SDLK_x: ButtonInputCallback(Input_B, false); break;
-                case SDLK_s: ButtonInputCallback(Input_Start, false); break;
-                case SDLK_a: ButtonInputCallback(Input_Select, false); break;
+                case SDLK_UP: DirectionInputCallback(pAppGB, Input_Up, false); break;
+                case SDLK_DOWN: DirectionInputCallback(pAppGB, Input_Down, false); break;
+                case SDLK_LEFT: DirectionInputCallback(pAppGB, Input_Left, false); break;
+                case SDLK_RIGHT: DirectionInputCallback(pAppGB, Input_Right, false); break;
+                case SDLK_z: ButtonInputCallback(pAppGB, Input_A, false); break;
+                case SDLK_x: ButtonInputCallback(pAppGB, Input_B, false); break;
+                case SDLK_s: ButtonInputCallback(pAppGB, Input_Start, false); break;
+                case SDLK_a: ButtonInputCallback(pAppGB, Input_Select, false); break;
             }
         }
     }
@@ -4,7 +4,8 @@
 #include "types.h"
 #include "system_types.h"
 
-bool AppInit();
+//The app shows (and sends input to) the one instance.
+bool AppInit(struct GBInstance* pGB);
 void AppDestroy();
 
 bool AppTick();
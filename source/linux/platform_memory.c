@@ -0,0 +1,98 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "platform_memory.h"
+#include "types.h"
+
+void* PlatformAllocExecutable(size_t size)
+{
+    void* pMem = mmap(NULL, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return pMem != MAP_FAILED ? pMem : NULL;
+}
+
+void PlatformFreeExecutable(void* pMem, size_t size)
+{
+    munmap(pMem, size);
+}
+
+void* PlatformAllocAligned(size_t size, size_t alignment)
+{
+    void* pMem = NULL;
+
+    if (posix_memalign(&pMem, alignment, size) != 0)
+    {
+        return NULL;
+    }
+
+    memset(pMem, 0, size);
+    return pMem;
+}
+
+void PlatformFreeAligned(void* pMem)
+{
+    free(pMem);
+}
+
+const void* PlatformMapFile(const char* pFileName, size_t* pSize)
+{
+    int file = open(pFileName, O_RDONLY);
+
+    if (file < 0)
+    {
+        return NULL;
+    }
+
+    void* pMem = MAP_FAILED;
+    struct stat fileStat;
+
+    if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        *pSize = (size_t)fileStat.st_size;
+        pMem = mmap(NULL, *pSize, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+
+    //The mapping keeps the file open.
+    close(file);
+
+    return pMem != MAP_FAILED ? pMem : NULL;
+}
+
+void PlatformUnmapFile(const void* pMem, size_t size)
+{
+    munmap((void*)pMem, size);
+}
+
+void* PlatformMapFileWritable(const char* pFileName, size_t size)
+{
+    int file = open(pFileName, O_RDWR | O_CREAT, 0644);
+
+    if (file < 0)
+    {
+        return NULL;
+    }
+
+    void* pMem = MAP_FAILED;
+    struct stat fileStat;
+
+    if (fstat(file, &fileStat) == 0 && ((size_t)fileStat.st_size >= size || ftruncate(file, size) == 0))
+    {
+        pMem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    }
+
+    close(file);
+
+    return pMem != MAP_FAILED ? pMem : NULL;
+}
+
+void PlatformFlushFile(void* pMem, size_t offset, size_t size)
+{
+    //msync only takes whole pages.
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = offset & ~(pageSize - 1);
+
+    msync((byte*)pMem + start, offset + size - start, MS_SYNC);
+}
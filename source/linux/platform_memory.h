@@ -0,0 +1,22 @@
+#ifndef PLATFORM_MEMORY_H
+#define PLATFORM_MEMORY_H
+
+#include <stddef.h>
+
+void* PlatformAllocExecutable(size_t size);
+void PlatformFreeExecutable(void* pMem, size_t size);
+
+//Zeroed memory starting on a multiple of alignment, which has to be a power of 2.
+void* PlatformAllocAligned(size_t size, size_t alignment);
+void PlatformFreeAligned(void* pMem);
+
+//Maps a whole file read-only. Returns NULL if it can't be opened or is empty.
+const void* PlatformMapFile(const char* pFileName, size_t* pSize);
+void PlatformUnmapFile(const void* pMem, size_t size);
+
+//Maps a file for writing, creating it or growing it (with zeros) to size first. Writes go straight
+//to the file, PlatformFlushFile just writes the given part of it back to the disk.
+void* PlatformMapFileWritable(const char* pFileName, size_t size);
+void PlatformFlushFile(void* pMem, size_t offset, size_t size);
+
+#endif
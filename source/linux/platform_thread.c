@@ -0,0 +1,127 @@
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "platform_thread.h"
+
+struct PlatformThread
+{
+    pthread_t Thread;
+    PlatformThreadFunc Func;
+    void* pArg;
+};
+
+struct PlatformMutex
+{
+    pthread_mutex_t Mutex;
+};
+
+struct PlatformEvent
+{
+    pthread_mutex_t Mutex;
+    pthread_cond_t Cond;
+    bool Signalled;
+};
+
+static void* ThreadMain(void* pArg)
+{
+    struct PlatformThread* pThread = (struct PlatformThread*)pArg;
+    pThread->Func(pThread->pArg);
+    return NULL;
+}
+
+struct PlatformThread* PlatformCreateThread(PlatformThreadFunc func, void* pArg)
+{
+    struct PlatformThread* pThread = malloc(sizeof(struct PlatformThread));
+
+    if (pThread == NULL)
+    {
+        return NULL;
+    }
+
+    pThread->Func = func;
+    pThread->pArg = pArg;
+
+    if (pthread_create(&pThread->Thread, NULL, &ThreadMain, pThread) != 0)
+    {
+        free(pThread);
+        return NULL;
+    }
+
+    return pThread;
+}
+
+void PlatformJoinThread(struct PlatformThread* pThread)
+{
+    pthread_join(pThread->Thread, NULL);
+    free(pThread);
+}
+
+struct PlatformMutex* PlatformCreateMutex()
+{
+    struct PlatformMutex* pMutex = malloc(sizeof(struct PlatformMutex));
+
+    if (pMutex != NULL)
+    {
+        pthread_mutex_init(&pMutex->Mutex, NULL);
+    }
+
+    return pMutex;
+}
+
+void PlatformDestroyMutex(struct PlatformMutex* pMutex)
+{
+    pthread_mutex_destroy(&pMutex->Mutex);
+    free(pMutex);
+}
+
+void PlatformLockMutex(struct PlatformMutex* pMutex)
+{
+    pthread_mutex_lock(&pMutex->Mutex);
+}
+
+void PlatformUnlockMutex(struct PlatformMutex* pMutex)
+{
+    pthread_mutex_unlock(&pMutex->Mutex);
+}
+
+struct PlatformEvent* PlatformCreateEvent()
+{
+    struct PlatformEvent* pEvent = malloc(sizeof(struct PlatformEvent));
+
+    if (pEvent != NULL)
+    {
+        pthread_mutex_init(&pEvent->Mutex, NULL);
+        pthread_cond_init(&pEvent->Cond, NULL);
+        pEvent->Signalled = false;
+    }
+
+    return pEvent;
+}
+
+void PlatformDestroyEvent(struct PlatformEvent* pEvent)
+{
+    pthread_cond_destroy(&pEvent->Cond);
+    pthread_mutex_destroy(&pEvent->Mutex);
+    free(pEvent);
+}
+
+void PlatformSignalEvent(struct PlatformEvent* pEvent)
+{
+    pthread_mutex_lock(&pEvent->Mutex);
+    pEvent->Signalled = true;
+    pthread_cond_signal(&pEvent->Cond);
+    pthread_mutex_unlock(&pEvent->Mutex);
+}
+
+void PlatformWaitEvent(struct PlatformEvent* pEvent)
+{
+    pthread_mutex_lock(&pEvent->Mutex);
+
+    while (!pEvent->Signalled)
+    {
+        pthread_cond_wait(&pEvent->Cond, &pEvent->Mutex);
+    }
+
+    pEvent->Signalled = false;
+    pthread_mutex_unlock(&pEvent->Mutex);
+}
@@ -1,12 +1,17 @@
 #include <stdlib.h>
 
 #include "system.h"
+#include "cpu.h"
+#include "cartridge.h"
+#include "cheats.h"
 #include "debug.h"
+#include "benchmark.h"
+#include "scanline.h"
 #include <string.h>
 
 #include PLATFORM_INCLUDE(PLATFORM_NAME/platform_app.h)
 
-void Run()
+void Run(struct GBInstance* pGB)
 {
     uint32_t lastTime = AppGetTimeMS();
 
@@ -16,7 +21,7 @@ void Run()
         uint32_t dt = timeNow - lastTime;
         lastTime = timeNow;
 
-        SystemTick(dt);
+        SystemTick(pGB, dt);
 
 #if DEBUG_ENABLED
         DebugTick(dt);
@@ -37,24 +42,72 @@ void Run()
 int main(int argc, char** argv)
 {
     const char* pRomFile = NULL;
+
+    //Doesn't need a ROM, or an instance.
+    if (argc > 1 && strcmp(argv[1], "-selftest") == 0)
+    {
+        ScanlineInit();
+        return ScanlineSelfTest() ? 0 : -1;
+    }
+
+    struct GBInstance* pGB = SystemCreate();
     
     if (argc > 1)
     {
         pRomFile = argv[1];
     }
 
-    if (!SystemInit(pRomFile))
+    for (int arg = 2; arg < argc; ++arg)
+    {
+        if (strcmp(argv[arg], "-bench") == 0)
+        {
+            int numSeconds = DEFAULT_BENCHMARK_SECONDS;
+
+            if ((arg + 1) < argc)
+            {
+                numSeconds = atoi(argv[arg + 1]);
+            }
+
+            SystemDestroy(pGB);
+            return RunBenchmarks(pRomFile, numSeconds) ? 0 : -1;
+        }
+        else if (strcmp(argv[arg], "-jit") == 0)
+        {
+            CPUSetJitMode(pGB, CPUJit_On);
+        }
+        else if (strcmp(argv[arg], "-jitcheck") == 0)
+        {
+            CPUSetJitMode(pGB, CPUJit_SelfCheck);
+        }
+        else if (strcmp(argv[arg], "-cheat") == 0 && (arg + 1) < argc)
+        {
+            CheatAdd(pGB, argv[arg + 1]);
+            arg++;
+        }
+        else if (strcmp(argv[arg], "-saveflush") == 0 && (arg + 1) < argc)
+        {
+            CartridgeSetSaveFlushInterval(pGB, (uint32_t)atoi(argv[arg + 1]));
+            arg++;
+        }
+    }
+
+    if (!SystemInit(pGB, pRomFile))
     {
+        SystemDestroy(pGB);
         return -1;
     }
 
-    if (!AppInit())
+    if (!AppInit(pGB))
     {
+        SystemDestroy(pGB);
         return -1;
     }
 
+    AppRegisterDirectionInputCallback(&SystemDirectionInput);
+    AppRegisterButtonInputCallback(&SystemButtonInput);
+
 #if DEBUG_ENABLED
-    DebugInit();
+    DebugInit(pGB);
 
     if (argc > 2)
     {
@@ -83,9 +136,10 @@ int main(int argc, char** argv)
     }
 #endif
 
-    Run();
+    Run(pGB);
 
     AppDestroy();
+    SystemDestroy(pGB);
 
     return 0;
 }
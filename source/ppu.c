@@ -1,13 +1,16 @@
 #include <assert.h>
+#include <string.h>
 
 #include "ppu.h"
-#include "system.h"
+#include "instance.h"
+#include "scheduler.h"
+#include "cheats.h"
+#include "scanline.h"
+#include "utils.h"
 
 #if DEBUG_ENABLED
-#include <string.h>
-#include "utils.h"
 
-void PPUScreenshotScreenBuffer()
+void PPUScreenshotScreenBuffer(struct GBInstance* pGB)
 {
     //Save the screen buffer as a TGA for debug purposes.
 
@@ -22,7 +25,7 @@ void PPUScreenshotScreenBuffer()
     tgaFileData[17] = 0x20; //Left to right.
 
     byte* pPixelData = &tgaFileData[TGA_HEADER_SIZE];
-    const enum Colour* pScreenBuffer = PPUGetScreenBuffer();
+    const enum Colour* pScreenBuffer = PPUGetScreenBuffer(pGB);
 
     for (int y = 0; y < SCREEN_RES_Y; ++y)
     {
@@ -47,29 +50,18 @@ void PPUScreenshotScreenBuffer()
 
 #endif
 
-int CycleCounter = 0;
-
 #define NUM_SCANLINES 154	//0-143 for resolution, 144-153 for vblank
 #define CYCLES_PER_FRAME 70224
 
 static const cycles CYCLES_PER_SCANLINE = CYCLES_PER_FRAME / NUM_SCANLINES;
 
-enum Colour ScreenBuffer[SCREEN_RES_X * SCREEN_RES_Y];
-
-enum Mode
-{
-    Mode_HBlank = 0,
-    Mode_VBlank = 1,
-    Mode_SearchingOAM = 2,
-    Mode_TransferringDataToLCD = 3
-};
-
-static enum Mode CurrentMode = Mode_HBlank;
-
 #define SEARCHING_OAM_PERIOD 80
 //This can take 168-291 cycles, apparently. Does it matter if it's not emulated properly?
 #define TRANSFERRING_DATA_TO_LCD_PERIOD (SEARCHING_OAM_PERIOD + 170)
 
+//Tiles a scanline can overlap with, one more than fit on it when it's scrolled part way into a tile.
+#define BACKGROUND_TILES_PER_SCANLINE (SCREEN_RES_X / TILE_WIDTH + 1)
+
 enum LCDC_Flags
 {
     LCDC_BackgroundEnabled = 1 << 0,
@@ -82,14 +74,14 @@ enum LCDC_Flags
     LCDC_Enabled = 1 << 7
 };
 
-static bool BackgroundEnabled() { return (*Register_LCDC & LCDC_BackgroundEnabled) != 0; }
-static bool SpritesEnabled() { return (*Register_LCDC & LCDC_SpritesEnabled) != 0; }
-static bool LargeSprites() { return (*Register_LCDC & LCDC_SpritesSize) != 0; }
-static uint16_t BackgroundTileMapArea() { return (*Register_LCDC & LCDC_BackgroundTileMapArea) != 0 ? VRAM_TILE_MAP_ADDR_1 : VRAM_TILE_MAP_ADDR_0; }
-static uint16_t BackgroundTileDataArea() { return (*Register_LCDC & LCDC_BackgroundTileDataArea) != 0 ? VRAM_TILE_DATA_ADDR_0 : VRAM_TILE_DATA_ADDR_1; }
-static bool WindowEnabled() { return (*Register_LCDC & LCDC_WindowEnabled) != 0; }
-static uint16_t WindowTileMapArea() { return (*Register_LCDC & LCDC_WindowTileMapArea) != 0 ? VRAM_TILE_MAP_ADDR_1 : VRAM_TILE_MAP_ADDR_0; }
-static bool LCDEnabled() { return (*Register_LCDC & LCDC_Enabled) != 0; }
+static bool BackgroundEnabled(struct GBInstance* pGB) { return (*Register_LCDC(pGB) & LCDC_BackgroundEnabled) != 0; }
+static bool SpritesEnabled(struct GBInstance* pGB) { return (*Register_LCDC(pGB) & LCDC_SpritesEnabled) != 0; }
+static bool LargeSprites(struct GBInstance* pGB) { return (*Register_LCDC(pGB) & LCDC_SpritesSize) != 0; }
+static uint16_t BackgroundTileMapArea(struct GBInstance* pGB) { return (*Register_LCDC(pGB) & LCDC_BackgroundTileMapArea) != 0 ? VRAM_TILE_MAP_ADDR_1 : VRAM_TILE_MAP_ADDR_0; }
+static uint16_t BackgroundTileDataArea(struct GBInstance* pGB) { return (*Register_LCDC(pGB) & LCDC_BackgroundTileDataArea) != 0 ? VRAM_TILE_DATA_ADDR_0 : VRAM_TILE_DATA_ADDR_1; }
+static bool WindowEnabled(struct GBInstance* pGB) { return (*Register_LCDC(pGB) & LCDC_WindowEnabled) != 0; }
+static uint16_t WindowTileMapArea(struct GBInstance* pGB) { return (*Register_LCDC(pGB) & LCDC_WindowTileMapArea) != 0 ? VRAM_TILE_MAP_ADDR_1 : VRAM_TILE_MAP_ADDR_0; }
+static bool LCDEnabled(struct GBInstance* pGB) { return (*Register_LCDC(pGB) & LCDC_Enabled) != 0; }
 
 struct SpriteAttr
 {
@@ -112,48 +104,48 @@ struct SpriteAttr
     };
 };
 
-enum Colour PPUGetTilePixColour(byte* pTileData, int x, int y)
+static FORCE_INLINE enum Colour GetRowPixColour(const enum Colour* pPalette, uint16_t row, int x)
 {
-    byte* pLineData = &pTileData[y * 2];	//2 bytes per line.
-
-    byte bit = 1 << (7 - x);
-    byte bit1 = (*pLineData & bit) == 0 ? 0 : 1;
-    byte bit2 = (*(pLineData + 1) & bit) == 0 ? 0 : 2;
-
-    byte paletteIndex = bit1 | bit2;
-
-    byte shiftAmount = paletteIndex * 2;
-    byte col = (*Register_BGP & (0b11 << shiftAmount)) >> shiftAmount;
+    return pPalette[(row >> (x * 2)) & 0b11];
+}
 
-    return col;
+enum Colour PPUGetTilePixColour(struct GBInstance* pGB, byte* pTileData, int x, int y)
+{
+    byte* pLineData = &pTileData[y * 2];	//2 bytes per line.
+    return GetRowPixColour(pGB->PPU.BackgroundPalette, ScanlineDecodeTileRow(pLineData), x);
 }
 
-const enum Colour* PPUGetScreenBuffer()
+const enum Colour* PPUGetScreenBuffer(struct GBInstance* pGB)
 {
-    return ScreenBuffer;
+    return pGB->ScreenBuffer;
 }
 
-static void RenderBackground(byte renderLine)
+static void RenderBackground(struct GBInstance* pGB, byte renderLine)
 {
-    uint16_t tileMapAddr = BackgroundTileMapArea();
-    uint16_t tileDataAddr = BackgroundTileDataArea();
+    uint16_t tileMapAddr = BackgroundTileMapArea(pGB);
+    uint16_t tileDataAddr = BackgroundTileDataArea(pGB);
 
-    byte* pTileLayout = AccessMem(tileMapAddr);
-    byte* pTileData = AccessMem(tileDataAddr);
+    byte* pTileLayout = AccessMem(pGB, tileMapAddr);
+    byte* pTileData = AccessMem(pGB, tileDataAddr);
 
     byte y = renderLine;
-    enum Colour* pScreenBufferLine = &ScreenBuffer[y * SCREEN_RES_X];
+    enum Colour* pScreenBufferLine = &pGB->ScreenBuffer[y * SCREEN_RES_X];
 
-    for (byte x = 0; x < SCREEN_RES_X; ++x)
-    {
-        byte backgroundX = x + *Register_SCX;
-        byte backgroundY = y + *Register_SCY;
+    byte backgroundY = y + *Register_SCY(pGB);
+    byte* pTileLayoutLine = &pTileLayout[(backgroundY / TILE_HEIGHT) * BACKGROUND_TILES_PER_LINE];
+    byte tilePixY = backgroundY % TILE_HEIGHT;
 
-        byte tileX = backgroundX / TILE_WIDTH;
-        byte tileY = backgroundY / TILE_HEIGHT;
-        int tileIdx = (tileY * BACKGROUND_TILES_PER_LINE) + tileX;
+    byte scrollX = *Register_SCX(pGB);
+    byte tileX = scrollX / TILE_WIDTH;
 
-        byte tileId = pTileLayout[tileIdx];
+    //Enough whole tiles to cover the line however it's scrolled, which are drawn and then cropped.
+    byte rowData[BACKGROUND_TILES_PER_SCANLINE * 2];
+    enum Colour line[BACKGROUND_TILES_PER_SCANLINE * TILE_WIDTH];
+
+    for (int tile = 0; tile < BACKGROUND_TILES_PER_SCANLINE; ++tile)
+    {
+        byte tileId = pTileLayoutLine[tileX];
+        tileX = (tileX + 1) % BACKGROUND_TILES_PER_LINE;
 
         if (tileDataAddr == VRAM_TILE_DATA_ADDR_1)
         {
@@ -161,32 +153,32 @@ static void RenderBackground(byte renderLine)
             tileId = ((int8_t)tileId) + 128;
         }
 
-        byte tilePixX = backgroundX % TILE_WIDTH;
-        byte tilePixY = backgroundY % TILE_HEIGHT;
-
-        byte* pThisTileData = &pTileData[tileId * BYTES_PER_TILE];
-
-        pScreenBufferLine[x] = PPUGetTilePixColour(pThisTileData, tilePixX, tilePixY);
+        byte* pLineData = &pTileData[tileId * BYTES_PER_TILE + tilePixY * 2];
+        rowData[tile * 2] = pLineData[0];
+        rowData[tile * 2 + 1] = pLineData[1];
     }
+
+    ScanlineDrawTileRows(line, rowData, BACKGROUND_TILES_PER_SCANLINE, pGB->PPU.BackgroundPalette);
+    memcpy(pScreenBufferLine, &line[scrollX % TILE_WIDTH], SCREEN_RES_X * sizeof(enum Colour));
 }
 
-static void RenderWindow(byte renderLine)
+static void RenderWindow(struct GBInstance* pGB, byte renderLine)
 {
 
 }
 
-static void RenderSprites(byte renderLine)
+static void RenderSprites(struct GBInstance* pGB, byte renderLine)
 {
-    byte* pTileData = AccessMem(VRAM_TILE_DATA_ADDR_0);
+    byte* pTileData = AccessMem(pGB, VRAM_TILE_DATA_ADDR_0);
 
-    if (LargeSprites())
+    if (LargeSprites(pGB))
     {
         assert(0);  //TODO
     }
 
     for (uint16_t addr = VRAM_SPRITE_TABLE_ADDR; addr < VRAM_SPRITE_TABLE_ADDR + VRAM_SPRITE_TABLE_SIZE; addr += sizeof(struct SpriteAttr))
     {
-        struct SpriteAttr* pSpriteAttr = (struct SpriteAttr*)AccessMem(addr);
+        struct SpriteAttr* pSpriteAttr = (struct SpriteAttr*)&SpriteTable(pGB)[addr - VRAM_SPRITE_TABLE_ADDR];
 
         //Y position is offset by 16, X position is offset by 8.
         static const byte kSpriteXOffset = 8;
@@ -200,95 +192,148 @@ static void RenderSprites(byte renderLine)
             if (renderLine >= yPos && renderLine < yPos + kSpriteXOffset)
             {
                 byte* pThisTileData = &pTileData[pSpriteAttr->TileId * BYTES_PER_TILE];
-                enum Colour* pScreenBufferLine = &ScreenBuffer[renderLine * SCREEN_RES_X];
+                enum Colour* pScreenBufferLine = &pGB->ScreenBuffer[renderLine * SCREEN_RES_X];
 
                 byte spriteY = renderLine - yPos;
                 byte pixY = pSpriteAttr->YFlip ? TILE_HEIGHT - (spriteY + 1) : spriteY;
+                uint16_t row = ScanlineDecodeTileRow(&pThisTileData[pixY * 2]);
 
                 for (byte spriteX = 0; spriteX < TILE_WIDTH; ++spriteX)
                 {
                     byte pixX = pSpriteAttr->XFlip ? TILE_WIDTH - (spriteX + 1) : spriteX;
-                    pScreenBufferLine[xPos + spriteX] = PPUGetTilePixColour(pThisTileData, pixX, pixY);
+                    pScreenBufferLine[xPos + spriteX] = GetRowPixColour(pGB->PPU.BackgroundPalette, row, pixX);
                 }
             }
         }
     }
 }
 
-static void RenderScanline(byte renderLine)
+static void RenderScanline(struct GBInstance* pGB, byte renderLine)
 {
-    if (!LCDEnabled())
+    if (!LCDEnabled(pGB))
         return;
 
-    if (BackgroundEnabled())
+    if (BackgroundEnabled(pGB))
     {
-        RenderBackground(renderLine);
+        RenderBackground(pGB, renderLine);
     }
 
-    if (WindowEnabled())
+    if (WindowEnabled(pGB))
     {
-        RenderWindow(renderLine);
+        RenderWindow(pGB, renderLine);
     }
 
-    if (SpritesEnabled())
+    if (SpritesEnabled(pGB))
     {
-        RenderSprites(renderLine);
+        RenderSprites(pGB, renderLine);
     }
 }
 
-bool PPUInit()
+static cycles CyclesUntilNextEvent(struct GBInstance* pGB)
 {
-    return true;
+    //Modes (and so interrupts and rendering) only change on these boundaries.
+    if (pGB->PPU.CycleCounter < SEARCHING_OAM_PERIOD)
+    {
+        return SEARCHING_OAM_PERIOD - pGB->PPU.CycleCounter;
+    }
+    else if (pGB->PPU.CycleCounter < TRANSFERRING_DATA_TO_LCD_PERIOD)
+    {
+        return TRANSFERRING_DATA_TO_LCD_PERIOD - pGB->PPU.CycleCounter;
+    }
+
+    return CYCLES_PER_SCANLINE - pGB->PPU.CycleCounter;
 }
 
-void PPUTick(cycles numCycles)
+static void Tick(struct GBInstance* pGB, cycles numCycles)
 {
-    byte currentLine = *Register_LY;
+    byte currentLine = *Register_LY(pGB);
     
-    if ((CycleCounter += numCycles) >= CYCLES_PER_SCANLINE)
+    if ((pGB->PPU.CycleCounter += numCycles) >= CYCLES_PER_SCANLINE)
     {
-        CycleCounter -= CYCLES_PER_SCANLINE;
+        pGB->PPU.CycleCounter -= CYCLES_PER_SCANLINE;
 
-        if (*Register_LY >= NUM_SCANLINES)
+        if (*Register_LY(pGB) >= NUM_SCANLINES)
         {
-            *Register_LY = 0;
+            *Register_LY(pGB) = 0;
         }
         else
         {
-            (*Register_LY)++;
+            (*Register_LY(pGB))++;
         }
     }
 
-    enum Mode mode = Mode_HBlank;
+    enum PPUMode mode = PPUMode_HBlank;
 
-    if (*Register_LY > 143)
+    if (*Register_LY(pGB) > 143)
     {
-        mode = Mode_VBlank;
+        mode = PPUMode_VBlank;
     }
-    else if (CycleCounter < SEARCHING_OAM_PERIOD)
+    else if (pGB->PPU.CycleCounter < SEARCHING_OAM_PERIOD)
     {
-        mode = Mode_SearchingOAM;
+        mode = PPUMode_SearchingOAM;
     }
-    else if (CycleCounter < TRANSFERRING_DATA_TO_LCD_PERIOD)
+    else if (pGB->PPU.CycleCounter < TRANSFERRING_DATA_TO_LCD_PERIOD)
     {
-        mode = Mode_TransferringDataToLCD;
+        mode = PPUMode_TransferringDataToLCD;
     }
 
     //Render the line if we've changed.
-    if (mode != Mode_VBlank && currentLine != *Register_LY && currentLine >= 0 && currentLine < SCREEN_RES_Y)
+    if (mode != PPUMode_VBlank && currentLine != *Register_LY(pGB) && currentLine >= 0 && currentLine < SCREEN_RES_Y)
     {
-        RenderScanline(currentLine);
+        RenderScanline(pGB, currentLine);
     }
 
-    if (mode != CurrentMode)
+    if (mode != pGB->PPU.CurrentMode)
     {
-        CurrentMode = mode;
+        pGB->PPU.CurrentMode = mode;
         
-        if (CurrentMode == Mode_VBlank)
+        if (pGB->PPU.CurrentMode == PPUMode_VBlank)
         {
-            FireInterrupt(Interrupt_VBlank);
+            CheatVBlank(pGB);
+            FireInterrupt(pGB, Interrupt_VBlank);
         }
 
         //Also need to handle the STAT interrupt.
     }
 }
+
+void PPUSync(struct GBInstance* pGB)
+{
+    uint64_t now = SchedulerGetCycles(pGB);
+    Tick(pGB, (cycles)(now - pGB->PPU.LastSyncCycle));
+    pGB->PPU.LastSyncCycle = now;
+}
+
+static void OnPPUEvent(struct GBInstance* pGB)
+{
+    PPUSync(pGB);
+    SchedulerSchedule(pGB, SchedulerEvent_PPU, pGB->PPU.LastSyncCycle + CyclesUntilNextEvent(pGB));
+}
+
+void PPUInitShared()
+{
+    ScanlineInit();
+}
+
+void PPUPaletteChanged(struct GBInstance* pGB)
+{
+    for (int index = 0; index < 4; ++index)
+    {
+        pGB->PPU.BackgroundPalette[index] = (*Register_BGP(pGB) >> (index * 2)) & 0b11;
+    }
+}
+
+bool PPUInit(struct GBInstance* pGB)
+{
+    PPUPaletteChanged(pGB);
+
+    pGB->PPU.CycleCounter = 0;
+    pGB->PPU.LastSyncCycle = SchedulerGetCycles(pGB);
+    pGB->PPU.CurrentMode = PPUMode_HBlank;
+    memset(pGB->ScreenBuffer, 0, sizeof(pGB->ScreenBuffer));
+
+    SchedulerSetHandler(pGB, SchedulerEvent_PPU, &OnPPUEvent);
+    SchedulerSchedule(pGB, SchedulerEvent_PPU, pGB->PPU.LastSyncCycle + CyclesUntilNextEvent(pGB));
+
+    return true;
+}
@@ -2,6 +2,9 @@
 #define PPU_H
 
 #include "types.h"
+#include "system.h"
+
+struct GBInstance;
 
 enum Colour
 {
@@ -11,15 +14,40 @@ enum Colour
     ColourBlack = 3
 };
 
-enum Colour PPUGetTilePixColour(byte* pTileData, int x, int y);
+enum PPUMode
+{
+    PPUMode_HBlank = 0,
+    PPUMode_VBlank = 1,
+    PPUMode_SearchingOAM = 2,
+    PPUMode_TransferringDataToLCD = 3
+};
+
+struct PPUState
+{
+    int CycleCounter;   //Into the current scanline.
+    uint64_t LastSyncCycle;
+    enum PPUMode CurrentMode;
+    enum Colour BackgroundPalette[4];   //BGP decoded, by colour index.
+};
+
+enum Colour PPUGetTilePixColour(struct GBInstance* pGB, byte* pTileData, int x, int y);
 
-const enum Colour* PPUGetScreenBuffer();
+const enum Colour* PPUGetScreenBuffer(struct GBInstance* pGB);
 
 #if DEBUG_ENABLED
-void PPUScreenshotScreenBuffer();
+void PPUScreenshotScreenBuffer(struct GBInstance* pGB);
 #endif
 
-bool PPUInit();
-void PPUTick(cycles numCycles);
+//Sets up the lookup tables shared by every instance.
+void PPUInitShared();
+
+//The PPU moves itself on through the scheduler.
+bool PPUInit(struct GBInstance* pGB);
+
+//Has to be called whenever BGP changes.
+void PPUPaletteChanged(struct GBInstance* pGB);
+
+//Brings the PPU up to date with the scheduler's cycle counter.
+void PPUSync(struct GBInstance* pGB);
 
 #endif
@@ -0,0 +1,270 @@
+#include <assert.h>
+#include <string.h>
+
+#include "scanline.h"
+
+#include PLATFORM_INCLUDE(PLATFORM_NAME/platform_debug.h)
+
+#if SCANLINE_SIMD_SUPPORTED
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#include <cpuid.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+typedef void(*DrawTileRowsKernel)(enum Colour* pOut, const byte* pRowData, int numTiles, const enum Colour* pPalette);
+
+//Every byte with its bits spread out to every other bit, leftmost pixel first. A tile row is two bytes
+//with one bit of each pixel's colour index in each, so this turns it into 8 2 bit indices in one go.
+static uint16_t TileRowExpansion[256];
+
+static DrawTileRowsKernel DrawTileRows;
+
+uint16_t ScanlineDecodeTileRow(const byte* pLineData)
+{
+    return TileRowExpansion[pLineData[0]] | (TileRowExpansion[pLineData[1]] << 1);
+}
+
+//What the others have to match.
+static void DrawTileRowsScalar(enum Colour* pOut, const byte* pRowData, int numTiles, const enum Colour* pPalette)
+{
+    for (int tile = 0; tile < numTiles; ++tile, pOut += TILE_WIDTH)
+    {
+        uint16_t row = ScanlineDecodeTileRow(&pRowData[tile * 2]);
+
+        for (int x = 0; x < TILE_WIDTH; ++x)
+        {
+            pOut[x] = pPalette[(row >> (x * 2)) & 0b11];
+        }
+    }
+}
+
+static bool AlwaysSupported()
+{
+    return true;
+}
+
+#if SCANLINE_SIMD_SUPPORTED
+//Picks between two colours in each lane by a mask, as a ^ ((a ^ b) & mask).
+static FORCE_INLINE __m128i SelectSSE2(__m128i a, __m128i aXorB, __m128i mask)
+{
+    return _mm_xor_si128(a, _mm_and_si128(aXorB, mask));
+}
+
+//4 pixels, one per lane. bits has the bit for each lane's pixel, and lo and hi have the row's bytes
+//in every lane.
+static FORCE_INLINE __m128i GetColoursSSE2(__m128i lo, __m128i hi, __m128i bits, const __m128i* pColours)
+{
+    __m128i loMask = _mm_cmpeq_epi32(_mm_and_si128(lo, bits), bits);
+    __m128i hiMask = _mm_cmpeq_epi32(_mm_and_si128(hi, bits), bits);
+
+    __m128i col01 = SelectSSE2(pColours[0], _mm_xor_si128(pColours[0], pColours[1]), loMask);
+    __m128i col23 = SelectSSE2(pColours[2], _mm_xor_si128(pColours[2], pColours[3]), loMask);
+
+    return SelectSSE2(col01, _mm_xor_si128(col01, col23), hiMask);
+}
+
+static void DrawTileRowsSSE2(enum Colour* pOut, const byte* pRowData, int numTiles, const enum Colour* pPalette)
+{
+    const __m128i leftBits = _mm_setr_epi32(0x80, 0x40, 0x20, 0x10);
+    const __m128i rightBits = _mm_setr_epi32(0x08, 0x04, 0x02, 0x01);
+
+    __m128i colours[4];
+
+    for (int index = 0; index < 4; ++index)
+    {
+        colours[index] = _mm_set1_epi32(pPalette[index]);
+    }
+
+    for (int tile = 0; tile < numTiles; ++tile, pOut += TILE_WIDTH)
+    {
+        __m128i lo = _mm_set1_epi32(pRowData[tile * 2]);
+        __m128i hi = _mm_set1_epi32(pRowData[tile * 2 + 1]);
+
+        _mm_storeu_si128((__m128i*)pOut, GetColoursSSE2(lo, hi, leftBits, colours));
+        _mm_storeu_si128((__m128i*)(pOut + 4), GetColoursSSE2(lo, hi, rightBits, colours));
+    }
+}
+
+//A whole tile row fits in one register, and the palette lookup is a single permute.
+TARGET_AVX2 static void DrawTileRowsAVX2(enum Colour* pOut, const byte* pRowData, int numTiles, const enum Colour* pPalette)
+{
+    const __m256i shifts = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i palette = _mm256_setr_epi32(pPalette[0], pPalette[1], pPalette[2], pPalette[3], pPalette[0], pPalette[1], pPalette[2], pPalette[3]);
+
+    for (int tile = 0; tile < numTiles; ++tile, pOut += TILE_WIDTH)
+    {
+        __m256i lo = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(pRowData[tile * 2]), shifts), one);
+        __m256i hi = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(pRowData[tile * 2 + 1]), shifts), one);
+        __m256i indices = _mm256_or_si256(lo, _mm256_slli_epi32(hi, 1));
+
+        _mm256_storeu_si256((__m256i*)pOut, _mm256_permutevar8x32_epi32(palette, indices));
+    }
+}
+
+static bool HostSupportsAVX2()
+{
+    unsigned int info[4];
+
+#if defined(_MSC_VER)
+    __cpuid((int*)info, 0);
+#else
+    __cpuid(0, info[0], info[1], info[2], info[3]);
+#endif
+
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    //The OS has to save the AVX registers too, or using them will fault.
+#if defined(_MSC_VER)
+    __cpuid((int*)info, 1);
+#else
+    __cpuid(1, info[0], info[1], info[2], info[3]);
+#endif
+
+    static const unsigned int kOSXSave = 1 << 27;
+    static const unsigned int kAVX = 1 << 28;
+
+    if ((info[2] & (kOSXSave | kAVX)) != (kOSXSave | kAVX))
+    {
+        return false;
+    }
+
+#if defined(_MSC_VER)
+    unsigned long long enabledState = _xgetbv(0);
+    __cpuidex((int*)info, 7, 0);
+#else
+    unsigned int xcr0Low, xcr0High;
+    __asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    unsigned long long enabledState = xcr0Low | ((unsigned long long)xcr0High << 32);
+    __cpuid_count(7, 0, info[0], info[1], info[2], info[3]);
+#endif
+
+    static const unsigned int kAVX2 = 1 << 5;
+
+    return (enabledState & 0x6) == 0x6 && (info[1] & kAVX2) != 0;
+}
+#endif
+
+struct ScanlineKernel
+{
+    const char* pName;
+    DrawTileRowsKernel Draw;
+    bool(*IsSupported)();
+};
+
+//Fastest first. The scalar one has to be last.
+static const struct ScanlineKernel Kernels[] =
+{
+#if SCANLINE_SIMD_SUPPORTED
+    { "AVX2", &DrawTileRowsAVX2, &HostSupportsAVX2 },
+    { "SSE2", &DrawTileRowsSSE2, &AlwaysSupported },
+#endif
+    { "scalar", &DrawTileRowsScalar, &AlwaysSupported }
+};
+
+static const int NUM_KERNELS = sizeof(Kernels) / sizeof(Kernels[0]);
+
+#define CHECK_NUM_TILES 256
+
+bool ScanlineSelfTest()
+{
+    static const byte kPalettes[] = { 0xE4, 0x1B, 0xD2, 0x00 };
+
+    byte rowData[CHECK_NUM_TILES * 2];
+    enum Colour expected[CHECK_NUM_TILES * TILE_WIDTH];
+    enum Colour actual[CHECK_NUM_TILES * TILE_WIDTH];
+
+    bool passed = true;
+
+    for (int kernel = 0; kernel < NUM_KERNELS - 1; ++kernel)
+    {
+        if (!Kernels[kernel].IsSupported())
+        {
+            DebugPrint("Scanline kernel %s isn't supported here, skipping.\n", Kernels[kernel].pName);
+            continue;
+        }
+
+        bool matched = true;
+
+        for (int paletteIdx = 0; paletteIdx < (int)sizeof(kPalettes) && matched; ++paletteIdx)
+        {
+            enum Colour palette[4];
+
+            for (int index = 0; index < 4; ++index)
+            {
+                palette[index] = (kPalettes[paletteIdx] >> (index * 2)) & 0b11;
+            }
+
+            for (int hi = 0; hi < 256 && matched; ++hi)
+            {
+                for (int lo = 0; lo < CHECK_NUM_TILES; ++lo)
+                {
+                    rowData[lo * 2] = (byte)lo;
+                    rowData[lo * 2 + 1] = (byte)hi;
+                }
+
+                DrawTileRowsScalar(expected, rowData, CHECK_NUM_TILES, palette);
+                Kernels[kernel].Draw(actual, rowData, CHECK_NUM_TILES, palette);
+
+                matched = memcmp(expected, actual, sizeof(expected)) == 0;
+            }
+        }
+
+        DebugPrint("Scanline kernel %s %s the scalar one.\n", Kernels[kernel].pName, matched ? "matches" : "doesn't match");
+        passed = passed && matched;
+    }
+
+    return passed;
+}
+
+void ScanlineInit()
+{
+    //The kernels write colours out as 32 bit lanes.
+    assert(sizeof(enum Colour) == sizeof(int32_t));
+
+    for (int val = 0; val < 256; ++val)
+    {
+        uint16_t expanded = 0;
+
+        for (int x = 0; x < TILE_WIDTH; ++x)
+        {
+            if ((val & (1 << (7 - x))) != 0)
+            {
+                expanded |= 1 << (x * 2);
+            }
+        }
+
+        TileRowExpansion[val] = expanded;
+    }
+
+    for (int kernel = 0; kernel < NUM_KERNELS; ++kernel)
+    {
+        if (Kernels[kernel].IsSupported())
+        {
+            DrawTileRows = Kernels[kernel].Draw;
+            DebugPrint("Using %s scanline kernel.\n", Kernels[kernel].pName);
+            break;
+        }
+    }
+
+#if DEBUG_ENABLED
+    if (!ScanlineSelfTest())
+    {
+        assert(0);
+    }
+#endif
+}
+
+void ScanlineDrawTileRows(enum Colour* pOut, const byte* pRowData, int numTiles, const enum Colour* pPalette)
+{
+    DrawTileRows(pOut, pRowData, numTiles, pPalette);
+}
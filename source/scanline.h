@@ -0,0 +1,28 @@
+#ifndef SCANLINE_H
+#define SCANLINE_H
+
+#include "types.h"
+#include "ppu.h"
+
+//The vector kernels are only written for x86-64, where SSE2 can always be relied on.
+#if defined(__x86_64__) || defined(_M_X64)
+#define SCANLINE_SIMD_SUPPORTED 1
+#else
+#define SCANLINE_SIMD_SUPPORTED 0
+#endif
+
+//Picks the fastest kernel the host supports. Has to be called once before anything else in here.
+void ScanlineInit();
+
+//Runs every kernel the host supports against the scalar one for every possible tile row, and says
+//how each one did. Returns false if any of them don't match.
+bool ScanlineSelfTest();
+
+//The 8 2 bit colour indices in a tile row, leftmost pixel in the lowest bits.
+uint16_t ScanlineDecodeTileRow(const byte* pLineData);
+
+//Draws 8 pixels for each tile row through the palette. pRowData has the 2 bytes of each row as they
+//are in VRAM, one row after another.
+void ScanlineDrawTileRows(enum Colour* pOut, const byte* pRowData, int numTiles, const enum Colour* pPalette);
+
+#endif
@@ -0,0 +1,185 @@
+#include <stddef.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "scheduler.h"
+#include "instance.h"
+#include "utils.h"
+
+//Pending events are kept in a binary min-heap on their deadline. There are only ever a handful so the
+//heap is tiny, but it means finding the next one is always just looking at the top.
+
+static void HeapSwap(struct SchedulerState* pScheduler, int a, int b)
+{
+    enum SchedulerEvent event = pScheduler->Heap[a];
+    pScheduler->Heap[a] = pScheduler->Heap[b];
+    pScheduler->Heap[b] = (int8_t)event;
+
+    pScheduler->HeapIndex[pScheduler->Heap[a]] = (int8_t)a;
+    pScheduler->HeapIndex[pScheduler->Heap[b]] = (int8_t)b;
+}
+
+static void HeapSiftUp(struct SchedulerState* pScheduler, int idx)
+{
+    while (idx > 0)
+    {
+        int parent = (idx - 1) / 2;
+
+        if (pScheduler->Deadlines[pScheduler->Heap[parent]] <= pScheduler->Deadlines[pScheduler->Heap[idx]])
+        {
+            break;
+        }
+
+        HeapSwap(pScheduler, idx, parent);
+        idx = parent;
+    }
+}
+
+static void HeapSiftDown(struct SchedulerState* pScheduler, int idx)
+{
+    for (;;)
+    {
+        int smallest = idx;
+        int left = (idx * 2) + 1;
+        int right = left + 1;
+
+        if (left < pScheduler->HeapSize && pScheduler->Deadlines[pScheduler->Heap[left]] < pScheduler->Deadlines[pScheduler->Heap[smallest]])
+        {
+            smallest = left;
+        }
+
+        if (right < pScheduler->HeapSize && pScheduler->Deadlines[pScheduler->Heap[right]] < pScheduler->Deadlines[pScheduler->Heap[smallest]])
+        {
+            smallest = right;
+        }
+
+        if (smallest == idx)
+        {
+            break;
+        }
+
+        HeapSwap(pScheduler, idx, smallest);
+        idx = smallest;
+    }
+}
+
+static void HeapRemove(struct SchedulerState* pScheduler, int idx)
+{
+    enum SchedulerEvent event = pScheduler->Heap[idx];
+
+    pScheduler->HeapSize--;
+
+    if (idx != pScheduler->HeapSize)
+    {
+        HeapSwap(pScheduler, idx, pScheduler->HeapSize);
+        HeapSiftUp(pScheduler, idx);
+        HeapSiftDown(pScheduler, idx);
+    }
+
+    pScheduler->HeapIndex[event] = -1;
+}
+
+void SchedulerInit(struct GBInstance* pGB)
+{
+    struct SchedulerState* pScheduler = &pGB->Scheduler;
+    pScheduler->CurrentCycle = 0;
+    pScheduler->HeapSize = 0;
+    pScheduler->FiringEvent = NUM_SCHEDULER_EVENTS;
+
+    for (int i = 0; i < NUM_SCHEDULER_EVENTS; ++i)
+    {
+        pGB->SchedulerCold.Handlers[i] = NULL;
+        pScheduler->HeapIndex[i] = -1;
+    }
+}
+
+void SchedulerSetHandler(struct GBInstance* pGB, enum SchedulerEvent event, SchedulerEventFunc func)
+{
+    pGB->SchedulerCold.Handlers[event] = func;
+}
+
+void SchedulerSchedule(struct GBInstance* pGB, enum SchedulerEvent event, uint64_t cycle)
+{
+    struct SchedulerState* pScheduler = &pGB->Scheduler;
+    assert(pGB->SchedulerCold.Handlers[event] != NULL);
+
+    if (event == pScheduler->FiringEvent)
+    {
+        pScheduler->FiringEventRescheduled = true;
+    }
+
+    if (pScheduler->HeapIndex[event] < 0)
+    {
+        pScheduler->Deadlines[event] = cycle;
+        pScheduler->Heap[pScheduler->HeapSize] = (int8_t)event;
+        pScheduler->HeapIndex[event] = (int8_t)pScheduler->HeapSize;
+        pScheduler->HeapSize++;
+
+        HeapSiftUp(pScheduler, pScheduler->HeapIndex[event]);
+    }
+    else if (cycle < pScheduler->Deadlines[event])
+    {
+        pScheduler->Deadlines[event] = cycle;
+        HeapSiftUp(pScheduler, pScheduler->HeapIndex[event]);
+    }
+    else
+    {
+        pScheduler->Deadlines[event] = cycle;
+        HeapSiftDown(pScheduler, pScheduler->HeapIndex[event]);
+    }
+}
+
+void SchedulerCancel(struct GBInstance* pGB, enum SchedulerEvent event)
+{
+    struct SchedulerState* pScheduler = &pGB->Scheduler;
+    if (pScheduler->HeapIndex[event] >= 0)
+    {
+        HeapRemove(pScheduler, pScheduler->HeapIndex[event]);
+    }
+}
+
+uint64_t SchedulerGetCycles(struct GBInstance* pGB)
+{
+    return pGB->Scheduler.CurrentCycle;
+}
+
+static cycles CyclesUntil(struct SchedulerState* pScheduler, uint64_t cycle)
+{
+    return cycle > pScheduler->CurrentCycle ? (cycles)MIN(cycle - pScheduler->CurrentCycle, (uint64_t)INT_MAX) : 0;
+}
+
+cycles SchedulerCyclesUntilNextEvent(struct GBInstance* pGB)
+{
+    struct SchedulerState* pScheduler = &pGB->Scheduler;
+    return pScheduler->HeapSize > 0 ? CyclesUntil(pScheduler, pScheduler->Deadlines[pScheduler->Heap[0]]) : INT_MAX;
+}
+
+cycles SchedulerCyclesUntil(struct GBInstance* pGB, enum SchedulerEvent event)
+{
+    struct SchedulerState* pScheduler = &pGB->Scheduler;
+    return pScheduler->HeapIndex[event] >= 0 ? CyclesUntil(pScheduler, pScheduler->Deadlines[event]) : INT_MAX;
+}
+
+void SchedulerAdvance(struct GBInstance* pGB, cycles numCycles)
+{
+    struct SchedulerState* pScheduler = &pGB->Scheduler;
+    pScheduler->CurrentCycle += numCycles;
+
+    while (pScheduler->HeapSize > 0 && pScheduler->Deadlines[pScheduler->Heap[0]] <= pScheduler->CurrentCycle)
+    {
+        //Most handlers reschedule themselves, so the event is left where it is until it's known
+        //whether it needs to come out of the heap or just move down it.
+        enum SchedulerEvent event = pScheduler->Heap[0];
+        pScheduler->FiringEvent = (byte)event;
+        pScheduler->FiringEventRescheduled = false;
+
+        pGB->SchedulerCold.Handlers[event](pGB);
+
+        if (!pScheduler->FiringEventRescheduled && pScheduler->HeapIndex[event] >= 0)
+        {
+            HeapRemove(pScheduler, pScheduler->HeapIndex[event]);
+        }
+    }
+
+    pScheduler->FiringEvent = NUM_SCHEDULER_EVENTS;
+}
@@ -0,0 +1,60 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "types.h"
+
+//Everything that happens at a known time. The CPU can run uninterrupted until the earliest of them.
+enum SchedulerEvent
+{
+    SchedulerEvent_PPU,     //The next PPU mode change (and with it LY, rendering and VBlank).
+    SchedulerEvent_Timer,   //TIMA overflowing.
+    SchedulerEvent_DMA,     //OAM DMA finishing.
+    NUM_SCHEDULER_EVENTS
+};
+
+struct GBInstance;
+
+typedef void(*SchedulerEventFunc)(struct GBInstance* pGB);
+
+//The CPU only ever looks at the cycle counter and the earliest deadline, so those come first to sit in
+//the same cache lines as its own state.
+struct SchedulerState
+{
+    uint64_t CurrentCycle;
+    uint64_t Deadlines[NUM_SCHEDULER_EVENTS];
+
+    //Pending events as a binary min-heap on their deadline, and where each one is in it (-1 if not pending).
+    //There are only a few events, so bytes are plenty and keep all this in with the CPU's state.
+    int HeapSize;
+    int8_t Heap[NUM_SCHEDULER_EVENTS];
+    int8_t HeapIndex[NUM_SCHEDULER_EVENTS];
+
+    //The event whose handler is running, so it can tell whether it rescheduled itself.
+    byte FiringEvent;
+    bool FiringEventRescheduled;
+};
+
+//Only needed when an event actually fires.
+struct SchedulerColdState
+{
+    SchedulerEventFunc Handlers[NUM_SCHEDULER_EVENTS];
+};
+
+void SchedulerInit(struct GBInstance* pGB);
+
+//The event is called (once) when the cycle counter reaches it. It can be rescheduled from there.
+void SchedulerSetHandler(struct GBInstance* pGB, enum SchedulerEvent event, SchedulerEventFunc func);
+void SchedulerSchedule(struct GBInstance* pGB, enum SchedulerEvent event, uint64_t cycle);
+void SchedulerCancel(struct GBInstance* pGB, enum SchedulerEvent event);
+
+//Cycles since SchedulerInit.
+uint64_t SchedulerGetCycles(struct GBInstance* pGB);
+
+//INT_MAX if there's nothing (or nothing of that kind) scheduled.
+cycles SchedulerCyclesUntilNextEvent(struct GBInstance* pGB);
+cycles SchedulerCyclesUntil(struct GBInstance* pGB, enum SchedulerEvent event);
+
+//Moves the cycle counter on, calling anything that's due in the order they were due.
+void SchedulerAdvance(struct GBInstance* pGB, cycles numCycles);
+
+#endif
@@ -1,323 +1,643 @@
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
+#include <limits.h>
 
-#include "system.h"
+#include "instance.h"
 #include "utils.h"
-#include "cpu.h"
-#include "ppu.h"
+#include "timer.h"
+#include "cheats.h"
 
 #include "debug.h"
 
-#include PLATFORM_INCLUDE(PLATFORM_NAME/platform_app.h)
 #include PLATFORM_INCLUDE(PLATFORM_NAME/platform_debug.h)
+#include PLATFORM_INCLUDE(PLATFORM_NAME/platform_memory.h)
 
-//Addressable Memory. This should be accessed via the Read/Write/Access functions to allow for memory mapping.
-static byte Mem[MEM_SIZE];
-
-//Shortcuts
-byte* ROM = &Mem[ROM_ADDR];
-byte* VRAM = &Mem[VRAM_ADDR];
-byte* RAM = &Mem[RAM_ADDR];
-
-//Hardware Registers
-byte* Register_P1 = &Mem[REGISTER_P1_ADDR];
-byte* Register_DIV = &Mem[REGISTER_DIV_ADDR];
-byte* Register_TIMA = &Mem[REGISTER_TIMA_ADDR];
-byte* Register_TMA = &Mem[REGISTER_TMA_ADDR];
-byte* Register_TAC = &Mem[REGISTER_TAC_ADDR];
-byte* Register_IF = &Mem[REGISTER_IF_ADDR];
-byte* Register_LCDC = &Mem[REGISTER_LCDC_ADDR];
-byte* Register_STAT = &Mem[REGISTER_STAT_ADDR];
-byte* Register_SCY = &Mem[REGISTER_SCY_ADDR];
-byte* Register_SCX = &Mem[REGISTER_SCX_ADDR];
-byte* Register_LY = &Mem[REGISTER_LY_ADDR];
-byte* Register_DMA = &Mem[REGISTER_DMA_ADDR];
-byte* Register_BGP = &Mem[REGISTER_BGP_ADDR];
-byte* Register_WY = &Mem[REGISTER_WY_ADDR];
-byte* Register_WX = &Mem[REGISTER_WX_ADDR];
-byte* Register_IE = &Mem[REGISTER_IE_ADDR];
-
-#define CLOCK_CYCLES 4194304
 static const int CLOCK_CYCLES_PER_MS = CLOCK_CYCLES / 1000;
-static int TickCycles = 0;
-
-//For calculating emulation speed.
-static int TickCounter = 0;
-static int CycleCounter = 0;
-static float EmulationSpeed = 0;
-
-static int TimerInterval[4] = {
-    1024,   //4096Hz
-    16,     //262144Hz
-    64,     //65536Hz
-    256     //16384Hz
-};
-
-static int DivIntervalCount = 0;
-static int TimerIntervalCount = 0;
-
-#define BOOT_ROM_SIZE 0x100
-static byte BootROM[BOOT_ROM_SIZE];
-
-struct CartridgeHeader
-{
-    byte Title[16];         //0x0134-0x0143
-    byte LicenseeCode[2];   //0x0144-0x0145
-    byte SuperGBSupport;    //0x0146
-    byte CartridgeType;     //0x0147
-    byte ROMSize;           //0x0148
-    byte RAMSize;           //0x0149
-    byte Region;            //0x014A
-    byte OldLicenseeCode;   //0x014B
-    byte GameVersion;       //0x014C
-    byte HeaderChecksum;    //0x014D
-    byte GlobalChecksum[2]; //0x014E-0x014F
-};
-
-static DirectionInputCallbackFunc DirectionInputCallback = NULL;
-static ButtonInputCallbackFunc ButtonInputCallback = NULL;
-
-byte DirectionInputState = 0xFF;
-byte ButtonInputState = 0xFF;
 
-#if DEBUG_ENABLED
-static bool SingleStepMode = false;
-static bool SingleStepPending = false;
-static CallbackFunc StepCallback = NULL;
-static CallbackFunc ROMChangedCallback = NULL;
+#define BOOT_ROM_MAP_ADDR 0xFF50    //Writing non-zero here unmaps the boot ROM.
+
+//OAM DMA. The copy itself happens all at once, but the CPU is locked out of OAM (reads give 0xFF and
+//writes are ignored) until the transfer would have finished.
+#define DMA_CYCLES (VRAM_SPRITE_TABLE_SIZE * 4)
+static byte LockedSpriteTablePage[MEM_PAGE_SIZE];
 
-void ToggleSingleStepMode()
+static bool SharedStateInitialised = false;
+
+#if DEBUG_ENABLED
+void ToggleSingleStepMode(struct GBInstance* pGB)
 {
-    SingleStepMode = !SingleStepMode;
+    pGB->SingleStepMode = !pGB->SingleStepMode;
 }
 
-void EnableSingleStepMode()
+void EnableSingleStepMode(struct GBInstance* pGB)
 {
-    SingleStepMode = true;
+    pGB->SingleStepMode = true;
 }
 
-void RequestSingleStep()
+void RequestSingleStep(struct GBInstance* pGB)
 {
-    SingleStepPending = true;
+    pGB->SingleStepPending = true;
 }
 
-void RegisterStepCallback(CallbackFunc callback)
+void RegisterStepCallback(struct GBInstance* pGB, CallbackFunc callback)
 {
-    StepCallback = callback;
+    pGB->StepCallback = callback;
 }
 
-void RegisterROMChangedCallback(CallbackFunc callback)
+void RegisterROMChangedCallback(struct GBInstance* pGB, CallbackFunc callback)
 {
-    ROMChangedCallback = callback;
+    pGB->ROMChangedCallback = callback;
 }
 #endif
 
-static void SetInputRegisterState()
+static void SetInputRegisterState(struct GBInstance* pGB)
 {
     byte directionButtonsMask = 1 << 4;
     byte actionButtonsMask = 1 << 5;
 
-    bool directionButtons = (*Register_P1 & directionButtonsMask) == 0;
-bool actionButtons = (*Register_P1 & actionButtonsMask) == 0;
+    bool directionButtons = (*Register_P1(pGB) & directionButtonsMask) == 0;
+bool actionButtons = (*Register_P1(pGB) & actionButtonsMask) == 0;
 
-*Register_P1 = 0xCF;
+*Register_P1(pGB) = 0xCF;
 
 if (directionButtons)
 {
-    *Register_P1 |= directionButtonsMask;
-    *Register_P1 &= DirectionInputState;
+    *Register_P1(pGB) |= directionButtonsMask;
+    *Register_P1(pGB) &= pGB->DirectionInputState;
 }
 else if (actionButtons)
 {
-    *Register_P1 |= actionButtonsMask;
-    *Register_P1 &= ButtonInputState;
+    *Register_P1(pGB) |= actionButtonsMask;
+    *Register_P1(pGB) &= pGB->ButtonInputState;
 }
 }
 
-static void OnDirectionInput(enum DirectionInput input, bool pressed)
+void SystemDirectionInput(struct GBInstance* pGB, enum DirectionInput input, bool pressed)
 {
     if (pressed)
     {
-        DirectionInputState ^= input;
+        pGB->DirectionInputState ^= input;
     }
     else
     {
-        DirectionInputState |= input;
+        pGB->DirectionInputState |= input;
     }
 }
 
-static void OnButtonInput(enum ButtonInput input, bool pressed)
+void SystemButtonInput(struct GBInstance* pGB, enum ButtonInput input, bool pressed)
 {
     if (pressed)
     {
-        ButtonInputState &= ~input;
+        pGB->ButtonInputState &= ~input;
     }
     else
     {
-        ButtonInputState |= input;
+        pGB->ButtonInputState |= input;
     }
 }
 
-static void DMAToSpriteTable()
+static FORCE_INLINE void SetDirtyBit(uint64_t* pBits, int idx)
 {
-    for (uint16_t destAddr = VRAM_SPRITE_TABLE_ADDR, sourceAddr = *Register_DMA * 0x100; destAddr < VRAM_SPRITE_TABLE_ADDR + VRAM_SPRITE_TABLE_SIZE; ++destAddr, ++sourceAddr)
+    pBits[idx >> 6] |= 1ull << (idx & 63);
+}
+
+static FORCE_INLINE bool GetDirtyBit(const uint64_t* pBits, int idx)
+{
+    return (pBits[idx >> 6] >> (idx & 63)) & 1;
+}
+
+static void SetAllDirtyBits(uint64_t* pBits, int num)
+{
+    for (int idx = 0; idx < num; ++idx)
     {
-        byte val = ReadMem(sourceAddr);
-        WriteMem(destAddr, val);
+        SetDirtyBit(pBits, idx);
     }
 }
 
-//Memory access functions. Ideally, most things should be using Read/WriteMem in-case I need 
-//to add bus timing emulation at some point. Maybe AccessMem should be removed in future...
-byte* AccessMem(uint16_t addr)
+static void MarkAllVideoDirty(struct GBInstance* pGB)
+{
+    SetAllDirtyBits(pGB->VideoDirty.Tiles, NUM_VRAM_TILES);
+    SetAllDirtyBits(pGB->VideoDirty.TileMapRows, NUM_VRAM_TILE_MAP_ROWS);
+    SetAllDirtyBits(pGB->VideoDirty.Sprites, NUM_SPRITES);
+}
+
+//All writes to VRAM and OAM end up here, other than the PPU's own.
+static void WriteVideoMem(struct GBInstance* pGB, uint16_t addr, byte val)
+{
+    if (pGB->Mem[addr] == val)
+    {
+        return;
+    }
+
+    pGB->Mem[addr] = val;
+
+    if (addr < VRAM_TILE_MAP_ADDR_0)
+    {
+        SetDirtyBit(pGB->VideoDirty.Tiles, (addr - VRAM_ADDR) / BYTES_PER_TILE);
+    }
+    else if (addr < VRAM_ADDR + VRAM_SIZE)
+    {
+        SetDirtyBit(pGB->VideoDirty.TileMapRows, (addr - VRAM_TILE_MAP_ADDR_0) / BACKGROUND_TILES_PER_LINE);
+    }
+    else if (addr < VRAM_SPRITE_TABLE_ADDR + VRAM_SPRITE_TABLE_SIZE)
+    {
+        SetDirtyBit(pGB->VideoDirty.Sprites, (addr - VRAM_SPRITE_TABLE_ADDR) / BYTES_PER_SPRITE);
+    }
+
+    if (pGB->CPUCold.CodeLines[addr >> CPU_CODE_LINE_SHIFT])
+    {
+        CPUInvalidateCode(pGB, addr);
+    }
+}
+
+static bool IsSpriteTableLocked(struct GBInstance* pGB)
+{
+    return pGB->ReadPages[VRAM_SPRITE_TABLE_ADDR >> MEM_PAGE_SHIFT] == LockedSpriteTablePage;
+}
+
+//OAM is never written to directly (it's tracked) so locking it is just a case of hiding it from reads.
+static void LockSpriteTable(struct GBInstance* pGB, bool lock)
 {
-    if (Mem[0xFF50] == 0 && addr < BOOT_ROM_SIZE)   //Boot ROM mapped.
+    int page = VRAM_SPRITE_TABLE_ADDR >> MEM_PAGE_SHIFT;
+    pGB->ReadPages[page] = lock ? LockedSpriteTablePage : &pGB->Mem[page << MEM_PAGE_SHIFT];
+}
+
+static void DMAToSpriteTable(struct GBInstance* pGB)
+{
+    //The source never crosses a page so it can be copied in one go. Most games copy the same sprites
+    //over every frame, so only the ones that actually change are marked.
+    const byte* pSource = AccessMem(pGB, *Register_DMA(pGB) * 0x100);
+    byte* pSpriteTable = SpriteTable(pGB);
+
+    for (int sprite = 0; sprite < NUM_SPRITES; ++sprite)
     {
-        return &BootROM[addr];
+        int offset = sprite * BYTES_PER_SPRITE;
+
+        if (memcmp(&pSpriteTable[offset], &pSource[offset], BYTES_PER_SPRITE) != 0)
+        {
+            SetDirtyBit(pGB->VideoDirty.Sprites, sprite);
+        }
     }
 
-    return &Mem[addr];
+    memcpy(pSpriteTable, pSource, VRAM_SPRITE_TABLE_SIZE);
+
+    LockSpriteTable(pGB, true);
+    SchedulerSchedule(pGB, SchedulerEvent_DMA, SchedulerGetCycles(pGB) + DMA_CYCLES);
+}
+
+static void OnDMAFinished(struct GBInstance* pGB)
+{
+    LockSpriteTable(pGB, false);
+}
+
+static void CatchUpWithCPU(struct GBInstance* pGB);
+
+static void MapBootROM(struct GBInstance* pGB)
+{
+    pGB->ReadPages[0] = pGB->Mem[BOOT_ROM_MAP_ADDR] == 0 ? pGB->BootROM : pGB->pPageUnderBootROM;
+    CPUInvalidateFetchWindow(pGB);
+}
+
+//IO register read and write handlers, indexed from IO_ADDR. Shared by every instance.
+typedef byte(*IOReadHandler)(struct GBInstance* pGB, uint16_t addr);
+typedef void(*IOWriteHandler)(struct GBInstance* pGB, uint16_t addr, byte val);
+static IOReadHandler IOReadHandlers[IO_SIZE];
+static IOWriteHandler IOWriteHandlers[IO_SIZE];
+
+static byte ReadIORegister(struct GBInstance* pGB, uint16_t addr)
+{
+    return pGB->Mem[addr];
+}
+
+//DIV and TIMA are only worked out when something reads them, and the CPU could be some way into its
+//run (or a block) by then. PendingCycles is kept up to the instruction doing the read, so catching up
+//first gets the value for exactly when it's read.
+static byte ReadTimer(struct GBInstance* pGB, uint16_t addr)
+{
+    CatchUpWithCPU(pGB);
+    TimerSync(pGB);
+    return pGB->Mem[addr];
+}
+
+static void WriteIORegister(struct GBInstance* pGB, uint16_t addr, byte val)
+{
+    pGB->Mem[addr] = val;
+}
+
+static void WriteP1(struct GBInstance* pGB, uint16_t addr, byte val)
+{
+    pGB->Mem[addr] = val;
+    SetInputRegisterState(pGB);
 }
 
-byte ReadMem(uint16_t addr)
+static void WriteIF(struct GBInstance* pGB, uint16_t addr, byte val)
 {
-    return *AccessMem(addr);
+    pGB->Mem[addr] = val;
+    CPUInterruptRegistersChanged(pGB);
 }
 
-void WriteMem(uint16_t addr, byte val)
+static void WriteBGP(struct GBInstance* pGB, uint16_t addr, byte val)
 {
-    byte* pAddr = AccessMem(addr);
+    pGB->Mem[addr] = val;
+    PPUPaletteChanged(pGB);
+}
 
-    //Not allowed to write to ROM!
-    if (addr >= ROM_SIZE)
+static void WriteDMA(struct GBInstance* pGB, uint16_t addr, byte val)
+{
+    pGB->Mem[addr] = val;
+    DMAToSpriteTable(pGB);
+}
+
+static void WriteBootROMMap(struct GBInstance* pGB, uint16_t addr, byte val)
+{
+    pGB->Mem[addr] = val;
+    MapBootROM(pGB);
+}
+
+static void InitIOHandlers()
+{
+    for (int i = 0; i < IO_SIZE; ++i)
     {
-        *pAddr = val;
+        IOReadHandlers[i] = &ReadIORegister;
+        IOWriteHandlers[i] = &WriteIORegister;
     }
 
-    if (addr == REGISTER_P1_ADDR)
+    IOReadHandlers[REGISTER_DIV_ADDR - IO_ADDR] = &ReadTimer;
+    IOReadHandlers[REGISTER_TIMA_ADDR - IO_ADDR] = &ReadTimer;
+
+    IOWriteHandlers[REGISTER_P1_ADDR - IO_ADDR] = &WriteP1;
+    IOWriteHandlers[REGISTER_DIV_ADDR - IO_ADDR] = &TimerWrite;
+    IOWriteHandlers[REGISTER_TIMA_ADDR - IO_ADDR] = &TimerWrite;
+    IOWriteHandlers[REGISTER_TMA_ADDR - IO_ADDR] = &TimerWrite;
+    IOWriteHandlers[REGISTER_TAC_ADDR - IO_ADDR] = &TimerWrite;
+    IOWriteHandlers[REGISTER_IF_ADDR - IO_ADDR] = &WriteIF;
+    IOWriteHandlers[REGISTER_BGP_ADDR - IO_ADDR] = &WriteBGP;
+    IOWriteHandlers[REGISTER_DMA_ADDR - IO_ADDR] = &WriteDMA;
+    IOWriteHandlers[BOOT_ROM_MAP_ADDR - IO_ADDR] = &WriteBootROMMap;
+}
+
+static void InitMemoryMap(struct GBInstance* pGB)
+{
+    for (int page = 0; page < MEM_NUM_PAGES; ++page)
+    {
+        pGB->ReadPages[page] = &pGB->Mem[page << MEM_PAGE_SHIFT];
+        pGB->WritePages[page] = &pGB->Mem[page << MEM_PAGE_SHIFT];
+    }
+
+    //The cartridge maps its own ROM and RAM in later.
+    for (int page = 0; page < (ROM_SIZE >> MEM_PAGE_SHIFT); ++page)
+    {
+        pGB->WritePages[page] = NULL;
+    }
+
+    pGB->pPageUnderBootROM = pGB->ReadPages[0];
+
+    //Writes to VRAM and OAM are tracked.
+    for (int page = (VRAM_ADDR >> MEM_PAGE_SHIFT); page < ((VRAM_ADDR + VRAM_SIZE) >> MEM_PAGE_SHIFT); ++page)
+    {
+        pGB->WritePages[page] = NULL;
+    }
+
+    pGB->WritePages[VRAM_SPRITE_TABLE_ADDR >> MEM_PAGE_SHIFT] = NULL;
+
+    //IO shares the last page with HRAM and IE.
+    pGB->ReadPages[IO_ADDR >> MEM_PAGE_SHIFT] = NULL;
+    pGB->WritePages[IO_ADDR >> MEM_PAGE_SHIFT] = NULL;
+
+    MapBootROM(pGB);
+}
+
+void SystemMapMemory(struct GBInstance* pGB, uint16_t addr, int size, byte* pRead, byte* pWrite)
+{
+    assert((addr & (MEM_PAGE_SIZE - 1)) == 0 && (size & (MEM_PAGE_SIZE - 1)) == 0);
+
+    for (int offset = 0; offset < size; offset += MEM_PAGE_SIZE)
     {
-        SetInputRegisterState();
+        int page = (addr + offset) >> MEM_PAGE_SHIFT;
+        pGB->ReadPages[page] = &pRead[offset];
+        pGB->WritePages[page] = pWrite != NULL ? &pWrite[offset] : NULL;
     }
-    else if (addr == REGISTER_DMA_ADDR)
+
+    //Cheats patch the ROM by mapping their own copies of pages over it.
+    if (addr < ROM_ADDR + ROM_SIZE)
     {
-        DMAToSpriteTable();
+        CheatPatchROM(pGB, addr, size);
     }
-    else if (addr == REGISTER_DIV_ADDR)
+
+    //The boot ROM sits on top of whatever's mapped at 0.
+    if (addr == ROM_ADDR)
     {
-        *Register_DIV = 0;
+        pGB->pPageUnderBootROM = pGB->ReadPages[0];
     }
+
+    //Also invalidates the fetch window as the code that's running could have just been switched out.
+    MapBootROM(pGB);
 }
 
-uint16_t ReadMem16(uint16_t addr)
+//Memory access functions. Ideally, most things should be using Read/WriteMem in-case I need 
+//to add bus timing emulation at some point. Maybe AccessMem should be removed in future...
+byte* AccessMem(struct GBInstance* pGB, uint16_t addr)
 {
-    byte* pAddr = AccessMem(addr);
-    return *pAddr | (*(pAddr + 1) << 8);
+    byte* pPage = pGB->ReadPages[addr >> MEM_PAGE_SHIFT];
+
+    //The IO page is never mapped for reads, but it all lives in Mem.
+    return pPage != NULL ? &pPage[addr & (MEM_PAGE_SIZE - 1)] : &pGB->Mem[addr];
 }
 
-void FireInterrupt(enum Interrupt interrupt)
+static byte ReadMemSlow(struct GBInstance* pGB, uint16_t addr)
 {
-    CPUSetInterrupt(interrupt);
+    //HRAM and IE share the page with IO but are plain memory.
+    if (addr >= IO_ADDR + IO_SIZE)
+    {
+        return pGB->Mem[addr];
+    }
+
+    return IOReadHandlers[addr - IO_ADDR](pGB, addr);
 }
 
-void TimerTick(cycles numCycles)
+byte ReadMem(struct GBInstance* pGB, uint16_t addr)
 {
-    if ((DivIntervalCount += numCycles) >= 0x4000)
+    byte* pPage = pGB->ReadPages[addr >> MEM_PAGE_SHIFT];
+
+    if (pPage == NULL)
     {
-        DivIntervalCount -= 0x4000;
+        return ReadMemSlow(pGB, addr);
+    }
 
-        if (*Register_DIV == 0xFF)
+    return pPage[addr & (MEM_PAGE_SIZE - 1)];
+}
+
+static void WriteMemSlow(struct GBInstance* pGB, uint16_t addr, byte val)
+{
+    //HRAM shares a page with IO but is plain memory.
+    if (addr >= IO_ADDR + IO_SIZE && addr != REGISTER_IE_ADDR)
+    {
+        pGB->Mem[addr] = val;
+        return;
+    }
+
+    pGB->NumSideEffectWrites++;
+
+    //Bank controller registers and any cartridge RAM that isn't mapped directly.
+    if (addr < ROM_SIZE || (addr >= CART_RAM_ADDR && addr < CART_RAM_ADDR + CART_RAM_SIZE))
+    {
+        CartridgeWrite(pGB, addr, val);
+        return;
+    }
+
+    if (addr >= VRAM_ADDR && addr < VRAM_ADDR + VRAM_SIZE)
+    {
+        WriteVideoMem(pGB, addr, val);
+        return;
+    }
+
+    //OAM can't be written to at all while DMA has it locked.
+    if ((addr >> MEM_PAGE_SHIFT) == (VRAM_SPRITE_TABLE_ADDR >> MEM_PAGE_SHIFT))
+    {
+        if (!IsSpriteTableLocked(pGB))
         {
-            *Register_DIV = 0;
+            WriteVideoMem(pGB, addr, val);
         }
-        else
+
+        return;
+    }
+
+    if (addr == REGISTER_IE_ADDR)
+    {
+        pGB->Mem[addr] = val;
+        CPUInterruptRegistersChanged(pGB);
+        return;
+    }
+
+    //Writing to a hardware register can change when the next event happens so everything else needs
+    //to be brought up to date first, and the CPU needs to stop once this instruction is done.
+    CatchUpWithCPU(pGB);
+    CPUBreakRun(pGB);
+
+    IOWriteHandlers[addr - IO_ADDR](pGB, addr, val);
+}
+
+void WriteMem(struct GBInstance* pGB, uint16_t addr, byte val)
+{
+    byte* pPage = pGB->WritePages[addr >> MEM_PAGE_SHIFT];
+
+    if (pPage == NULL)
+    {
+        WriteMemSlow(pGB, addr, val);
+        return;
+    }
+
+    pPage[addr & (MEM_PAGE_SIZE - 1)] = val;
+
+    //Throw away any cached code that's just been overwritten.
+    if (pGB->CPUCold.CodeLines[addr >> CPU_CODE_LINE_SHIFT])
+    {
+        CPUInvalidateCode(pGB, addr);
+    }
+}
+
+uint16_t ReadMem16(struct GBInstance* pGB, uint16_t addr)
+{
+    return ReadMem(pGB, addr) | (ReadMem(pGB, addr + 1) << 8);
+}
+
+void SystemSnapshotMemory(struct GBInstance* pGB, byte* pBuffer)
+{
+    TimerSync(pGB);
+    memcpy(pBuffer, pGB->Mem, MEM_SIZE);
+}
+
+void SystemRestoreMemory(struct GBInstance* pGB, const byte* pBuffer)
+{
+    memcpy(pGB->Mem, pBuffer, MEM_SIZE);
+    MapBootROM(pGB);
+    MarkAllVideoDirty(pGB);
+    PPUPaletteChanged(pGB);
+}
+
+void SystemBeginWatchingWrites(struct GBInstance* pGB)
+{
+    pGB->WatchedWritesStart = pGB->NumSideEffectWrites;
+
+    for (int i = 0; i < (CART_RAM_SIZE >> MEM_PAGE_SHIFT); ++i)
+    {
+        int page = (CART_RAM_ADDR >> MEM_PAGE_SHIFT) + i;
+        pGB->WatchedCartRAMPages[i] = pGB->WritePages[page];
+        pGB->WritePages[page] = NULL;
+    }
+}
+
+int SystemEndWatchingWrites(struct GBInstance* pGB)
+{
+    int numWrites = pGB->NumSideEffectWrites - pGB->WatchedWritesStart;
+
+    //If anything went to the cartridge the mapping could have changed since. The pages can just be left
+    //unmapped then, as the next write to each one maps it again.
+    if (numWrites == 0)
+    {
+        for (int i = 0; i < (CART_RAM_SIZE >> MEM_PAGE_SHIFT); ++i)
         {
-            (*Register_DIV)++;
+            pGB->WritePages[(CART_RAM_ADDR >> MEM_PAGE_SHIFT) + i] = pGB->WatchedCartRAMPages[i];
         }
     }
 
-    bool timerEnabled = (*Register_TAC & 0b100);
-    int timerMode = (*Register_TAC & 0b11);
+    return numWrites;
+}
+
+void FireInterrupt(struct GBInstance* pGB, enum Interrupt interrupt)
+{
+    CPUSetInterrupt(pGB, interrupt);
+}
+
+const struct VideoDirtyState* SystemGetVideoDirty(struct GBInstance* pGB)
+{
+    return &pGB->VideoDirty;
+}
+
+bool SystemIsTileDirty(struct GBInstance* pGB, int tile)
+{
+    assert(tile >= 0 && tile < NUM_VRAM_TILES);
+    return GetDirtyBit(pGB->VideoDirty.Tiles, tile);
+}
+
+bool SystemIsTileMapRowDirty(struct GBInstance* pGB, int row)
+{
+    assert(row >= 0 && row < NUM_VRAM_TILE_MAP_ROWS);
+    return GetDirtyBit(pGB->VideoDirty.TileMapRows, row);
+}
+
+bool SystemIsSpriteDirty(struct GBInstance* pGB, int sprite)
+{
+    assert(sprite >= 0 && sprite < NUM_SPRITES);
+    return GetDirtyBit(pGB->VideoDirty.Sprites, sprite);
+}
 
-    if (timerEnabled)
+void SystemClearVideoDirty(struct GBInstance* pGB)
+{
+    memset(&pGB->VideoDirty, 0, sizeof(pGB->VideoDirty));
+}
+
+static void CatchUpWithCPU(struct GBInstance* pGB)
+{
+    cycles numCycles = CPUTakePendingCycles(pGB);
+
+    if (numCycles > 0)
     {
-        if ((TimerIntervalCount += numCycles) >= TimerInterval[timerMode])
-        {
-            TimerIntervalCount -= TimerInterval[timerMode];
+        SchedulerAdvance(pGB, numCycles);
+        pGB->StepCaughtUpCycles += numCycles;
+    }
 
-            if (*Register_TIMA == 0xFF)
-            {
-                *Register_TIMA = *Register_TMA;
-                FireInterrupt(Interrupt_Timer);
-            }
-            else
-            {
-                (*Register_TIMA)++;
-            }
-        }
+    //Things only move themselves on when they have an event due. The timer doesn't need to be here
+    //as it syncs itself whenever its registers are touched.
+    PPUSync(pGB);
+}
+
+//How long the system can be left alone without anything happening that could raise an interrupt.
+static cycles CyclesUntilNextEvent(struct GBInstance* pGB, cycles maxCycles)
+{
+    cycles numCycles = MIN(maxCycles, SchedulerCyclesUntil(pGB, SchedulerEvent_PPU));
+    return MIN(numCycles, SchedulerCyclesUntil(pGB, SchedulerEvent_Timer));
+}
+
+static void InitSharedState()
+{
+    if (SharedStateInitialised)
+    {
+        return;
     }
+
+    memset(LockedSpriteTablePage, 0xFF, sizeof(LockedSpriteTablePage));
+    InitIOHandlers();
+    PPUInitShared();
+
+    SharedStateInitialised = true;
 }
 
-bool SystemInit(const char* pRomFile)
+struct GBInstance* SystemCreate()
+{
+    struct GBInstance* pGB = PlatformAllocAligned(sizeof(struct GBInstance), CACHE_LINE_SIZE);
+
+    if (pGB == NULL)
+    {
+        DebugPrint("Failed to allocate instance!\n");
+        return NULL;
+    }
+
+    pGB->DirectionInputState = 0xFF;
+    pGB->ButtonInputState = 0xFF;
+
+    CartridgeCreate(pGB);
+
+    if (!CPUCreate(pGB))
+    {
+        PlatformFreeAligned(pGB);
+        return NULL;
+    }
+
+    return pGB;
+}
+
+void SystemDestroy(struct GBInstance* pGB)
+{
+    SystemShutdown(pGB);
+    CheatDestroy(pGB);
+    CPUDestroy(pGB);
+    PlatformFreeAligned(pGB);
+}
+
+bool SystemInit(struct GBInstance* pGB, const char* pRomFile)
 {
     uint16_t startAddr = 0;
 
+    InitSharedState();
+
+    //Start from a clean slate so that the system can be re-initialised (ie. between benchmark runs).
+    memset(pGB->Mem, 0, sizeof(pGB->Mem));
+    MarkAllVideoDirty(pGB);
+    pGB->TickCycles = 0;
+
     //Initialise system state as required (https://gbdev.io/pandocs/Power_Up_Sequence.html).
-    *Register_P1 = 0xCF;
-    *Register_DIV = 0x18;
-    *Register_TIMA = 0x00;
-    *Register_TMA = 0x00;
-    *Register_TAC = 0x00;
-    *Register_IF = 0xE1;
-    *Register_LCDC = 0x91;
-    *Register_STAT = 0x81;
-    *Register_SCY = 0x00;
-    *Register_SCX = 0x00;
-    *Register_LY = 0x91;
-    *Register_BGP = 0xFC;
-    *Register_WY = 0x00;
-    *Register_WX = 0x00;
-    *Register_IE = 0x00;
-
-    //Reading from the cartridge when there isn't one in results in 0xFF.
-    memset(ROM, 0xFF, ROM_SIZE);
+    *Register_P1(pGB) = 0xCF;
+    *Register_DIV(pGB) = 0x18;
+    *Register_TIMA(pGB) = 0x00;
+    *Register_TMA(pGB) = 0x00;
+    *Register_TAC(pGB) = 0x00;
+    *Register_IF(pGB) = 0xE1;
+    *Register_LCDC(pGB) = 0x91;
+    *Register_STAT(pGB) = 0x81;
+    *Register_SCY(pGB) = 0x00;
+    *Register_SCX(pGB) = 0x00;
+    *Register_LY(pGB) = 0x91;
+    *Register_BGP(pGB) = 0xFC;
+    *Register_WY(pGB) = 0x00;
+    *Register_WX(pGB) = 0x00;
+    *Register_IE(pGB) = 0x00;
+
+    SchedulerInit(pGB);
+    SchedulerSetHandler(pGB, SchedulerEvent_DMA, &OnDMAFinished);
+    TimerInit(pGB);
 
     #define USE_BOOT_ROM 1
 
 #if USE_BOOT_ROM
-    if (!FileRead("dmg_boot.bin", BootROM, BOOT_ROM_SIZE))
+    if (!FileRead("dmg_boot.bin", pGB->BootROM, BOOT_ROM_SIZE))
     {
         DebugPrint("Failed to read boot rom file!\n");
         assert(0);
         return false;
     }
 #else
-    Mem[0xFF50] = 1;    //Unmap the boot rom.
+    pGB->Mem[BOOT_ROM_MAP_ADDR] = 1;    //Unmap the boot rom.
     startAddr = 0x100;
 #endif
 
-    if (pRomFile != NULL)
-    {
-        if (!FileRead(pRomFile, ROM, ROM_SIZE))
-        {
-            DebugPrint("Failed to read file %s!\n", pRomFile);
-            assert(0);
-            return false;
-        }
-
-        struct CartridgeHeader* pHeader = (struct CartridgeHeader*)&Mem[0x0134];
-        DebugPrint("Cartridge Loaded: \n");
-        DebugPrint("\tTitle: %.16s\n", pHeader->Title);
-        DebugPrint("\tLicenseeCode: %.2s\n", pHeader->LicenseeCode);
-        DebugPrint("\tSuperGBSupport: %u\n", pHeader->SuperGBSupport);
-        DebugPrint("\tCartridgeType: %u\n", pHeader->CartridgeType);
-        DebugPrint("\tROMSize: %u\n", pHeader->ROMSize);
-        DebugPrint("\tRAMSize: %u\n", pHeader->RAMSize);
-        DebugPrint("\tRegion: %u\n", pHeader->Region);
-        DebugPrint("\tOldLicenseeCode: %u\n", pHeader->OldLicenseeCode);
-        DebugPrint("\tGameVersion: %u\n", pHeader->GameVersion);
+    CheatInit(pGB);
+    InitMemoryMap(pGB);
 
-        assert(pHeader->CartridgeType == 0);    //We don't support any fancy shit yet!
+    if (!CartridgeInit(pGB, pRomFile))
+    {
+        return false;
     }
 
     byte interruptOps[NUM_INTERRUPTS] = {
@@ -328,57 +648,70 @@ bool SystemInit(const char* pRomFile)
         InterruptOp_Joypad
     };
 
-    if (!CPUInit(startAddr, interruptOps, NUM_INTERRUPTS))
+    if (!CPUInit(pGB, startAddr, interruptOps, NUM_INTERRUPTS))
     {
         return false;
     }
 
-    if (!PPUInit())
+    if (!PPUInit(pGB))
     {
         return false;
     }
 
-    AppRegisterDirectionInputCallback(&OnDirectionInput);
-    AppRegisterButtonInputCallback(&OnButtonInput);
-
     return true;
 }
 
-cycles Step()
+cycles Step(struct GBInstance* pGB, cycles maxCycles)
 {
-    cycles cpuCycles = CPUTick();
+    //Let the CPU run on its own until the next thing that could change is due, then catch everything
+    //else up in one go.
+    cycles budget = MIN(maxCycles, SchedulerCyclesUntilNextEvent(pGB));
 
-    if (cpuCycles == 0)
+#if DEBUG_ENABLED
+    //The debugger needs to see every instruction.
+    if (pGB->StepCallback != NULL)
     {
-        //In the case that the CPU is HALTed we need to keep the rest of the system ticking over.
-        cpuCycles = 1;
+        budget = 1;
     }
+#endif
+
+    pGB->StepCaughtUpCycles = 0;
+    cycles cpuCycles = CPURunFor(pGB, budget);
 
-    //Update PPU.
-    PPUTick(cpuCycles);
+    if (cpuCycles == 0)
+    {
+        //In the case that the CPU is HALTed we need to keep the rest of the system ticking over. Nothing
+        //can wake it up until the next event so skip straight to that (or the end of the budget, as
+        //input only arrives between ticks).
+        cpuCycles = MAX(1, CyclesUntilNextEvent(pGB, maxCycles));
+    }
 
-    //Update timer.
-    TimerTick(cpuCycles);
+    SchedulerAdvance(pGB, cpuCycles);
 
 #if DEBUG_ENABLED
-    if (StepCallback != NULL)
+    if (pGB->StepCallback != NULL)
     {
-        StepCallback();
+        pGB->StepCallback();
     }
 #endif
 
-    return cpuCycles;
+    return pGB->StepCaughtUpCycles + cpuCycles;
 }
 
-void SystemTick(uint32_t dt)
+void SystemShutdown(struct GBInstance* pGB)
+{
+    CartridgeShutdown(pGB);
+}
+
+void SystemTick(struct GBInstance* pGB, uint32_t dt)
 {
 #if DEBUG_ENABLED
-    if (SingleStepMode)
+    if (pGB->SingleStepMode)
     {
-        if (SingleStepPending)
+        if (pGB->SingleStepPending)
         {
-            Step();
-            SingleStepPending = false;
+            Step(pGB, 1);
+            pGB->SingleStepPending = false;
         }
 
         return;
@@ -401,46 +734,48 @@ void SystemTick(uint32_t dt)
                 DebugPrint("Warning: Capping clock cycles!\n");
             }
 
-            while (TickCycles < numCyclesForDt
+            while (pGB->TickCycles < numCyclesForDt
 #if DEBUG_ENABLED
-                && !SingleStepMode  //If we hit a breakpoint during a step we need to break out.
+                && !pGB->SingleStepMode  //If we hit a breakpoint during a step we need to break out.
 #endif
                 )
             {
-                byte bootROMMapVal = Mem[0xFF50];
+                byte bootROMMapVal = pGB->Mem[BOOT_ROM_MAP_ADDR];
 
-                cycles stepCycles = Step();
+                cycles stepCycles = Step(pGB, numCyclesForDt - pGB->TickCycles);
 
                 //May be a better way of doing this but probably after I've added MBC support.
-                if (bootROMMapVal != Mem[0xFF50])
+                if (bootROMMapVal != pGB->Mem[BOOT_ROM_MAP_ADDR])
                 {
 #if DEBUG_ENABLED
-                    if (ROMChangedCallback != NULL)
+                    if (pGB->ROMChangedCallback != NULL)
                     {
-                        ROMChangedCallback();
+                        pGB->ROMChangedCallback();
                     }
 #endif
                 }
 
-                TickCycles += stepCycles;
+                pGB->TickCycles += stepCycles;
             }
 
-            TickCycles = MAX(0, TickCycles - numCyclesForDt);
+            pGB->TickCycles = MAX(0, pGB->TickCycles - numCyclesForDt);
 
             //Calculate emulation speed.
-            CycleCounter += numCyclesForDt;
+            pGB->CycleCounter += numCyclesForDt;
 
-            if ((TickCounter += dt) >= 1000)
+            if ((pGB->TickCounter += dt) >= 1000)
             {
-                EmulationSpeed = (float)CycleCounter / CLOCK_CYCLES;
-                TickCounter = 0;
-                CycleCounter = 0;
+                pGB->EmulationSpeed = (float)pGB->CycleCounter / CLOCK_CYCLES;
+                pGB->TickCounter = 0;
+                pGB->CycleCounter = 0;
 
-                if (EmulationSpeed < 0.99f)
+                if (pGB->EmulationSpeed < 0.99f)
                 {
-                    DebugPrint("Warning: Emulation speed %.2f!\n", EmulationSpeed);
+                    DebugPrint("Warning: Emulation speed %.2f!\n", pGB->EmulationSpeed);
                 }
             }
         }
+
+        CartridgeTick(pGB, dt);
     }
 }
@@ -4,11 +4,23 @@
 #include "types.h"
 #include "system_types.h"
 
+#define CLOCK_CYCLES 4194304
+
 #define MEM_SIZE 64*1024
 
+//Granularity of the memory map.
+#define MEM_PAGE_SHIFT 8
+#define MEM_PAGE_SIZE (1 << MEM_PAGE_SHIFT)
+#define MEM_NUM_PAGES (MEM_SIZE >> MEM_PAGE_SHIFT)
+
+#define BOOT_ROM_SIZE 0x100
+
 #define ROM_ADDR 0
 #define ROM_SIZE 32*1024
 
+#define CART_RAM_ADDR 0xA000
+#define CART_RAM_SIZE 8*1024
+
 #define VRAM_ADDR 0x8000
 #define VRAM_SIZE 8*1024
 #define VRAM_TILE_DATA_ADDR_0 0x8000
@@ -20,57 +32,63 @@
 #define VRAM_SPRITE_TABLE_ADDR 0xFE00
 #define VRAM_SPRITE_TABLE_SIZE 160
 
+//The PPU's view of OAM, which unlike AccessMem isn't locked out during DMA.
+#define SpriteTable(pGB) (&(pGB)->Mem[VRAM_SPRITE_TABLE_ADDR])
+
 #define RAM_ADDR 0xC000
 #define RAM_SIZE 8*1024
 
-//Hardware Registers
+#define IO_ADDR 0xFF00
+#define IO_SIZE 0x80
+
+//Hardware Registers. These are just where they live in memory.
 #define REGISTER_P1_ADDR 0xFF00
-extern byte* Register_P1;
+#define Register_P1(pGB) (&(pGB)->Mem[REGISTER_P1_ADDR])
 
 #define REGISTER_DIV_ADDR 0xFF04
-extern byte* Register_DIV;
+#define Register_DIV(pGB) (&(pGB)->Mem[REGISTER_DIV_ADDR])
 
 #define REGISTER_TIMA_ADDR 0xFF05
-extern byte* Register_TIMA;
+#define Register_TIMA(pGB) (&(pGB)->Mem[REGISTER_TIMA_ADDR])
 
 #define REGISTER_TMA_ADDR 0xFF06
-extern byte* REGISTER_TMA;
+#define Register_TMA(pGB) (&(pGB)->Mem[REGISTER_TMA_ADDR])
 
 #define REGISTER_TAC_ADDR 0xFF07
-extern byte* REGISTER_TAC;
+#define Register_TAC(pGB) (&(pGB)->Mem[REGISTER_TAC_ADDR])
 
 #define REGISTER_IF_ADDR 0xFF0F
-extern byte* Register_IF;
+#define Register_IF(pGB) (&(pGB)->Mem[REGISTER_IF_ADDR])
 
 #define REGISTER_LCDC_ADDR 0xFF40
-extern byte* Register_LCDC;
+#define Register_LCDC(pGB) (&(pGB)->Mem[REGISTER_LCDC_ADDR])
 
 #define REGISTER_STAT_ADDR 0xFF41
-extern byte* Register_STAT;
+#define Register_STAT(pGB) (&(pGB)->Mem[REGISTER_STAT_ADDR])
 
 #define REGISTER_SCY_ADDR 0xFF42
-extern byte* Register_SCY;
+#define Register_SCY(pGB) (&(pGB)->Mem[REGISTER_SCY_ADDR])
 
 #define REGISTER_SCX_ADDR 0xFF43
-extern byte* Register_SCX;
+#define Register_SCX(pGB) (&(pGB)->Mem[REGISTER_SCX_ADDR])
 
 #define REGISTER_LY_ADDR 0xFF44
-extern byte* Register_LY;
+#define Register_LY(pGB) (&(pGB)->Mem[REGISTER_LY_ADDR])
 
 #define REGISTER_DMA_ADDR 0xFF46
-extern byte* Register_DMA;
+#define Register_DMA(pGB) (&(pGB)->Mem[REGISTER_DMA_ADDR])
 
 #define REGISTER_BGP_ADDR 0xFF47
-extern byte* Register_BGP;
+#define Register_BGP(pGB) (&(pGB)->Mem[REGISTER_BGP_ADDR])
 
 #define REGISTER_WY_ADDR 0xFF4A
-extern byte* Register_WY;
+#define Register_WY(pGB) (&(pGB)->Mem[REGISTER_WY_ADDR])
 
 #define REGISTER_WX_ADDR 0xFF4B
-extern byte* Register_WX;
+#define Register_WX(pGB) (&(pGB)->Mem[REGISTER_WX_ADDR])
 
 #define REGISTER_IE_ADDR 0xFFFF
-extern byte* Register_IE;
+#define Register_IE(pGB) (&(pGB)->Mem[REGISTER_IE_ADDR])
 
 //Interrupts
 #define NUM_INTERRUPTS 5
@@ -89,25 +107,74 @@ extern byte* Register_IE;
 
 static const int BACKGROUND_TILES_PER_LINE = BACKGROUND_RES_X / TILE_WIDTH;
 
-byte* AccessMem(uint16_t addr);
+#define BYTES_PER_SPRITE 4
+
+//What's tracked for writes to VRAM and OAM. Tiles are numbered from VRAM_ADDR, and tile map rows from
+//VRAM_TILE_MAP_ADDR_0 (so the second map's rows follow the first's).
+#define NUM_VRAM_TILES ((VRAM_TILE_MAP_ADDR_0 - VRAM_ADDR) / BYTES_PER_TILE)
+#define NUM_VRAM_TILE_MAP_ROWS ((VRAM_ADDR + VRAM_SIZE - VRAM_TILE_MAP_ADDR_0) / (BACKGROUND_RES_X / TILE_WIDTH))
+#define NUM_SPRITES (VRAM_SPRITE_TABLE_SIZE / BYTES_PER_SPRITE)
+
+//Bitmaps of everything in VRAM and OAM that's been changed since they were last cleared, one bit per
+//tile, tile map row and sprite. Writes of the value that's already there don't count.
+struct VideoDirtyState
+{
+    uint64_t Tiles[(NUM_VRAM_TILES + 63) / 64];
+    uint64_t TileMapRows[(NUM_VRAM_TILE_MAP_ROWS + 63) / 64];
+    uint64_t Sprites[(NUM_SPRITES + 63) / 64];
+};
+
+byte* AccessMem(struct GBInstance* pGB, uint16_t addr);
+
+byte ReadMem(struct GBInstance* pGB, uint16_t addr);
+void WriteMem(struct GBInstance* pGB, uint16_t addr, byte val);
+
+uint16_t ReadMem16(struct GBInstance* pGB, uint16_t addr);
+
+//Points a page aligned range of the address space at host memory. A NULL write pointer sends writes
+//through to the cartridge instead.
+void SystemMapMemory(struct GBInstance* pGB, uint16_t addr, int size, byte* pRead, byte* pWrite);
+
+//Copies all of addressable memory to/from a MEM_SIZE buffer.
+void SystemSnapshotMemory(struct GBInstance* pGB, byte* pBuffer);
+void SystemRestoreMemory(struct GBInstance* pGB, const byte* pBuffer);
+
+//For running code twice (the JIT self check), which is only safe if it's only written to plain memory
+//that's been snapshotted. While writes are being watched cartridge RAM isn't mapped for writing, so
+//everything that isn't WRAM or HRAM goes the slow way. Ending returns how many writes did.
+void SystemBeginWatchingWrites(struct GBInstance* pGB);
+int SystemEndWatchingWrites(struct GBInstance* pGB);
+
+void FireInterrupt(struct GBInstance* pGB, enum Interrupt interrupt);
 
-byte ReadMem(uint16_t addr);
-void WriteMem(uint16_t addr, byte val);
+//There's only the one set of bits, so if more than one thing wants to know what's changed then whatever
+//clears them has to pass them on to the others. Everything starts off dirty after SystemInit.
+const struct VideoDirtyState* SystemGetVideoDirty(struct GBInstance* pGB);
+bool SystemIsTileDirty(struct GBInstance* pGB, int tile);
+bool SystemIsTileMapRowDirty(struct GBInstance* pGB, int row);
+bool SystemIsSpriteDirty(struct GBInstance* pGB, int sprite);
+void SystemClearVideoDirty(struct GBInstance* pGB);
 
-uint16_t ReadMem16(uint16_t addr);
+//Instances don't share any state so each one can be run on its own thread. The first SystemInit has
+//to have finished before any others start though, as it sets up tables that they all share. Settings
+//(ie. CPUSetJitMode) can be changed any time after SystemCreate.
+struct GBInstance* SystemCreate();
+void SystemDestroy(struct GBInstance* pGB);
 
-void FireInterrupt(enum Interrupt interrupt);
+bool SystemInit(struct GBInstance* pGB, const char* pRomFile);
+void SystemShutdown(struct GBInstance* pGB);
+void SystemTick(struct GBInstance* pGB, uint32_t dt);
 
-bool SystemInit(const char* pRomFile);
-void SystemTick(uint32_t dt);
+void SystemDirectionInput(struct GBInstance* pGB, enum DirectionInput input, bool pressed);
+void SystemButtonInput(struct GBInstance* pGB, enum ButtonInput input, bool pressed);
 
 #if DEBUG_ENABLED
-void ToggleSingleStepMode();
-void EnableSingleStepMode();
-void RequestSingleStep();
+void ToggleSingleStepMode(struct GBInstance* pGB);
+void EnableSingleStepMode(struct GBInstance* pGB);
+void RequestSingleStep(struct GBInstance* pGB);
 
-void RegisterStepCallback(CallbackFunc callback);
-void RegisterROMChangedCallback(CallbackFunc callback);
+void RegisterStepCallback(struct GBInstance* pGB, CallbackFunc callback);
+void RegisterROMChangedCallback(struct GBInstance* pGB, CallbackFunc callback);
 #endif
 
 #endif
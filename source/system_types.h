@@ -35,7 +35,9 @@ enum ButtonInput
     Input_Start = 1 << 3
 };
 
-typedef void(*DirectionInputCallbackFunc)(enum DirectionInput key, bool pressed);
-typedef void(*ButtonInputCallbackFunc)(enum ButtonInput key, bool pressed);
+struct GBInstance;
+
+typedef void(*DirectionInputCallbackFunc)(struct GBInstance* pGB, enum DirectionInput key, bool pressed);
+typedef void(*ButtonInputCallbackFunc)(struct GBInstance* pGB, enum ButtonInput key, bool pressed);
 
 #endif
@@ -0,0 +1,135 @@
+#include "timer.h"
+#include "instance.h"
+#include "utils.h"
+
+#define DIV_INTERVAL 0x4000
+
+static const int TimerInterval[4] = {
+    1024,   //4096Hz
+    16,     //262144Hz
+    64,     //65536Hz
+    256     //16384Hz
+};
+
+static bool TimerEnabled(struct GBInstance* pGB) { return (*Register_TAC(pGB) & 0b100) != 0; }
+static int TimerMode(struct GBInstance* pGB) { return *Register_TAC(pGB) & 0b11; }
+
+static void TimerTick(struct GBInstance* pGB, uint64_t numCycles)
+{
+    pGB->Timer.DivIntervalCount += numCycles;
+    pGB->Timer.DivValue += (byte)(pGB->Timer.DivIntervalCount / DIV_INTERVAL);
+    pGB->Timer.DivIntervalCount %= DIV_INTERVAL;
+
+    if (TimerEnabled(pGB))
+    {
+        int interval = TimerInterval[TimerMode(pGB)];
+        pGB->Timer.TimerIntervalCount += numCycles;
+
+        uint64_t numIncrements = pGB->Timer.TimerIntervalCount / interval;
+        pGB->Timer.TimerIntervalCount %= interval;
+
+        //The overflow event means there's rarely more than one of these at a time.
+        while (numIncrements > 0)
+        {
+            uint64_t untilOverflow = 0x100 - pGB->Timer.TimerValue;
+
+            if (numIncrements < untilOverflow)
+            {
+                pGB->Timer.TimerValue += (byte)numIncrements;
+                break;
+            }
+
+            numIncrements -= untilOverflow;
+            pGB->Timer.TimerValue = *Register_TMA(pGB);
+            FireInterrupt(pGB, Interrupt_Timer);
+        }
+    }
+}
+
+static void UpdateRegisters(struct GBInstance* pGB)
+{
+    *Register_DIV(pGB) = pGB->Timer.DivValue;
+    *Register_TIMA(pGB) = pGB->Timer.TimerValue;
+}
+
+void TimerSync(struct GBInstance* pGB)
+{
+    uint64_t now = SchedulerGetCycles(pGB);
+    TimerTick(pGB, now - pGB->Timer.LastSyncCycle);
+    pGB->Timer.LastSyncCycle = now;
+    UpdateRegisters(pGB);
+}
+
+cycles TimerCyclesUntilIncrement(struct GBInstance* pGB, uint64_t cycle)
+{
+    uint64_t sinceSync = cycle - pGB->Timer.LastSyncCycle;
+    uint64_t numCycles = DIV_INTERVAL - ((pGB->Timer.DivIntervalCount + sinceSync) % DIV_INTERVAL);
+
+    if (TimerEnabled(pGB))
+    {
+        uint64_t interval = TimerInterval[TimerMode(pGB)];
+        numCycles = MIN(numCycles, interval - ((pGB->Timer.TimerIntervalCount + sinceSync) % interval));
+    }
+
+    return (cycles)numCycles;
+}
+
+//Has to be called whenever TIMA or TAC changes.
+static void ScheduleTimerEvent(struct GBInstance* pGB)
+{
+    if (TimerEnabled(pGB))
+    {
+        uint64_t interval = TimerInterval[TimerMode(pGB)];
+        SchedulerSchedule(pGB, SchedulerEvent_Timer, pGB->Timer.LastSyncCycle + ((0x100 - pGB->Timer.TimerValue) * interval) - pGB->Timer.TimerIntervalCount);
+    }
+    else
+    {
+        SchedulerCancel(pGB, SchedulerEvent_Timer);
+    }
+}
+
+static void OnTimerEvent(struct GBInstance* pGB)
+{
+    TimerSync(pGB);
+    ScheduleTimerEvent(pGB);
+}
+
+void TimerInit(struct GBInstance* pGB)
+{
+    pGB->Timer.DivValue = *Register_DIV(pGB);
+    pGB->Timer.TimerValue = *Register_TIMA(pGB);
+    pGB->Timer.DivIntervalCount = 0;
+    pGB->Timer.TimerIntervalCount = 0;
+    pGB->Timer.LastSyncCycle = SchedulerGetCycles(pGB);
+
+    SchedulerSetHandler(pGB, SchedulerEvent_Timer, &OnTimerEvent);
+    ScheduleTimerEvent(pGB);
+}
+
+void TimerWrite(struct GBInstance* pGB, uint16_t addr, byte val)
+{
+    //Anything that's happened up until now happened with the old values.
+    TimerSync(pGB);
+
+    if (addr == REGISTER_DIV_ADDR)
+    {
+        //Writing anything resets it.
+        pGB->Timer.DivValue = 0;
+    }
+    else if (addr == REGISTER_TIMA_ADDR)
+    {
+        pGB->Timer.TimerValue = val;
+        ScheduleTimerEvent(pGB);
+    }
+    else if (addr == REGISTER_TMA_ADDR)
+    {
+        *Register_TMA(pGB) = val;
+    }
+    else if (addr == REGISTER_TAC_ADDR)
+    {
+        *Register_TAC(pGB) = val;
+        ScheduleTimerEvent(pGB);
+    }
+
+    UpdateRegisters(pGB);
+}
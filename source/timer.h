@@ -0,0 +1,34 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "types.h"
+
+struct GBInstance;
+
+//DIV and TIMA aren't stepped as time passes. They're only worked out from the scheduler's cycle
+//counter when something looks at them (or changes the timer), and the only event is TIMA overflowing.
+//The real values live here and the registers in memory are just a copy of them as of the last sync, so
+//anything that overwrites memory wholesale (ie. the JIT self check) can't knock the timer out.
+struct TimerState
+{
+    byte DivValue;
+    byte TimerValue;
+    uint64_t DivIntervalCount;
+    uint64_t TimerIntervalCount;
+    uint64_t LastSyncCycle;
+};
+
+void TimerInit(struct GBInstance* pGB);
+
+//Brings DIV and TIMA up to date with the scheduler's cycle counter. Anything reading them directly
+//rather than through ReadMem has to call this first.
+void TimerSync(struct GBInstance* pGB);
+
+//Cycles from the given scheduler cycle until DIV or TIMA next goes up. Nothing is scheduled for these
+//so anything that could be polling them has to ask.
+cycles TimerCyclesUntilIncrement(struct GBInstance* pGB, uint64_t cycle);
+
+//Handles writes to DIV, TIMA, TMA and TAC.
+void TimerWrite(struct GBInstance* pGB, uint16_t addr, byte val);
+
+#endif
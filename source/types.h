@@ -22,6 +22,30 @@
 #define DEBUG_ENABLED 0
 #endif
 
+//For small helpers that should always be folded into their callers, ie. so that each opcode handler
+//ends up specialised for its registers rather than going through pointers at runtime.
+#if defined(_MSC_VER)
+#define FORCE_INLINE __forceinline
+#elif defined(__GNUC__) || defined(__clang__)
+#define FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define FORCE_INLINE inline
+#endif
+
+//For keeping state that's used together on its own cache lines, and apart from state that isn't.
+#define CACHE_LINE_SIZE 64
+
+#if defined(_MSC_VER)
+#define CACHE_ALIGNED __declspec(align(CACHE_LINE_SIZE))
+#elif defined(__GNUC__) || defined(__clang__)
+#define CACHE_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
+#else
+#define CACHE_ALIGNED
+#endif
+
+//Breaks the build if cond is false. Not every compiler has _Static_assert in C mode.
+#define STATIC_ASSERT(cond, name) typedef char StaticAssert_##name[(cond) ? 1 : -1]
+
 typedef uint8_t byte;
 typedef int cycles;
 
@@ -6,6 +6,30 @@
 #define MAX(a,b) ((a) > (b) ? (a) : (b))
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//Index of the lowest set bit. val must not be 0.
+static inline int CountTrailingZeros(uint32_t val)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(val);
+#elif defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, val);
+    return (int)idx;
+#else
+    int idx = 0;
+    while ((val & 1) == 0)
+    {
+        val >>= 1;
+        idx++;
+    }
+    return idx;
+#endif
+}
+
 bool FileRead(const char* pFileName, byte* pBuffer, int bufferSize);
 bool FileWrite(const char* pFileName, byte* pBuffer, int bufferSize);
 
@@ -15,6 +15,8 @@
 static DirectionInputCallbackFunc DirectionInputCallback = NULL;
 static ButtonInputCallbackFunc ButtonInputCallback = NULL;
 
+static struct GBInstance* pAppGB = NULL;
+
 static LARGE_INTEGER StartTime;
 static LARGE_INTEGER Frequency;
 
@@ -69,7 +71,7 @@ static void DecreaseDisassemblyIndex()
 {
     if (SelectedDisassemblyIndex == 0)
     {
-        const struct CPURegisters* cpuRegisters = DebugGetCPURegisters();
+        const struct CPURegisters* cpuRegisters = DebugGetCPURegisters(pAppGB);
 
         int disassemblyIdx = GetDisassembledROMIdxFromAddr(cpuRegisters->PC) + DisassemblyOffset;
 
@@ -88,7 +90,7 @@ static void IncreaseDisassemblyIndex()
 {
     if (SelectedDisassemblyIndex == (CALLSTACK_SIZE - 1))
     {
-        const struct CPURegisters* cpuRegisters = DebugGetCPURegisters();
+        const struct CPURegisters* cpuRegisters = DebugGetCPURegisters(pAppGB);
 
         int disassemblyIdx = GetDisassembledROMIdxFromAddr(cpuRegisters->PC) + DisassemblyOffset;
 
@@ -105,7 +107,7 @@ static void IncreaseDisassemblyIndex()
 
 static void ToggleDisassemblyBreakpoint()
 {
-    const struct CPURegisters* cpuRegisters = DebugGetCPURegisters();
+    const struct CPURegisters* cpuRegisters = DebugGetCPURegisters(pAppGB);
 
     int disassemblyIdx = GetDisassembledROMIdxFromAddr(cpuRegisters->PC) + DisassemblyOffset + SelectedDisassemblyIndex;
     int breakpointAddr = DisassembledROM[disassemblyIdx].ROMAddr;
@@ -124,7 +126,7 @@ static void DrawDebugInfo()
 {
     static const int kTextGap = 16;
 
-    const struct CPURegisters* cpuRegisters = DebugGetCPURegisters();
+    const struct CPURegisters* cpuRegisters = DebugGetCPURegisters(pAppGB);
 
     //Program
     int textY = 5;
@@ -214,10 +216,10 @@ static void DrawDebugInfo()
     textY = 320;
     textX = 10;
     DrawDebugText(textX, textY += kTextGap, 0x000000FF, "Hardware Registers");
-    DrawDebugText(textX, textY += kTextGap, 0x000000FF, "P1: 0x%.2X", *Register_P1);
-    DrawDebugText(textX, textY += kTextGap, 0x000000FF, "IF: 0x%.2X", *Register_IF);
-    DrawDebugText(textX, textY += kTextGap, 0x000000FF, "LCDC: 0x%.2X", *Register_LCDC);
-    DrawDebugText(textX, textY += kTextGap, 0x000000FF, "IE: 0x%.2X", *Register_IE);
+    DrawDebugText(textX, textY += kTextGap, 0x000000FF, "P1: 0x%.2X", *Register_P1(pAppGB));
+    DrawDebugText(textX, textY += kTextGap, 0x000000FF, "IF: 0x%.2X", *Register_IF(pAppGB));
+    DrawDebugText(textX, textY += kTextGap, 0x000000FF, "LCDC: 0x%.2X", *Register_LCDC(pAppGB));
+    DrawDebugText(textX, textY += kTextGap, 0x000000FF, "IE: 0x%.2X", *Register_IE(pAppGB));
 
     //Flags
     textY = 180;
@@ -245,8 +247,8 @@ static void DrawDebugInfo()
         {
             for (int tileX = 0; tileX < TILE_WIDTH; ++tileX)
             {
-                byte* pMem = AccessMem(tileAddr);
-                enum Colour col = PPUGetTilePixColour(pMem, tileX, tileY);
+                byte* pMem = AccessMem(pAppGB, tileAddr);
+                enum Colour col = PPUGetTilePixColour(pAppGB, pMem, tileX, tileY);
 
                 switch (col)
                 {
@@ -269,7 +271,7 @@ static void DrawDebugInfo()
 
 static void RenderPPUScreenBuffer()
 {
-    const enum Colour* pScreenBuffer = PPUGetScreenBuffer();
+    const enum Colour* pScreenBuffer = PPUGetScreenBuffer(pAppGB);
 
     for (int y = 0; y < SCREEN_RES_Y; ++y)
     {
@@ -300,8 +302,10 @@ void AppRegisterButtonInputCallback(ButtonInputCallbackFunc callback)
     ButtonInputCallback = callback;
 }
 
-bool AppInit()
+bool AppInit(struct GBInstance* pGB)
 {
+    pAppGB = pGB;
+
     QueryPerformanceCounter(&StartTime);
     QueryPerformanceFrequency(&Frequency);
 
@@ -372,21 +376,21 @@ bool AppTick()
             switch (e.key.keysym.sym)
             {
 #if DEBUG_ENABLED
-                case SDLK_p: ToggleSingleStepMode(); break;
-                case SDLK_LEFTBRACKET: RequestSingleStep(); break;
+                case SDLK_p: ToggleSingleStepMode(pAppGB); break;
+                case SDLK_LEFTBRACKET: RequestSingleStep(pAppGB); break;
                 case SDLK_MINUS: DecreaseDisassemblyIndex(); break;
                 case SDLK_EQUALS: IncreaseDisassemblyIndex(); break;
                 case SDLK_b: ToggleDisassemblyBreakpoint(); break;
                 case SDLK_d: DebugDumpDisassembly(); break;
 #endif
-                case SDLK_UP: DirectionInputCallback(Input_Up, true); break;
-                case SDLK_DOWN: DirectionInputCallback(Input_Down, true); break;
-                case SDLK_LEFT: DirectionInputCallback(Input_Left, true); break;
-                case SDLK_RIGHT: DirectionInputCallback(Input_Right, true); break;
-                case SDLK_z: ButtonInputCallback(Input_A, true); break;
-                case SDLK_x: ButtonInputCallback(Input_B, true); break;
-                case SDLK_s: ButtonInputCallback(Input_Start, true); break;
-                case SDLK_a: ButtonInputCallback(Input_Select, true); break;
+                case SDLK_UP: DirectionInputCallback(pAppGB, Input_Up, true); break;
+                case SDLK_DOWN: DirectionInputCallback(pAppGB, Input_Down, true); break;
+                case SDLK_LEFT: DirectionInputCallback(pAppGB, Input_Left, true); break;
+                case SDLK_RIGHT: DirectionInputCallback(pAppGB, Input_Right, true); break;
+                case SDLK_z: ButtonInputCallback(pAppGB, Input_A, true); break;
+                case SDLK_x: ButtonInputCallback(pAppGB, Input_B, true); break;
+                case SDLK_s: ButtonInputCallback(pAppGB, Input_Start, true); break;
+                case SDLK_a: ButtonInputCallback(pAppGB, Input_Select, true); break;
             }
         }
 
@@ -394,14 +398,14 @@ bool AppTick()
         {
             switch (e.key.keysym.sym)
             {
-                case SDLK_UP: DirectionInputCallback(Input_Up, false); break;
-                case SDLK_DOWN: DirectionInputCallback(Input_Down, false); break;
-                case SDLK_LEFT: DirectionInputCallback(Input_Left, false); break;
-                case SDLK_RIGHT: DirectionInputCallback(Input_Right, false); break;
-                case SDLK_z: ButtonInputCallback(Input_A, false); break;
-                case SDLK_x: ButtonInputCallback(Input_B, false); break;
-                case SDLK_s: ButtonInputCallback(Input_Start, false); break;
-                case SDLK_a: ButtonInputCallback(Input_Select, false); break;
+                case SDLK_UP: DirectionInputCallback(pAppGB, Input_Up, false); break;
+                case SDLK_DOWN: DirectionInputCallback(pAppGB, Input_Down, false); break;
+                case SDLK_LEFT: DirectionInputCallback(pAppGB, Input_Left, false); break;
+                case SDLK_RIGHT: DirectionInputCallback(pAppGB, Input_Right, false); break;
+                case SDLK_z: ButtonInputCallback(pAppGB, Input_A, false); break;
+                case SDLK_x: ButtonInputCallback(pAppGB, Input_B, false); break;
+                case SDLK_s: ButtonInputCallback(pAppGB, Input_Start, false); break;
+                case SDLK_a: ButtonInputCallback(pAppGB, Input_Select, false); break;
             }
         }
     }
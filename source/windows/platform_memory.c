@@ -0,0 +1,104 @@
+#include <Windows.h>
+#include <malloc.h>
+#include <string.h>
+
+#include "platform_memory.h"
+#include "utils.h"
+
+void* PlatformAllocExecutable(size_t size)
+{
+    return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+}
+
+void PlatformFreeExecutable(void* pMem, size_t size)
+{
+    VirtualFree(pMem, 0, MEM_RELEASE);
+}
+
+void* PlatformAllocAligned(size_t size, size_t alignment)
+{
+    void* pMem = _aligned_malloc(size, alignment);
+
+    if (pMem != NULL)
+    {
+        memset(pMem, 0, size);
+    }
+
+    return pMem;
+}
+
+void PlatformFreeAligned(void* pMem)
+{
+    _aligned_free(pMem);
+}
+
+const void* PlatformMapFile(const char* pFileName, size_t* pSize)
+{
+    HANDLE file = CreateFileA(pFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return NULL;
+    }
+
+    void* pMem = NULL;
+    LARGE_INTEGER fileSize;
+
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+    {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+        if (mapping != NULL)
+        {
+            *pSize = (size_t)fileSize.QuadPart;
+            pMem = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+            //The view keeps the mapping (and the file) open.
+            CloseHandle(mapping);
+        }
+    }
+
+    CloseHandle(file);
+
+    return pMem;
+}
+
+void PlatformUnmapFile(const void* pMem, size_t size)
+{
+    UnmapViewOfFile(pMem);
+}
+
+void* PlatformMapFileWritable(const char* pFileName, size_t size)
+{
+    HANDLE file = CreateFileA(pFileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return NULL;
+    }
+
+    void* pMem = NULL;
+    LARGE_INTEGER fileSize;
+
+    //Mapping more than the file has grows it.
+    if (GetFileSizeEx(file, &fileSize))
+    {
+        size_t mapSize = MAX((size_t)fileSize.QuadPart, size);
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)mapSize >> 32), (DWORD)mapSize, NULL);
+
+        if (mapping != NULL)
+        {
+            pMem = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+            CloseHandle(mapping);
+        }
+    }
+
+    CloseHandle(file);
+
+    return pMem;
+}
+
+void PlatformFlushFile(void* pMem, size_t offset, size_t size)
+{
+    FlushViewOfFile((byte*)pMem + offset, size);
+}
@@ -0,0 +1,113 @@
+#include <stdlib.h>
+#include <Windows.h>
+
+#include "platform_thread.h"
+
+struct PlatformThread
+{
+    HANDLE Thread;
+    PlatformThreadFunc Func;
+    void* pArg;
+};
+
+struct PlatformMutex
+{
+    CRITICAL_SECTION CriticalSection;
+};
+
+struct PlatformEvent
+{
+    HANDLE Event;
+};
+
+static DWORD WINAPI ThreadMain(LPVOID pArg)
+{
+    struct PlatformThread* pThread = (struct PlatformThread*)pArg;
+    pThread->Func(pThread->pArg);
+    return 0;
+}
+
+struct PlatformThread* PlatformCreateThread(PlatformThreadFunc func, void* pArg)
+{
+    struct PlatformThread* pThread = malloc(sizeof(struct PlatformThread));
+
+    if (pThread == NULL)
+    {
+        return NULL;
+    }
+
+    pThread->Func = func;
+    pThread->pArg = pArg;
+    pThread->Thread = CreateThread(NULL, 0, &ThreadMain, pThread, 0, NULL);
+
+    if (pThread->Thread == NULL)
+    {
+        free(pThread);
+        return NULL;
+    }
+
+    return pThread;
+}
+
+void PlatformJoinThread(struct PlatformThread* pThread)
+{
+    WaitForSingleObject(pThread->Thread, INFINITE);
+    CloseHandle(pThread->Thread);
+    free(pThread);
+}
+
+struct PlatformMutex* PlatformCreateMutex()
+{
+    struct PlatformMutex* pMutex = malloc(sizeof(struct PlatformMutex));
+
+    if (pMutex != NULL)
+    {
+        InitializeCriticalSection(&pMutex->CriticalSection);
+    }
+
+    return pMutex;
+}
+
+void PlatformDestroyMutex(struct PlatformMutex* pMutex)
+{
+    DeleteCriticalSection(&pMutex->CriticalSection);
+    free(pMutex);
+}
+
+void PlatformLockMutex(struct PlatformMutex* pMutex)
+{
+    EnterCriticalSection(&pMutex->CriticalSection);
+}
+
+void PlatformUnlockMutex(struct PlatformMutex* pMutex)
+{
+    LeaveCriticalSection(&pMutex->CriticalSection);
+}
+
+struct PlatformEvent* PlatformCreateEvent()
+{
+    struct PlatformEvent* pEvent = malloc(sizeof(struct PlatformEvent));
+
+    if (pEvent != NULL)
+    {
+        pEvent->Event = CreateEvent(NULL, FALSE, FALSE, NULL);
+    }
+
+    return pEvent;
+}
+
+void PlatformDestroyEvent(struct PlatformEvent* pEvent)
+{
+    CloseHandle(pEvent->Event);
+    free(pEvent);
+}
+
+void PlatformSignalEvent(struct PlatformEvent* pEvent)
+{
+    SetEvent(pEvent->Event);
+}
+
+void PlatformWaitEvent(struct PlatformEvent* pEvent)
+{
+    WaitForSingleObject(pEvent->Event, INFINITE);
+}
@@ -0,0 +1,26 @@
+#ifndef PLATFORM_THREAD_H
+#define PLATFORM_THREAD_H
+
+#include "types.h"
+
+typedef void(*PlatformThreadFunc)(void* pArg);
+
+struct PlatformThread;
+struct PlatformMutex;
+struct PlatformEvent;
+
+struct PlatformThread* PlatformCreateThread(PlatformThreadFunc func, void* pArg);
+void PlatformJoinThread(struct PlatformThread* pThread);     //Also frees it.
+
+struct PlatformMutex* PlatformCreateMutex();
+void PlatformDestroyMutex(struct PlatformMutex* pMutex);
+void PlatformLockMutex(struct PlatformMutex* pMutex);
+void PlatformUnlockMutex(struct PlatformMutex* pMutex);
+
+//Auto-reset, ie. a wait lets one waiter through then goes back to being unsignalled.
+struct PlatformEvent* PlatformCreateEvent();
+void PlatformDestroyEvent(struct PlatformEvent* pEvent);
+void PlatformSignalEvent(struct PlatformEvent* pEvent);
+void PlatformWaitEvent(struct PlatformEvent* pEvent);
+
+#endif